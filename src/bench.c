@@ -0,0 +1,755 @@
+/*
+ * bench.c
+ *
+ * Microbenchmarks for the primitives the parent and child are built on:
+ * fork+execv (until the exec is confirmed), kill() per target, setitimer(),
+ * SIGALRM delivery with a handler shaped like the child's handle_alarm,
+ * sigaction(), waitpid() with N zombies outstanding and termios mode
+ * switches (on a pseudo-terminal, so no real terminal is needed). Every
+ * case runs warmup iterations, then a number of timed trials, and reports
+ * min, percentiles, max and mean in nanoseconds.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE // Required for posix_openpt/grantpt/unlockpt/ptsname and pipe2
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+
+#define DEFAULT_TRIALS 1000
+#define DEFAULT_WARMUP 100
+#define MAX_TRIALS 10000000        // Upper bound for -n and -w (the samples take 8 bytes per trial)
+#define EXEC_TRIALS_DIVISOR 10     // fork+execv and zombie cases are ~1000x slower; run fewer trials
+#define KILL_TARGETS 8             // Children signalled round-robin by the kill case
+#define ZOMBIE_COUNTS { 1, 64, 512 } // Zombies outstanding in the waitpid cases
+#define MAX_CASE_NAME 32
+#define EXEC_ARG "--bench-exit"    // argv[1] that makes an exec'd copy exit immediately
+
+
+
+typedef struct pair_s {
+    int v1;
+    int v2;
+} pair_t;
+
+
+// One benchmark case. run() measures one trial and returns its duration in ns, or -1 on failure.
+typedef struct bench_case_s {
+    const char *name;
+    const char *description;
+    int (*setup)(void);     // May be NULL
+    long long (*run)(void);
+    void (*teardown)(void); // May be NULL; also runs after a failed setup
+    int trial_divisor;      // Trials (and warmup) are divided by this for expensive cases
+} bench_case_t;
+
+
+
+static volatile pair_t g_shared_pair;
+static volatile long long g_counts[4];
+static volatile long long g_handler_entry_ns; // Set by the SIGALRM handler
+static volatile sig_atomic_t g_repetitions;
+
+static const char *g_self_path = "/proc/self/exe";
+static pid_t g_targets[KILL_TARGETS];
+static int g_target_count;
+static int g_next_target;
+static int g_pty_master = -1;
+static int g_pty_slave = -1;
+static struct termios g_pty_cooked;
+static struct termios g_pty_raw;
+static int g_pty_is_raw;
+static int g_zombie_count;   // Zombie population for the current waitpid case
+static long long *g_samples; // Trial durations of the current case
+static int g_trials = DEFAULT_TRIALS;
+static int g_warmup = DEFAULT_WARMUP;
+
+
+static long long now_ns(void);
+static void handle_alarm(int sig);
+static void handle_noop(int sig);
+static long long run_clock(void);
+static long long run_fork_exec(void);
+static int setup_kill(void);
+static long long run_kill(void);
+static void teardown_kill(void);
+static long long run_setitimer(void);
+static void teardown_setitimer(void);
+static int setup_alarm(void);
+static long long run_alarm_roundtrip(void);
+static long long run_alarm_entry(void);
+static long long run_alarm_exit(void);
+static void teardown_alarm(void);
+static long long run_sigaction(void);
+static long long run_waitpid(void);
+static int setup_termios(void);
+static long long run_termios(void);
+static void teardown_termios(void);
+static int compare_samples(const void *a, const void *b);
+static int run_case(const bench_case_t *bench_case, const char *label);
+static int case_selected(const char *name, int argc, char *argv[], int first);
+static int parse_count(const char *text, int min, int max, int *value);
+static void print_usage(const char *prog_name);
+
+
+// Every case, in the order they run and are listed.
+static const bench_case_t g_cases[] = {
+    { "clock", "clock_gettime(CLOCK_MONOTONIC) pair (measurement floor)", NULL, run_clock, NULL, 1 },
+    { "fork-exec", "fork()+execv() until the exec is confirmed", NULL, run_fork_exec, NULL, EXEC_TRIALS_DIVISOR },
+    { "kill", "kill(SIGUSR1) to one live child", setup_kill, run_kill, teardown_kill, 1 },
+    { "setitimer", "setitimer(ITIMER_REAL) arming a 500 us interval", NULL, run_setitimer, teardown_setitimer, 1 },
+    { "alarm", "raise(SIGALRM) until the handler has returned", setup_alarm, run_alarm_roundtrip, teardown_alarm, 1 },
+    { "alarm-entry", "raise(SIGALRM) to first instruction of the handler", setup_alarm, run_alarm_entry, teardown_alarm, 1 },
+    { "alarm-exit", "handler's last instruction to back in the caller", setup_alarm, run_alarm_exit, teardown_alarm, 1 },
+    { "sigaction", "sigaction() installing a handler", NULL, run_sigaction, NULL, 1 },
+    { "waitpid", "waitpid(-1, WNOHANG) reaping one of N zombies", NULL, run_waitpid, NULL, EXEC_TRIALS_DIVISOR },
+    { "termios", "tcsetattr(TCSAFLUSH) switching raw/cooked on a pty", setup_termios, run_termios, teardown_termios, 1 }
+};
+
+#define CASE_COUNT (sizeof(g_cases) / sizeof(g_cases[0]))
+
+/*
+ * main
+ *
+ * Entry point for the benchmark program. Runs every case (or the ones
+ * named on the command line) and prints one result line per case.
+ *
+ * Accepts:
+ *   argc - Argument count
+ *   argv - [-n TRIALS] [-w WARMUP] [CASE...]; argv[1] == EXEC_ARG makes
+ *          the process exit at once (the exec target of fork-exec)
+ *
+ * Returns:
+ *   EXIT_SUCCESS if every selected case ran, EXIT_FAILURE otherwise.
+ */
+int main(int argc, char *argv[]) {
+    int opt;
+    int failures = 0;
+
+    if (argc > 1 && strcmp(argv[1], EXEC_ARG) == 0) {
+        _exit(0);
+    }
+
+    while ((opt = getopt(argc, argv, "n:w:h")) != -1) {
+        switch (opt) {
+            case 'n':
+            case 'w':
+                if (parse_count(optarg, (opt == 'n') ? 1 : 0, MAX_TRIALS, (opt == 'n') ? &g_trials : &g_warmup) != 0) {
+                    if (fprintf(stderr, "Error: Option -%c expects an integer from %d to %d, got '%s'.\n",
+                        opt, (opt == 'n') ? 1 : 0, MAX_TRIALS, optarg) < 0) { /* Handle error? */ }
+                    print_usage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                print_usage(argv[0]);
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    for (int i = optind; i < argc; ++i) {
+        size_t c = 0;
+        while (c < CASE_COUNT && strcmp(g_cases[c].name, argv[i]) != 0) {
+            c++;
+        }
+        if (c == CASE_COUNT) {
+            if (fprintf(stderr, "Error: Unknown case '%s'.\n", argv[i]) < 0) { /* Handle error? */ }
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    g_samples = malloc((size_t)g_trials * sizeof(*g_samples));
+    if (g_samples == NULL) {
+        perror("Error: Failed to allocate samples");
+        return EXIT_FAILURE;
+    }
+
+    if (printf("%-16s %8s %10s %10s %10s %10s %10s %12s %12s\n", "CASE", "TRIALS", "MIN_NS", "P50_NS", "P90_NS",
+        "P99_NS", "P999_NS", "MAX_NS", "MEAN_NS") < 0) { /* Handle error? */ }
+    for (size_t c = 0; c < CASE_COUNT; ++c) {
+        if (!case_selected(g_cases[c].name, argc, argv, optind)) {
+            continue;
+        }
+        if (g_cases[c].run == run_waitpid) {
+            const int zombie_counts[] = ZOMBIE_COUNTS;
+            for (size_t z = 0; z < sizeof(zombie_counts) / sizeof(zombie_counts[0]); ++z) {
+                char label[MAX_CASE_NAME];
+                g_zombie_count = zombie_counts[z];
+                snprintf(label, sizeof(label), "waitpid/%d", g_zombie_count);
+                failures += (run_case(&g_cases[c], label) != 0);
+            }
+        } else {
+            failures += (run_case(&g_cases[c], g_cases[c].name) != 0);
+        }
+    }
+
+    free(g_samples);
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * print_usage
+ *
+ * Accepts:
+ *   prog_name - The name of the executable (argv[0])
+ *
+ * Returns: None
+ */
+static void print_usage(const char *prog_name) {
+    if (fprintf(stderr, "Usage: %s [-n TRIALS] [-w WARMUP] [CASE...]\n", prog_name) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -n TRIALS  Timed trials per case (default %d; fork-exec and waitpid run 1/%d of that)\n",
+        DEFAULT_TRIALS, EXEC_TRIALS_DIVISOR) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -w WARMUP  Untimed iterations before the trials (default %d)\n", DEFAULT_WARMUP) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "Cases:\n") < 0) { /* Handle error? */ }
+    for (size_t c = 0; c < CASE_COUNT; ++c) {
+        if (fprintf(stderr, "  %-12s %s\n", g_cases[c].name, g_cases[c].description) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * parse_count
+ *
+ * Parses a decimal trial or warmup count, rejecting trailing characters
+ * and values outside [min, max].
+ *
+ * Accepts:
+ *   text - Option argument
+ *   min, max - Accepted range
+ *   value - Output: the parsed count
+ *
+ * Returns: 0 on success, -1 if text is not a number in range.
+ */
+static int parse_count(const char *text, int min, int max, int *value) {
+    char *end = NULL;
+
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || parsed < min || parsed > max) {
+        return -1;
+    }
+    *value = (int)parsed;
+    return 0;
+}
+
+/*
+ * case_selected
+ *
+ * Accepts:
+ *   name - Case name
+ *   argc, argv - Command line
+ *   first - Index of the first case name in argv
+ *
+ * Returns: 1 if no cases were named or name is one of them, 0 otherwise.
+ */
+static int case_selected(const char *name, int argc, char *argv[], int first) {
+    if (first >= argc) {
+        return 1;
+    }
+    for (int i = first; i < argc; ++i) {
+        if (strcmp(argv[i], name) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * run_case
+ *
+ * Runs warmup iterations and timed trials of one case and prints its
+ * percentiles.
+ *
+ * Accepts:
+ *   bench_case - Case to run
+ *   label - Name printed in the result line
+ *
+ * Returns:
+ *   0 on success, -1 if setup or a trial failed (prints error message).
+ */
+static int run_case(const bench_case_t *bench_case, const char *label) {
+    int trials = g_trials / bench_case->trial_divisor;
+    int warmup = g_warmup / bench_case->trial_divisor;
+    int result = -1;
+
+    trials = (trials < 1) ? 1 : trials;
+    if (bench_case->setup != NULL && bench_case->setup() != 0) {
+        if (fprintf(stderr, "%-16s setup failed (errno %d: %s)\n", label, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        if (bench_case->teardown != NULL) {
+            bench_case->teardown(); // Releases what the setup got before failing (the pty, forked targets)
+        }
+        return -1;
+    }
+
+    for (int i = 0; i < warmup; ++i) {
+        if (bench_case->run() < 0) {
+            goto failed;
+        }
+    }
+    for (int i = 0; i < trials; ++i) {
+        g_samples[i] = bench_case->run();
+        if (g_samples[i] < 0) {
+            goto failed;
+        }
+    }
+
+    qsort(g_samples, (size_t)trials, sizeof(*g_samples), compare_samples);
+    long double sum = 0.0L;
+    for (int i = 0; i < trials; ++i) {
+        sum += g_samples[i];
+    }
+    // Percentile p is the sample at rank (trials - 1) * p, rounded to the nearest index
+    #define PERCENTILE(p) g_samples[(int)((double)(trials - 1) * (p) + 0.5)]
+    if (printf("%-16s %8d %10lld %10lld %10lld %10lld %10lld %12lld %12.0f\n", label, trials, g_samples[0],
+        PERCENTILE(0.50), PERCENTILE(0.90), PERCENTILE(0.99), PERCENTILE(0.999), g_samples[trials - 1],
+        (double)(sum / trials)) < 0) { /* Handle error? */ }
+    #undef PERCENTILE
+    result = 0;
+    goto done;
+
+    failed:
+    if (fprintf(stderr, "%-16s trial failed (errno %d: %s)\n", label, errno, strerror(errno)) < 0) { /* Handle error? */ }
+
+    done:
+    if (bench_case->teardown != NULL) {
+        bench_case->teardown();
+    }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+    return result;
+}
+
+/*
+ * compare_samples
+ *
+ * qsort comparator for trial durations.
+ *
+ * Accepts:
+ *   a, b - Pointers to long long
+ *
+ * Returns: <0, 0 or >0 as a is less than, equal to or greater than b.
+ */
+static int compare_samples(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * now_ns
+ *
+ * Accepts: None
+ * Returns: CLOCK_MONOTONIC in nanoseconds. Async-signal-safe.
+ */
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * handle_alarm
+ *
+ * SIGALRM handler doing the same work as the child's: classify the pair,
+ * bump a counter and the repetition count. Records when it was entered.
+ *
+ * Accepts:
+ *   sig - The signal number (expected: SIGALRM)
+ *
+ * Returns: None
+ */
+static void handle_alarm(int sig) {
+    g_handler_entry_ns = now_ns();
+    if (sig == SIGALRM) {
+        int local_v1 = g_shared_pair.v1;
+        int local_v2 = g_shared_pair.v2;
+        g_counts[local_v1 * 2 + local_v2]++;
+        g_repetitions++;
+    }
+}
+
+/*
+ * handle_noop
+ *
+ * Handler installed by the sigaction case and in kill targets.
+ *
+ * Accepts:
+ *   sig - Unused
+ *
+ * Returns: None
+ */
+static void handle_noop(int sig) {
+    (void)sig;
+}
+
+/*
+ * run_clock
+ *
+ * Accepts: None
+ * Returns: Duration of back-to-back clock reads (the floor of every case).
+ */
+static long long run_clock(void) {
+    long long start = now_ns();
+    return now_ns() - start;
+}
+
+/*
+ * run_fork_exec
+ *
+ * Forks and execs this program (which exits at once), timing until the
+ * close-on-exec pipe reports the exec succeeded, as the parent's spawn path
+ * does. The child is reaped outside the timed part.
+ *
+ * Accepts: None
+ * Returns: Duration in ns, -1 on failure.
+ */
+static long long run_fork_exec(void) {
+    int fds[2];
+    char buf;
+
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        return -1;
+    }
+    long long start = now_ns();
+    pid_t pid = fork();
+    if (pid == -1) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        char *args[] = { (char *)g_self_path, (char *)EXEC_ARG, NULL };
+        execv(g_self_path, args);
+        int err = errno;
+        if (write(fds[1], &err, 1) == -1) { /* Handle error? */ }
+        _exit(127);
+    }
+    close(fds[1]);
+    ssize_t n;
+    while ((n = read(fds[0], &buf, 1)) == -1 && errno == EINTR) {
+    }
+    long long elapsed = now_ns() - start;
+    close(fds[0]);
+    if (waitpid(pid, NULL, 0) == -1 || n != 0) {
+        return -1;
+    }
+    return elapsed;
+}
+
+/*
+ * setup_kill
+ *
+ * Starts KILL_TARGETS children that sleep in pause() with a SIGUSR1
+ * handler installed (an ignored signal would be dropped at send time and
+ * understate the cost).
+ *
+ * Accepts: None
+ * Returns: 0 on success, -1 on failure.
+ */
+static int setup_kill(void) {
+    int ready[2];
+
+    if (pipe(ready) == -1) {
+        return -1;
+    }
+    g_target_count = 0;
+    g_next_target = 0;
+    for (int i = 0; i < KILL_TARGETS; ++i) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            break;
+        }
+        if (pid == 0) {
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_handler = handle_noop;
+            sigemptyset(&sa.sa_mask);
+            sigaction(SIGUSR1, &sa, NULL);
+            close(ready[0]);
+            close(ready[1]); // EOF once every target has its handler
+            for (;;) {
+                pause();
+            }
+        }
+        g_targets[g_target_count++] = pid;
+    }
+    close(ready[1]);
+    char buf;
+    while (read(ready[0], &buf, 1) == -1 && errno == EINTR) {
+    }
+    close(ready[0]);
+    return (g_target_count == KILL_TARGETS) ? 0 : -1;
+}
+
+/*
+ * run_kill
+ *
+ * Accepts: None
+ * Returns: Duration of one kill() to the next target, -1 on failure.
+ */
+static long long run_kill(void) {
+    pid_t target = g_targets[g_next_target];
+    g_next_target = (g_next_target + 1) % g_target_count;
+    long long start = now_ns();
+    int rc = kill(target, SIGUSR1);
+    long long elapsed = now_ns() - start;
+    return (rc == 0) ? elapsed : -1;
+}
+
+/*
+ * teardown_kill
+ *
+ * Kills and reaps the targets.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void teardown_kill(void) {
+    for (int i = 0; i < g_target_count; ++i) {
+        kill(g_targets[i], SIGKILL);
+        waitpid(g_targets[i], NULL, 0);
+    }
+    g_target_count = 0;
+}
+
+/*
+ * run_setitimer
+ *
+ * SIGALRM is blocked for the case, so the armed timer never interrupts it.
+ *
+ * Accepts: None
+ * Returns: Duration of one setitimer() call, -1 on failure.
+ */
+static long long run_setitimer(void) {
+    struct itimerval timer;
+    sigset_t block;
+
+    sigemptyset(&block);
+    sigaddset(&block, SIGALRM);
+    sigprocmask(SIG_BLOCK, &block, NULL);
+    timer.it_value.tv_sec = 0;
+    timer.it_value.tv_usec = 500;
+    timer.it_interval = timer.it_value;
+    long long start = now_ns();
+    int rc = setitimer(ITIMER_REAL, &timer, NULL);
+    long long elapsed = now_ns() - start;
+    return (rc == 0) ? elapsed : -1;
+}
+
+/*
+ * teardown_setitimer
+ *
+ * Disarms the timer, discards any pending SIGALRM and unblocks it.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void teardown_setitimer(void) {
+    struct itimerval timer;
+    sigset_t block;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_REAL, &timer, NULL);
+    signal(SIGALRM, SIG_IGN); // Discards a pending SIGALRM
+    signal(SIGALRM, SIG_DFL);
+    sigemptyset(&block);
+    sigaddset(&block, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &block, NULL);
+}
+
+/*
+ * setup_alarm
+ *
+ * Installs handle_alarm for SIGALRM.
+ *
+ * Accepts: None
+ * Returns: 0 on success, -1 on failure.
+ */
+static int setup_alarm(void) {
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_alarm;
+    sigemptyset(&sa.sa_mask);
+    return sigaction(SIGALRM, &sa, NULL);
+}
+
+/*
+ * run_alarm_roundtrip
+ *
+ * raise() delivers the signal before it returns, so the duration covers
+ * the kernel send, the switch into the handler, the handler and sigreturn.
+ *
+ * Accepts: None
+ * Returns: Duration in ns, -1 on failure.
+ */
+static long long run_alarm_roundtrip(void) {
+    long long start = now_ns();
+    int rc = raise(SIGALRM);
+    long long elapsed = now_ns() - start;
+    return (rc == 0) ? elapsed : -1;
+}
+
+/*
+ * run_alarm_entry
+ *
+ * Accepts: None
+ * Returns: Time from calling raise() to the handler's first instruction, -1 on failure.
+ */
+static long long run_alarm_entry(void) {
+    long long start = now_ns();
+    if (raise(SIGALRM) != 0) {
+        return -1;
+    }
+    return g_handler_entry_ns - start;
+}
+
+/*
+ * run_alarm_exit
+ *
+ * Accepts: None
+ * Returns: Time from the handler's entry to raise() returning, -1 on failure.
+ */
+static long long run_alarm_exit(void) {
+    if (raise(SIGALRM) != 0) {
+        return -1;
+    }
+    return now_ns() - g_handler_entry_ns;
+}
+
+/*
+ * teardown_alarm
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void teardown_alarm(void) {
+    signal(SIGALRM, SIG_DFL);
+}
+
+/*
+ * run_sigaction
+ *
+ * Accepts: None
+ * Returns: Duration of installing a SIGUSR2 handler, -1 on failure.
+ */
+static long long run_sigaction(void) {
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_noop;
+    sigemptyset(&sa.sa_mask);
+    long long start = now_ns();
+    int rc = sigaction(SIGUSR2, &sa, NULL);
+    long long elapsed = now_ns() - start;
+    return (rc == 0) ? elapsed : -1;
+}
+
+/*
+ * run_waitpid
+ *
+ * Creates g_zombie_count children that exit at once, waits until all of
+ * them are zombies (waitid with WNOWAIT leaves them unreaped), then times
+ * one waitpid(-1, WNOHANG) reaping one of them. The rest are reaped
+ * outside the timed part.
+ *
+ * Accepts: None
+ * Returns: Duration in ns, -1 on failure.
+ */
+static long long run_waitpid(void) {
+    siginfo_t info;
+    int created = 0;
+
+    for (; created < g_zombie_count; ++created) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            break;
+        }
+        if (pid == 0) {
+            _exit(0);
+        }
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOWAIT) == -1) {
+            break;
+        }
+    }
+
+    long long start = now_ns();
+    pid_t reaped = waitpid(-1, NULL, WNOHANG);
+    long long elapsed = now_ns() - start;
+
+    while (waitpid(-1, NULL, 0) > 0) {
+    }
+    return (created == g_zombie_count && reaped > 0) ? elapsed : -1;
+}
+
+/*
+ * setup_termios
+ *
+ * Opens a pseudo-terminal pair and prepares the cooked and raw settings
+ * the parent switches between.
+ *
+ * Accepts: None
+ * Returns: 0 on success, -1 on failure.
+ */
+static int setup_termios(void) {
+    g_pty_master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (g_pty_master == -1 || grantpt(g_pty_master) == -1 || unlockpt(g_pty_master) == -1) {
+        return -1;
+    }
+    const char *name = ptsname(g_pty_master);
+    if (name == NULL) {
+        return -1;
+    }
+    g_pty_slave = open(name, O_RDWR | O_NOCTTY);
+    if (g_pty_slave == -1 || tcgetattr(g_pty_slave, &g_pty_cooked) == -1) {
+        return -1;
+    }
+    g_pty_raw = g_pty_cooked;
+    g_pty_raw.c_lflag &= ~(tcflag_t)(ECHO | ICANON | ISIG | IEXTEN);
+    g_pty_raw.c_iflag &= ~(tcflag_t)(IXON | ICRNL | BRKINT | INPCK | ISTRIP);
+    g_pty_raw.c_oflag &= ~(tcflag_t)OPOST;
+    g_pty_raw.c_cc[VMIN] = 1;
+    g_pty_raw.c_cc[VTIME] = 0;
+    g_pty_is_raw = 0;
+    return 0;
+}
+
+/*
+ * run_termios
+ *
+ * Accepts: None
+ * Returns: Duration of one switch (alternately to raw and back), -1 on failure.
+ */
+static long long run_termios(void) {
+    const struct termios *target = g_pty_is_raw ? &g_pty_cooked : &g_pty_raw;
+    long long start = now_ns();
+    int rc = tcsetattr(g_pty_slave, TCSAFLUSH, target);
+    long long elapsed = now_ns() - start;
+    g_pty_is_raw = !g_pty_is_raw;
+    return (rc == 0) ? elapsed : -1;
+}
+
+/*
+ * teardown_termios
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void teardown_termios(void) {
+    if (g_pty_slave != -1) {
+        close(g_pty_slave);
+        g_pty_slave = -1;
+    }
+    if (g_pty_master != -1) {
+        close(g_pty_master);
+        g_pty_master = -1;
+    }
+}
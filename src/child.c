@@ -6,23 +6,67 @@
  * The signal handler records the state of the structure at the time of
  * the interrupt ({0,0}, {0,1}, {1,0}, {1,1}). After a set number
  * of repetitions, it prints statistics to stdout (if enabled via SIGUSR1)
- * and exits. Output can be suppressed via SIGUSR2.
+ * and exits. Output can be suppressed via SIGUSR2. The statistics also
+ * record the scheduling policy the parent applied and the achieved
+ * sampling interval, so policies can be compared. When the parent passes
+ * a shared statistics slot (-F FD -n SLOT), the counters are published
+ * there live and checkpointed periodically, on SIGTERM and at completion.
+ * A run can resume from a checkpoint (-c REPS:C00:C01:C10:C11).
+ * With -e SAMPLER_PID the child arms no timer at all: it publishes the
+ * address of its pair in the slot, and the parent's sampler process reads
+ * the pair from outside (process_vm_readv) until the repetitions are done.
+ * With -H the slot is prefaulted and locked, so the handler never takes a
+ * page fault on it. Instrumented builds (instrument.h) report the handler's
+ * own run time, the achieved intervals and the writer loop's iterations.
+ * With -d SECONDS the run is time-boxed: sampling continues until a
+ * monotonic deadline instead of stopping after NUM_REPETITIONS.
+ * The parent can queue commands to a running child on a real-time signal
+ * (see child_command.h): change the sample interval, start the measurement
+ * over, or print the current counters. When the parent pauses the fleet
+ * (SIGSTOP/SIGCONT) it reports the paused time the same way; that time is
+ * left out of the elapsed time and mean interval, and extends a time box.
+ * With -M ROUNDS the child is persistent: after each round it reports its
+ * statistics, tells the parent (CHILD_ROUND_SIGNAL) and waits for the next
+ * round command, which starts the counters over, so one process serves
+ * many measurements.
+ * Static tracepoints (trace_probe.h) mark the start, signal receipt, the
+ * SIGALRM handler's entry and exit and each statistics line.
  */
 #define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE // Required for SCHED_BATCH and SCHED_IDLE (Linux-specific policies)
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
 #include <sys/time.h>
+#include <sys/resource.h> // For getpriority
+#include <sched.h>
+#include <time.h>
 #include <errno.h>
+#include <sys/mman.h>
+#include <sys/prctl.h> // For PR_SET_PTRACER
+#include <sys/vfs.h>   // For fstatfs
+#include <linux/magic.h> // For HUGETLBFS_MAGIC
+#include <stdint.h>    // For uintptr_t
+#include <limits.h>    // For INT_MAX
+#include <stdatomic.h> // For atomic_thread_fence
 
+#include "stats_slot.h"
+#include "child_command.h"
+#include "sched_policy.h"
+#include "trace_probe.h"
+#include "instrument.h"
 
 
 #define NUM_REPETITIONS 10001
 
 #define ALARM_INTERVAL_US 500
 
+#define SCHED_NAME_LEN 32
+
+#define DUMP_TAG_SLOTS 32 // Tags of dump requests not yet printed
+
 
 
 typedef struct pair_s {
@@ -42,15 +86,62 @@ static volatile long long g_count11;
 
 
 static volatile sig_atomic_t g_alarm_flag;
-static volatile sig_atomic_t g_repetitions_done;
+static volatile long long g_repetitions_done; // 64-bit: long time-boxed runs at short intervals pass INT_MAX
 static volatile sig_atomic_t g_output_enabled;
+static volatile long long g_resumed_reps; // Repetitions carried over from a checkpoint (-c)
+static pid_t g_external_sampler; // Sampler process (-e), 0 if the child samples itself
+static int g_prefault_slot;      // Prefault and lock the slot (-H)
+static int g_slot_huge;          // The stats region is backed by hugetlbfs
+static long long g_duration_ns;  // Length of a time-boxed run (-d), 0 for NUM_REPETITIONS
+static volatile long long g_deadline_ns; // CLOCK_MONOTONIC end of a time-boxed run, moved by pauses
+
+
+// Instrumented builds only (INSTRUMENT)
+INSTR_DEFINE(g_instr_handler_ns);      // Time spent in handle_alarm
+INSTR_DEFINE(g_instr_interval_ns);     // Time between successive samples
+INSTR_DEFINE(g_instr_loop_iterations); // Writer loop iterations per interval
+
+// Commands queued by the parent (CHILD_COMMAND_SIGNAL)
+static volatile sig_atomic_t g_alarm_interval_us; // Sample interval, changed by CHILD_COMMAND_SET_INTERVAL
+static volatile long long g_run_start_us;         // Start of the measurement, moved by a reset
+static volatile long long g_paused_us;            // Time stopped by the parent since then
+static volatile sig_atomic_t g_dumps_requested;   // CHILD_COMMAND_DUMP_STATS received
+static sig_atomic_t g_dumps_printed;              // Dumps printed by main
+static volatile int g_dump_tags[DUMP_TAG_SLOTS];  // Tag of request n at n % DUMP_TAG_SLOTS
+static volatile sig_atomic_t g_commands_received;
+static volatile sig_atomic_t g_commands_ignored;  // Unknown, malformed or not applicable
+static int g_persistent;                          // Run rounds until g_round_limit (-M)
+static int g_round_limit;                         // Rounds to run, 0 until stopped
+static volatile sig_atomic_t g_rounds_released;   // CHILD_COMMAND_NEXT_ROUND received
+static volatile sig_atomic_t g_round_waiting;     // Between rounds: the final checkpoint awaits collection
+static volatile sig_atomic_t g_final_checkpointed; // The last checkpoint written was CHECKPOINT_FINAL
+
+
+static stats_slot_t *g_slot; // Shared statistics slot, NULL if the parent passed none
 
 
 static void handle_alarm(int sig);
 static void handle_usr_signals(int sig);
+static void handle_term(int sig);
+static void handle_command(int sig, siginfo_t *info, void *context);
+static void print_pending_dumps(void);
+static void write_checkpoint(int reason);
+static void reset_measurement(void);
+static int wait_for_next_round(int round);
+static int parse_resume_spec(const char *text);
 static int register_signal_handlers(void);
 static int setup_timer(void);
 static void initialize_globals(void);
+static void describe_sched_policy(char *buf, size_t buf_size);
+static long long monotonic_us(void);
+static int parse_arguments(int argc, char *argv[], int *slot_fd, long *slot_index);
+static void attach_stats_slot(int slot_fd, long slot_index);
+static void run_externally_sampled(void);
+static long long monotonic_ns(void);
+static int run_finished(void);
+#if INSTRUMENT
+static void print_instrumentation(pid_t pid);
+#endif
 
 /*
  * main
@@ -60,32 +151,72 @@ static void initialize_globals(void);
  * prints statistics to stdout after N repetitions (if enabled), and exits.
  *
  * Accepts:
- *   argc - Argument count (expected: 1)
- *   argv - Argument vector (unused)
+ *   argc - Argument count
+ *   argv - Argument vector (optional -F FD -n SLOT for the shared stats slot,
+ *          -c REPS:C00:C01:C10:C11 to resume from a checkpoint,
+ *          -e SAMPLER_PID to be sampled by the parent's sampler process,
+ *          -H to prefault and lock the slot, -d SECONDS for a time-boxed run)
  *
  * Returns:
  *   EXIT_SUCCESS on normal completion.
  *   EXIT_FAILURE on setup errors.
  */
 int main(int argc, char *argv[]) {
-    (void)argv;
-
     pid_t my_pid = getpid();
+    int slot_fd = -1;
+    long slot_index = -1;
 
 
-    if (argc > 1) {
+    initialize_globals();
+
+    if (parse_arguments(argc, argv, &slot_fd, &slot_index) != 0) {
         // Using \r\n for consistency, assuming terminal might be raw due to parent
         if (fprintf(stderr, "CHILD [%d]: Warning: Received unexpected arguments.\r\n", my_pid) < 0) { /* Handle error? */ }
     }
 
-
-    initialize_globals();
+    if (g_duration_ns > 0) {
+        g_deadline_ns = monotonic_ns() + g_duration_ns; // Before the slot is published, for the sampler
+    }
+    attach_stats_slot(slot_fd, slot_index);
+    if (g_external_sampler != 0 && g_slot == NULL) {
+        if (fprintf(stderr, "CHILD [%d]: Error: External sampling needs a stats slot.\r\n", my_pid) < 0) { /* Handle error? */ }
+        return EXIT_FAILURE;
+    }
+    if (g_persistent && (g_slot == NULL || g_external_sampler != 0)) {
+        // The parent collects each round from the slot, and the sampler owns the counters under -e
+        if (fprintf(stderr, "CHILD [%d]: Warning: Rounds need a stats slot and no external sampler; running once.\r\n", my_pid) < 0) { /* Handle error? */ }
+        g_persistent = 0;
+    }
 
     pid_t parent_pid = getppid();
 
+    char sched_name[SCHED_NAME_LEN];
+    describe_sched_policy(sched_name, sizeof(sched_name));
+
+    char run_length[80];
+    int length_used;
+    if (g_duration_ns > 0) {
+        length_used = snprintf(run_length, sizeof(run_length), "for %.3f s", (double)g_duration_ns / 1e9);
+    } else {
+        length_used = snprintf(run_length, sizeof(run_length), "%d reps", NUM_REPETITIONS);
+    }
+    if (g_persistent && length_used >= 0 && (size_t)length_used < sizeof(run_length)) {
+        if (g_round_limit > 0) {
+            snprintf(run_length + length_used, sizeof(run_length) - (size_t)length_used, " per round, %d rounds", g_round_limit);
+        } else {
+            snprintf(run_length + length_used, sizeof(run_length) - (size_t)length_used, " per round, rounds until stopped");
+        }
+    }
     // Using \r\n for consistency
-    if (fprintf(stderr, "CHILD [%d]: Started. PPID=%d. Output initially %s. Will run %d reps.\r\n",
-        my_pid, parent_pid, g_output_enabled ? "ENABLED" : "DISABLED", NUM_REPETITIONS) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "CHILD [%d]: Started. PPID=%d. Policy %s. Output initially %s. Will run %s.\r\n",
+        my_pid, parent_pid, sched_name, g_output_enabled ? "ENABLED" : "DISABLED", run_length) < 0) { /* Handle error? */ }
+        if (g_resumed_reps > 0) {
+            if (fprintf(stderr, "CHILD [%d]: Resuming from checkpoint at %lld reps.\r\n", my_pid, g_resumed_reps) < 0) { /* Handle error? */ }
+        }
+        if (g_external_sampler != 0) {
+            if (fprintf(stderr, "CHILD [%d]: Sampled externally by PID %d (pair at %p), no timer.\r\n",
+                my_pid, (int)g_external_sampler, (void *)&g_shared_pair) < 0) { /* Handle error? */ }
+        }
         if (fflush(stderr) == EOF) {
             // Using \r\n for consistency
             fprintf(stderr, "CHILD [%d]: Error flushing stderr on start: %s\r\n", my_pid, strerror(errno));
@@ -94,59 +225,123 @@ int main(int argc, char *argv[]) {
         if (register_signal_handlers() != 0) {
             return EXIT_FAILURE;
         }
+        // The parent blocks the command signal across execv(); commands queued since are delivered now
+        sigset_t command_mask;
+        sigemptyset(&command_mask);
+        sigaddset(&command_mask, CHILD_COMMAND_SIGNAL);
+        sigprocmask(SIG_UNBLOCK, &command_mask, NULL);
+        TRACE_PROBE2(child_start, my_pid, (g_slot != NULL) ? slot_index : -1);
 
 
         int current_state = 0;
+        int round = 1;
+        INSTR_COUNTER(loop_iterations);
 
+        g_run_start_us = monotonic_us();
 
-        if (setup_timer() != 0) {
+        if (g_external_sampler != 0) {
+            run_externally_sampled();
+        } else if (setup_timer() != 0) {
             return EXIT_FAILURE;
         }
 
-        while (g_repetitions_done < NUM_REPETITIONS) {
-            g_alarm_flag = 0;
+        for (;;) { // One round, or the whole run unless persistent (-M)
+            while (!run_finished()) {
+                g_alarm_flag = 0;
 
 
-            while (!g_alarm_flag) {
-                if (current_state == 0) {
-                    g_shared_pair.v1 = 0;
-                    g_shared_pair.v2 = 0;
-                    current_state = 1;
-                } else {
-                    g_shared_pair.v1 = 1;
-                    g_shared_pair.v2 = 1;
-                    current_state = 0;
+                while (!g_alarm_flag) {
+                    INSTR_COUNT(loop_iterations);
+                    if (current_state == 0) {
+                        g_shared_pair.v1 = 0;
+                        g_shared_pair.v2 = 0;
+                        current_state = 1;
+                    } else {
+                        g_shared_pair.v1 = 1;
+                        g_shared_pair.v2 = 1;
+                        current_state = 0;
+                    }
                 }
-            }
+                INSTR_COUNTER_FLUSH(g_instr_loop_iterations, loop_iterations);
 
+                if (g_dumps_printed != g_dumps_requested) {
+                    print_pending_dumps();
+                }
 
-            if (g_repetitions_done < NUM_REPETITIONS) {
-                if (setup_timer() != 0) {
-                    // Using \r\n for consistency
-                    if (fprintf(stderr, "CHILD [%d]: Error re-arming timer. Exiting loop.\r\n", my_pid) < 0) { /* Handle error? */ }
-                    break;
+                if (!run_finished()) {
+                    if (setup_timer() != 0) {
+                        // Using \r\n for consistency
+                        if (fprintf(stderr, "CHILD [%d]: Error re-arming timer. Exiting loop.\r\n", my_pid) < 0) { /* Handle error? */ }
+                        break;
+                    }
                 }
             }
-        }
 
 
 
-        if (g_output_enabled) {
-            // MODIFIED: Changed \n to \r\n for the statistics line
-            if (printf("PPID=%d, PID=%d, STATS={00:%lld, 01:%lld, 10:%lld, 11:%lld}\r\n",
-                parent_pid, my_pid,
-                g_count00, g_count01, g_count10, g_count11) < 0) {
-                // Using \r\n for consistency
-                fprintf(stderr, "CHILD [%d]: Error writing final stats to stdout: %s\r\n", my_pid, strerror(errno));
+            // The handlers also write checkpoints; keep them out while this one is written
+            sigset_t checkpoint_mask, saved_mask;
+            sigemptyset(&checkpoint_mask);
+            sigaddset(&checkpoint_mask, SIGALRM);
+            sigaddset(&checkpoint_mask, SIGTERM);
+            sigaddset(&checkpoint_mask, CHILD_COMMAND_SIGNAL);
+            sigprocmask(SIG_BLOCK, &checkpoint_mask, &saved_mask);
+            write_checkpoint(run_finished() ? CHECKPOINT_FINAL : CHECKPOINT_PERIODIC);
+            sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+
+            long long elapsed_us = monotonic_us() - g_run_start_us - g_paused_us; // Paused time is not sampling time
+            long long reps_this_run = g_repetitions_done - g_resumed_reps;
+            double mean_interval_us = (reps_this_run > 0) ? (double)elapsed_us / (double)reps_this_run : 0.0;
+
+            TRACE_PROBE4(stats_emit, round, g_repetitions_done, elapsed_us, g_output_enabled);
+            if (g_output_enabled) {
+                // MODIFIED: Changed \n to \r\n for the statistics line
+                // A time-boxed run also reports how many samples it achieved in this run
+                // A paused run also reports the time it was stopped
+                char samples[96] = "";
+                int used = 0;
+                if (g_duration_ns > 0) {
+                    used = snprintf(samples, sizeof(samples), ", SAMPLES=%lld", reps_this_run);
                 }
-                if (fflush(stdout) == EOF) {
-                    // Using \r\n for consistency
-                    fprintf(stderr, "CHILD [%d]: Error flushing stdout for stats: %s\r\n", my_pid, strerror(errno));
+                if (g_paused_us > 0 && used >= 0 && (size_t)used < sizeof(samples)) {
+                    used += snprintf(samples + used, sizeof(samples) - (size_t)used, ", PAUSED_US=%lld", g_paused_us);
                 }
-        } else {
-            // Using \r\n for consistency
-            if (fprintf(stderr, "CHILD [%d]: Final statistics output suppressed by signal.\r\n", my_pid) < 0) { /* Handle error? */ }
-            if (fflush(stderr) == EOF) { /* Handle error? */ }
+                if (g_persistent && used >= 0 && (size_t)used < sizeof(samples)) {
+                    snprintf(samples + used, sizeof(samples) - (size_t)used, ", ROUND=%d", round);
+                }
+                if (printf("PPID=%d, PID=%d, STATS={00:%lld, 01:%lld, 10:%lld, 11:%lld}, SCHED=%s, ELAPSED_US=%lld, MEAN_INTERVAL_US=%.1f%s\r\n",
+                    parent_pid, my_pid,
+                    g_count00, g_count01, g_count10, g_count11,
+                    sched_name, elapsed_us, mean_interval_us, samples) < 0) {
+                    // Using \r\n for consistency
+                    fprintf(stderr, "CHILD [%d]: Error writing final stats to stdout: %s\r\n", my_pid, strerror(errno));
+                    }
+                    if (fflush(stdout) == EOF) {
+                        // Using \r\n for consistency
+                        fprintf(stderr, "CHILD [%d]: Error flushing stdout for stats: %s\r\n", my_pid, strerror(errno));
+                    }
+            } else {
+                // Using \r\n for consistency
+                if (fprintf(stderr, "CHILD [%d]: Final statistics output suppressed by signal.\r\n", my_pid) < 0) { /* Handle error? */ }
+                if (fflush(stderr) == EOF) { /* Handle error? */ }
+            }
+
+            if (!wait_for_next_round(round)) {
+                break;
+            }
+            round++;
+            if (setup_timer() != 0) {
+                return EXIT_FAILURE;
+            }
+        }
+
+#if INSTRUMENT
+        print_instrumentation(my_pid);
+#endif
+
+        if (g_commands_received > 0) {
+            if (fprintf(stderr, "CHILD [%d]: Handled %d queued commands (%d ignored); final sample interval %d us.\r\n",
+                my_pid, (int)g_commands_received, (int)g_commands_ignored, (int)g_alarm_interval_us) < 0) { /* Handle error? */ }
         }
 
         // Using \r\n for consistency
@@ -174,6 +369,331 @@ static void initialize_globals(void) {
     g_alarm_flag = 0;
     g_repetitions_done = 0;
     g_output_enabled = 1;
+    g_resumed_reps = 0;
+    g_external_sampler = 0;
+    g_prefault_slot = 0;
+    g_slot_huge = 0;
+    g_duration_ns = 0;
+    g_deadline_ns = 0;
+    INSTR_RESET(g_instr_handler_ns);
+    INSTR_RESET(g_instr_interval_ns);
+    INSTR_RESET(g_instr_loop_iterations);
+    g_alarm_interval_us = ALARM_INTERVAL_US;
+    g_run_start_us = 0;
+    g_paused_us = 0;
+    g_dumps_requested = 0;
+    g_dumps_printed = 0;
+    for (int i = 0; i < DUMP_TAG_SLOTS; ++i) {
+        g_dump_tags[i] = 0;
+    }
+    g_commands_received = 0;
+    g_commands_ignored = 0;
+    g_persistent = 0;
+    g_round_limit = 0;
+    g_rounds_released = 0;
+    g_round_waiting = 0;
+    g_final_checkpointed = 0;
+    g_slot = NULL;
+}
+
+/*
+ * parse_arguments
+ *
+ * Parses the options passed by the parent: -F FD (descriptor of the shared
+ * statistics region), -n SLOT (index of this child's slot),
+ * -c REPS:C00:C01:C10:C11 (checkpoint to resume from), -e SAMPLER_PID
+ * (sample externally), -H (prefault and lock the slot) and -d SECONDS
+ * (time-boxed run) and -M ROUNDS (persistent, 0 for rounds until stopped).
+ * A resumed time-boxed run gets the full duration again.
+ *
+ * Accepts:
+ *   argc - Argument count
+ *   argv - Argument vector
+ *   slot_fd - Output: region descriptor, -1 if not given
+ *   slot_index - Output: slot index, -1 if not given
+ *
+ * Returns:
+ *   0 on success, -1 on unknown or malformed arguments.
+ */
+static int parse_arguments(int argc, char *argv[], int *slot_fd, long *slot_index) {
+    int opt;
+    int result = 0;
+
+    opterr = 0; // Report problems with the child's own message
+    while ((opt = getopt(argc, argv, "F:n:c:e:Hd:M:")) != -1) {
+        char *end = NULL;
+        long value;
+
+        switch (opt) {
+            case 'c':
+                if (parse_resume_spec(optarg) != 0) {
+                    result = -1;
+                }
+                break;
+            case 'H':
+                g_prefault_slot = 1;
+                break;
+            case 'd': {
+                errno = 0;
+                double seconds = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || !(seconds > 0.0) || seconds > 1e6) {
+                    result = -1;
+                } else {
+                    g_duration_ns = (long long)(seconds * 1e9);
+                }
+                break;
+            }
+            case 'M':
+                errno = 0;
+                value = strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || value < 0 || value > INT_MAX) {
+                    result = -1;
+                } else {
+                    g_persistent = 1;
+                    g_round_limit = (int)value;
+                }
+                break;
+            case 'e':
+                errno = 0;
+                value = strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || value <= 0) {
+                    result = -1;
+                } else {
+                    g_external_sampler = (pid_t)value;
+                }
+                break;
+            case 'F':
+            case 'n':
+                errno = 0;
+                value = strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || value < 0) {
+                    result = -1;
+                } else if (opt == 'F') {
+                    *slot_fd = (int)value;
+                } else {
+                    *slot_index = value;
+                }
+                break;
+            default:
+                result = -1;
+                break;
+        }
+    }
+    if (optind < argc) {
+        result = -1;
+    }
+    if (g_duration_ns == 0 && g_resumed_reps >= NUM_REPETITIONS) {
+        // Only a time-boxed run may resume past the fixed repetition count; start fresh
+        g_count00 = g_count01 = g_count10 = g_count11 = 0;
+        g_repetitions_done = 0;
+        g_resumed_reps = 0;
+        result = -1;
+    }
+    return result;
+}
+
+/*
+ * parse_resume_spec
+ *
+ * Parses REPS:C00:C01:C10:C11 and starts the counters from those values.
+ * The counters must add up to REPS. For a run of NUM_REPETITIONS, REPS
+ * must be below it (checked by parse_arguments once -d is known).
+ *
+ * Accepts:
+ *   text - Resume specification
+ *
+ * Returns:
+ *   0 on success, -1 if the specification is malformed (counters unchanged).
+ */
+static int parse_resume_spec(const char *text) {
+    long long values[5];
+    const char *cursor = text;
+
+    for (int i = 0; i < 5; ++i) {
+        char *end = NULL;
+        errno = 0;
+        values[i] = strtoll(cursor, &end, 10);
+        if (errno != 0 || end == cursor || values[i] < 0 || *end != ((i < 4) ? ':' : '\0')) {
+            return -1;
+        }
+        cursor = end + 1;
+    }
+    if (values[1] + values[2] + values[3] + values[4] != values[0]) {
+        return -1;
+    }
+    g_count00 = values[1];
+    g_count01 = values[2];
+    g_count10 = values[3];
+    g_count11 = values[4];
+    g_repetitions_done = values[0];
+    g_resumed_reps = values[0];
+    return 0;
+}
+
+/*
+ * attach_stats_slot
+ *
+ * Maps the shared statistics region and claims the given slot. The
+ * descriptor is closed afterwards; the mapping stays valid. Without a
+ * valid descriptor and index the child runs without live statistics.
+ * With -H the mapping is prefaulted and the slot's pages are locked
+ * (falling back to demand paging if locking is not permitted).
+ *
+ * Accepts:
+ *   slot_fd - Descriptor of the region created by the parent
+ *   slot_index - Slot to use (< STATS_SLOT_COUNT)
+ *
+ * Returns: None
+ */
+static void attach_stats_slot(int slot_fd, long slot_index) {
+    if (slot_fd < 0) {
+        return;
+    }
+    if (slot_index >= 0 && slot_index < STATS_SLOT_COUNT) {
+        struct statfs fs;
+        g_slot_huge = (fstatfs(slot_fd, &fs) == 0 && fs.f_type == HUGETLBFS_MAGIC);
+        // A hugetlbfs mapping is rounded up to whole huge pages by the kernel
+        void *region = mmap(NULL, STATS_REGION_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | (g_prefault_slot ? MAP_POPULATE : 0), slot_fd, 0);
+        if (region == MAP_FAILED) {
+            if (fprintf(stderr, "CHILD [%d]: Error mapping stats slot: %s\r\n", getpid(), strerror(errno)) < 0) { /* Handle error? */ }
+        } else {
+            g_slot = (stats_slot_t *)region + slot_index;
+            if (g_prefault_slot) {
+                long page_size = g_slot_huge ? (long)STATS_HUGE_PAGE_SIZE : sysconf(_SC_PAGESIZE);
+                uintptr_t first = (uintptr_t)g_slot & ~(uintptr_t)(page_size - 1);
+                if (mlock((void *)first, (uintptr_t)(g_slot + 1) - first) == -1) {
+                    if (fprintf(stderr, "CHILD [%d]: Warning: Cannot lock stats slot: %s\r\n", getpid(), strerror(errno)) < 0) { /* Handle error? */ }
+                }
+            }
+            g_slot->total_reps = (g_duration_ns > 0) ? 0 : NUM_REPETITIONS;
+            g_slot->deadline_ns = g_deadline_ns;
+            g_slot->repetitions = g_repetitions_done;
+            g_slot->counts[0] = g_count00;
+            g_slot->counts[1] = g_count01;
+            g_slot->counts[2] = g_count10;
+            g_slot->counts[3] = g_count11;
+            g_slot->round = (g_persistent && g_external_sampler == 0) ? 1 : 0;
+            if (g_external_sampler != 0) {
+                // With Yama ptrace restrictions only ancestors may read our memory; allow the sampler too
+                if (prctl(PR_SET_PTRACER, (unsigned long)g_external_sampler, 0, 0, 0) == -1 && errno != EINVAL) {
+                    if (fprintf(stderr, "CHILD [%d]: Warning: Cannot allow the sampler to read memory: %s\r\n", getpid(), strerror(errno)) < 0) { /* Handle error? */ }
+                }
+                g_slot->pair_addr = (uint64_t)(uintptr_t)&g_shared_pair;
+            }
+            g_slot->pid = getpid(); // Last, so the parent never sees a half-initialized slot
+        }
+    }
+    close(slot_fd);
+}
+
+
+/*
+ * run_externally_sampled
+ *
+ * Main loop for -e: alternates the pair between {0,0} and {1,1} until the
+ * sampler marks the slot done (all repetitions counted, or the deadline of
+ * a time-boxed run passed), then copies the final counters for the
+ * statistics line. The sampler writes the final checkpoint before setting
+ * done, so it is in place once the loop ends.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void run_externally_sampled(void) {
+    int current_state = 0;
+
+    while (!g_slot->done) {
+        if (g_dumps_printed != g_dumps_requested) {
+            print_pending_dumps();
+        }
+        if (current_state == 0) {
+            g_shared_pair.v1 = 0;
+            g_shared_pair.v2 = 0;
+            current_state = 1;
+        } else {
+            g_shared_pair.v1 = 1;
+            g_shared_pair.v2 = 1;
+            current_state = 0;
+        }
+    }
+    atomic_thread_fence(memory_order_acquire);
+    g_count00 = g_slot->counts[0];
+    g_count01 = g_slot->counts[1];
+    g_count10 = g_slot->counts[2];
+    g_count11 = g_slot->counts[3];
+    g_repetitions_done = g_slot->repetitions;
+}
+
+/*
+ * run_finished
+ *
+ * Accepts: None
+ * Returns: 1 once the run is complete (deadline passed for a time-boxed
+ *          run, NUM_REPETITIONS reached otherwise, or the external sampler
+ *          is done), 0 otherwise.
+ */
+static int run_finished(void) {
+    if (g_external_sampler != 0) {
+        return g_slot->done != 0;
+    }
+    if (g_duration_ns > 0) {
+        return monotonic_ns() >= g_deadline_ns;
+    }
+    return g_repetitions_done >= NUM_REPETITIONS;
+}
+
+/*
+ * describe_sched_policy
+ *
+ * Formats the scheduling policy this process is actually running under as
+ * NAME:VALUE, where VALUE is the nice level for normal policies and the
+ * real-time priority for SCHED_FIFO/SCHED_RR.
+ *
+ * Accepts:
+ *   buf - Output buffer
+ *   buf_size - Size of buf in bytes
+ *
+ * Returns: None
+ */
+static void describe_sched_policy(char *buf, size_t buf_size) {
+    int policy = sched_getscheduler(0);
+    int value = 0;
+
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        struct sched_param param;
+        if (sched_getparam(0, &param) == 0) {
+            value = param.sched_priority;
+        }
+    } else {
+        errno = 0;
+        int nice_value = getpriority(PRIO_PROCESS, 0); // -1 is a valid result, check errno
+        if (errno == 0) {
+            value = nice_value;
+        }
+    }
+
+    if (snprintf(buf, buf_size, "%s:%d", sched_policy_name(policy), value) < 0 && buf_size > 0) {
+        buf[0] = '\0';
+    }
+}
+
+/*
+ * monotonic_us
+ *
+ * Returns the current CLOCK_MONOTONIC time in microseconds, or 0 if the
+ * clock cannot be read.
+ *
+ * Accepts: None
+ * Returns: Monotonic time in microseconds.
+ */
+static long long monotonic_us(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
 }
 
 
@@ -181,7 +701,9 @@ static void initialize_globals(void) {
  * handle_alarm
  *
  * Signal handler for SIGALRM. Reads the state of the volatile g_shared_pair,
- * increments the corresponding counter, updates repetition count, and sets the g_alarm_flag.
+ * increments the corresponding counter, updates repetition count, publishes
+ * the counters to the shared slot (if any), and sets the g_alarm_flag.
+ * Its own run time is accumulated for the exit report.
  * This function must be async-signal-safe.
  *
  * Accepts:
@@ -190,8 +712,11 @@ static void initialize_globals(void) {
  * Returns: None
  */
 static void handle_alarm(int sig) {
+    INSTR_TIME_BEGIN(entry_ns);
 
+    TRACE_PROBE1(alarm_entry, g_repetitions_done);
     if (sig == SIGALRM) {
+        INSTR_MARK_INTERVAL(g_instr_interval_ns, entry_ns);
         int local_v1 = g_shared_pair.v1;
         int local_v2 = g_shared_pair.v2;
 
@@ -200,12 +725,72 @@ static void handle_alarm(int sig) {
         else if (local_v1 == 1 && local_v2 == 0) g_count10++;
         else g_count11++;
 
-        if (g_repetitions_done < NUM_REPETITIONS) {
+        if (g_duration_ns > 0 || g_repetitions_done < NUM_REPETITIONS) {
             g_repetitions_done++;
         }
+        if (g_slot != NULL) { // Plain stores to shared memory are async-signal-safe
+            g_slot->counts[0] = g_count00;
+            g_slot->counts[1] = g_count01;
+            g_slot->counts[2] = g_count10;
+            g_slot->counts[3] = g_count11;
+            g_slot->repetitions = g_repetitions_done;
+            if (g_repetitions_done % CHECKPOINT_INTERVAL == 0) {
+                write_checkpoint(CHECKPOINT_PERIODIC);
+            }
+        }
         g_alarm_flag = 1;
+
+        INSTR_TIME_END(g_instr_handler_ns, entry_ns);
+        TRACE_PROBE1(alarm_exit, g_repetitions_done);
+    }
+}
+
+/*
+ * monotonic_ns
+ *
+ * Accepts: None
+ * Returns: CLOCK_MONOTONIC in nanoseconds (0 on failure). Async-signal-safe.
+ */
+static long long monotonic_ns(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+#if INSTRUMENT
+/*
+ * print_instrumentation
+ *
+ * Prints the instrumented build's summaries to stderr: SIGALRM handler run
+ * time, achieved interval between samples and writer loop iterations per
+ * interval (totals over all rounds).
+ *
+ * Accepts:
+ *   pid - The child's PID, for the message prefix
+ *
+ * Returns: None
+ */
+static void print_instrumentation(pid_t pid) {
+    if (g_instr_handler_ns.count > 0) {
+        if (fprintf(stderr, "CHILD [%d]: SIGALRM handler %.0f ns mean, %lld ns min, %lld ns max over %lld calls (slot on %s pages%s).\r\n",
+            pid, instr_stat_mean(&g_instr_handler_ns), g_instr_handler_ns.min, g_instr_handler_ns.max, g_instr_handler_ns.count,
+            g_slot == NULL ? "no" : (g_slot_huge ? "huge" : "normal"), g_prefault_slot ? ", prefaulted and locked" : "") < 0) { /* Handle error? */ }
+    }
+    if (g_instr_interval_ns.count > 0) {
+        if (fprintf(stderr, "CHILD [%d]: Sample interval %.1f us mean, %.1f us min, %.1f us max over %lld intervals.\r\n",
+            pid, instr_stat_mean(&g_instr_interval_ns) / 1000.0, (double)g_instr_interval_ns.min / 1000.0,
+            (double)g_instr_interval_ns.max / 1000.0, g_instr_interval_ns.count) < 0) { /* Handle error? */ }
+    }
+    if (g_instr_loop_iterations.count > 0) {
+        if (fprintf(stderr, "CHILD [%d]: Writer loop %.0f iterations per interval mean, %lld min, %lld max (%lld total).\r\n",
+            pid, instr_stat_mean(&g_instr_loop_iterations), g_instr_loop_iterations.min, g_instr_loop_iterations.max,
+            g_instr_loop_iterations.total) < 0) { /* Handle error? */ }
     }
 }
+#endif
 
 /*
  * handle_usr_signals
@@ -219,6 +804,7 @@ static void handle_alarm(int sig) {
  * Returns: None
  */
 static void handle_usr_signals(int sig) {
+    TRACE_PROBE3(signal_receive, sig, 0, 0);
 
     if (sig == SIGUSR1) {
         g_output_enabled = 1;
@@ -228,17 +814,290 @@ static void handle_usr_signals(int sig) {
 }
 
 
+/*
+ * handle_term
+ *
+ * Signal handler for SIGTERM. Checkpoints the counters, then terminates
+ * with the default action so the parent still sees death by SIGTERM. A
+ * round that has already written its final checkpoint (e.g. a persistent
+ * child waiting between rounds) keeps it, so the parent still collects
+ * the round as finished rather than as a partial result.
+ * This function must be async-signal-safe.
+ *
+ * Accepts:
+ *   sig - The signal number (expected: SIGTERM)
+ *
+ * Returns: None
+ */
+static void handle_term(int sig) {
+    TRACE_PROBE3(signal_receive, sig, 0, 0);
+    if (!g_final_checkpointed) {
+        write_checkpoint(CHECKPOINT_SIGTERM);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/*
+ * handle_command
+ *
+ * SA_SIGINFO handler for CHILD_COMMAND_SIGNAL. Runs once per queued
+ * command, in the order they were sent. A new interval applies from the
+ * next timer re-arm; a reset starts the counters, repetitions and elapsed
+ * time over (a time-boxed run keeps its deadline) and checkpoints the
+ * zeroed counters; a dump is recorded for main to print, since stdio is
+ * not async-signal-safe. A pause report (queued by the parent before its
+ * SIGCONT) is added to the paused time and moves the deadline of a
+ * time-boxed run, then releases the slot to the sampler. The pending
+ * SIGALRM of a timer that expired while stopped is delivered first (lower
+ * signal number), before main checks the deadline again; the interval it
+ * recorded across the pause is taken back out of the statistics. A next-round
+ * command releases a persistent child waiting between rounds. Interval and
+ * reset are ignored under -e, where
+ * the sampler owns the rate and the counters. SIGALRM and SIGTERM are
+ * blocked while it runs. This function must be async-signal-safe.
+ *
+ * Accepts:
+ *   sig - The signal number (expected: CHILD_COMMAND_SIGNAL)
+ *   info - Sender and payload
+ *   context - Unused
+ *
+ * Returns: None
+ */
+static void handle_command(int sig, siginfo_t *info, void *context) {
+    int arg;
+    int command = child_command_decode(info->si_value.sival_int, &arg);
+
+    (void)context;
+    TRACE_PROBE3(signal_receive, sig, info->si_pid, info->si_value.sival_int);
+    g_commands_received++;
+    if (info->si_code != SI_QUEUE) { // A plain kill() carries no payload
+        g_commands_ignored++;
+        return;
+    }
+    switch (command) {
+        case CHILD_COMMAND_SET_INTERVAL:
+            if (g_external_sampler != 0 || arg < CHILD_COMMAND_INTERVAL_MIN_US || arg > CHILD_COMMAND_INTERVAL_MAX_US) {
+                g_commands_ignored++;
+                break;
+            }
+            g_alarm_interval_us = arg;
+            break;
+        case CHILD_COMMAND_RESET_COUNTERS:
+            if (g_external_sampler != 0 || g_round_waiting) { // Would overwrite the round the parent has not collected
+                g_commands_ignored++;
+                break;
+            }
+            reset_measurement();
+            break;
+        case CHILD_COMMAND_DUMP_STATS:
+            g_dump_tags[g_dumps_requested % DUMP_TAG_SLOTS] = arg;
+            g_dumps_requested++;
+            break;
+        case CHILD_COMMAND_PAUSED:
+            g_paused_us += (long long)arg * 1000LL;
+            INSTR_PAUSED_INTERVAL(g_instr_interval_ns, (long long)arg * 1000000LL); // Even if the held SIGALRM already marked across it
+            if (g_duration_ns > 0) {
+                g_deadline_ns += (long long)arg * 1000000LL; // The time box counts running time only
+            }
+            if (g_slot != NULL) {
+                g_slot->deadline_ns = g_deadline_ns;
+                atomic_thread_fence(memory_order_release); // New deadline before the sampler resumes
+                g_slot->paused = 0;
+            }
+            break;
+        case CHILD_COMMAND_NEXT_ROUND:
+            if (!g_persistent) {
+                g_commands_ignored++;
+                break;
+            }
+            g_rounds_released++; // wait_for_next_round() starts the round
+            break;
+        default:
+            g_commands_ignored++;
+            break;
+    }
+}
+
+/*
+ * print_pending_dumps
+ *
+ * Prints one stats line to stderr per dump request received since the
+ * last call, tagged with the request's argument. Called from main between
+ * samples.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void print_pending_dumps(void) {
+    sigset_t mask, saved_mask;
+    long long counts[4];
+    long long reps;
+
+    // Take a consistent copy: the alarm and command handlers change the counters
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigaddset(&mask, CHILD_COMMAND_SIGNAL);
+    sigprocmask(SIG_BLOCK, &mask, &saved_mask);
+    if (g_external_sampler != 0) {
+        for (int i = 0; i < 4; ++i) {
+            counts[i] = g_slot->counts[i];
+        }
+        reps = g_slot->repetitions;
+    } else {
+        counts[0] = g_count00;
+        counts[1] = g_count01;
+        counts[2] = g_count10;
+        counts[3] = g_count11;
+        reps = g_repetitions_done;
+    }
+    sig_atomic_t requested = g_dumps_requested;
+    long long elapsed_us = monotonic_us() - g_run_start_us - g_paused_us;
+    int interval_us = g_alarm_interval_us;
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+
+    if (requested - g_dumps_printed > DUMP_TAG_SLOTS) { // Older tags were overwritten
+        g_dumps_printed = requested - DUMP_TAG_SLOTS;
+    }
+    while (g_dumps_printed != requested) {
+        if (fprintf(stderr, "CHILD [%d]: Dump %d: REPS=%lld, STATS={00:%lld, 01:%lld, 10:%lld, 11:%lld}, ELAPSED_US=%lld, INTERVAL_US=%d\r\n",
+            getpid(), g_dump_tags[g_dumps_printed % DUMP_TAG_SLOTS], reps,
+            counts[0], counts[1], counts[2], counts[3], elapsed_us, interval_us) < 0) { /* Handle error? */ }
+        g_dumps_printed++;
+    }
+    if (fflush(stderr) == EOF) { /* Handle error? */ }
+}
+
+/*
+ * write_checkpoint
+ *
+ * Writes the current counters as a checkpoint into the shared slot, if
+ * there is one and the child samples itself. Runs from the SIGALRM,
+ * SIGTERM and command handlers (which block each other) and from main
+ * after the loop with all three blocked.
+ * Async-signal-safe.
+ *
+ * Accepts:
+ *   reason - checkpoint_reason_t value
+ *
+ * Returns: None
+ */
+static void write_checkpoint(int reason) {
+    checkpoint_data_t data;
+
+    if (g_slot == NULL || g_external_sampler != 0) {
+        return; // The external sampler owns the slot's checkpoints
+    }
+    data.reason = reason;
+    data.repetitions = g_repetitions_done;
+    data.counts[0] = g_count00;
+    data.counts[1] = g_count01;
+    data.counts[2] = g_count10;
+    data.counts[3] = g_count11;
+    stats_checkpoint_write(g_slot, &data);
+    g_final_checkpointed = (reason == CHECKPOINT_FINAL);
+}
+
+/*
+ * reset_measurement
+ *
+ * Starts the counters, repetitions and elapsed time over and checkpoints
+ * the zeroed counters. Used by the reset command and between the rounds of
+ * a persistent child. Runs with SIGALRM, SIGTERM and the command signal
+ * blocked (from the command handler, or from main). Async-signal-safe.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void reset_measurement(void) {
+    g_count00 = 0;
+    g_count01 = 0;
+    g_count10 = 0;
+    g_count11 = 0;
+    g_repetitions_done = 0;
+    g_resumed_reps = 0;
+    g_run_start_us = monotonic_us();
+    g_paused_us = 0;
+    INSTR_RESTART_INTERVAL(g_instr_interval_ns);
+    if (g_slot != NULL) {
+        for (int i = 0; i < 4; ++i) {
+            g_slot->counts[i] = 0;
+        }
+        g_slot->repetitions = 0;
+    }
+    write_checkpoint(CHECKPOINT_PERIODIC);
+}
+
+/*
+ * wait_for_next_round
+ *
+ * Ends a round of a persistent child (-M). The round's final checkpoint is
+ * already in the slot; the child tells the parent (CHILD_ROUND_SIGNAL with
+ * the round number) and sleeps until the parent, having collected it,
+ * queues CHILD_COMMAND_NEXT_ROUND. Then the measurement starts over; the
+ * zeroed checkpoint is written before the slot's round advances, so the
+ * parent never takes a collected round for a new one. A time-boxed round
+ * gets a new deadline. A counter reset arriving while the child waits is
+ * ignored: it would overwrite the final checkpoint not yet collected.
+ *
+ * Accepts:
+ *   round - Round just completed (1-based)
+ *
+ * Returns: 1 when the next round starts, 0 if the child should exit (not
+ *          persistent, last round, or the parent could not be told).
+ */
+static int wait_for_next_round(int round) {
+    sigset_t mask, saved_mask;
+    union sigval value;
+
+    if (!g_persistent || (g_round_limit > 0 && round >= g_round_limit)) {
+        return 0;
+    }
+
+    // Blocked from before the notification, so the command cannot slip in ahead of sigsuspend()
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, CHILD_COMMAND_SIGNAL);
+    sigprocmask(SIG_BLOCK, &mask, &saved_mask);
+    sig_atomic_t released = g_rounds_released;
+    value.sival_int = round;
+    if (sigqueue(getppid(), CHILD_ROUND_SIGNAL, value) == -1) {
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        if (fprintf(stderr, "CHILD [%d]: Warning: Cannot report round %d to the parent (%s); exiting.\r\n",
+            getpid(), round, strerror(errno)) < 0) { /* Handle error? */ }
+        return 0;
+    }
+    g_round_waiting = 1;
+    while (g_rounds_released == released) {
+        sigsuspend(&saved_mask); // SIGTERM still ends the child here, keeping this round's final checkpoint
+    }
+    g_round_waiting = 0;
+
+    reset_measurement();
+    if (g_duration_ns > 0) {
+        g_deadline_ns = monotonic_ns() + g_duration_ns;
+        g_slot->deadline_ns = g_deadline_ns;
+    }
+    atomic_thread_fence(memory_order_release); // Zeroed checkpoint before the new round number
+    g_slot->round = round + 1;
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    return 1;
+}
+
 /*
  * register_signal_handlers
  *
- * Configures the signal handlers for SIGALRM, SIGUSR1, and SIGUSR2 using sigaction.
+ * Configures the signal handlers for SIGALRM, SIGUSR1, SIGUSR2, SIGTERM
+ * and CHILD_COMMAND_SIGNAL using sigaction. SIGALRM, SIGTERM and the
+ * command signal block each other, since all three write checkpoints.
  *
  * Accepts: None
  * Returns:
  *   0 on success, -1 on failure (prints error message).
  */
 static int register_signal_handlers(void) {
-    struct sigaction sa_alarm, sa_usr;
+    struct sigaction sa_alarm, sa_usr, sa_term, sa_command;
     pid_t my_pid = getpid();
 
 
@@ -249,7 +1108,8 @@ static int register_signal_handlers(void) {
         fprintf(stderr, "CHILD [%d]: Error initializing alarm signal mask: %s\r\n", my_pid, strerror(errno));
         return -1;
     }
-    if (sigaddset(&sa_alarm.sa_mask, SIGALRM) == -1) {
+    if (sigaddset(&sa_alarm.sa_mask, SIGALRM) == -1 || sigaddset(&sa_alarm.sa_mask, SIGTERM) == -1 ||
+        sigaddset(&sa_alarm.sa_mask, CHILD_COMMAND_SIGNAL) == -1) {
         // Using \r\n for consistency
         fprintf(stderr, "CHILD [%d]: Error adding SIGALRM to alarm signal mask: %s\r\n", my_pid, strerror(errno));
         return -1;
@@ -288,14 +1148,48 @@ static int register_signal_handlers(void) {
         return -1;
     }
 
+
+    memset(&sa_term, 0, sizeof(sa_term));
+    sa_term.sa_handler = handle_term;
+    if (sigemptyset(&sa_term.sa_mask) == -1 || sigaddset(&sa_term.sa_mask, SIGALRM) == -1 ||
+        sigaddset(&sa_term.sa_mask, CHILD_COMMAND_SIGNAL) == -1) {
+        // Using \r\n for consistency
+        fprintf(stderr, "CHILD [%d]: Error initializing term signal mask: %s\r\n", my_pid, strerror(errno));
+        return -1;
+    }
+    sa_term.sa_flags = 0;
+
+    if (sigaction(SIGTERM, &sa_term, NULL) == -1) {
+        // Using \r\n for consistency
+        fprintf(stderr, "CHILD [%d]: Error setting SIGTERM handler: %s\r\n", my_pid, strerror(errno));
+        return -1;
+    }
+
+
+    memset(&sa_command, 0, sizeof(sa_command));
+    sa_command.sa_sigaction = handle_command;
+    if (sigemptyset(&sa_command.sa_mask) == -1 || sigaddset(&sa_command.sa_mask, SIGALRM) == -1 ||
+        sigaddset(&sa_command.sa_mask, SIGTERM) == -1) {
+        // Using \r\n for consistency
+        fprintf(stderr, "CHILD [%d]: Error initializing command signal mask: %s\r\n", my_pid, strerror(errno));
+        return -1;
+    }
+    sa_command.sa_flags = SA_SIGINFO | SA_RESTART; // The payload is the command
+
+    if (sigaction(CHILD_COMMAND_SIGNAL, &sa_command, NULL) == -1) {
+        // Using \r\n for consistency
+        fprintf(stderr, "CHILD [%d]: Error setting command signal handler: %s\r\n", my_pid, strerror(errno));
+        return -1;
+    }
+
     return 0;
 }
 
 /*
  * setup_timer
  *
- * Configures a one-shot timer using setitimer to send SIGALRM after
- * ALARM_INTERVAL_US microseconds.
+ * Configures a one-shot timer using setitimer to send SIGALRM after the
+ * current sample interval (ALARM_INTERVAL_US unless the parent changed it).
  *
  * Accepts: None
  * Returns:
@@ -305,7 +1199,7 @@ static int setup_timer(void) {
     struct itimerval timer;
 
     timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = ALARM_INTERVAL_US;
+    timer.it_value.tv_usec = g_alarm_interval_us;
     timer.it_interval.tv_sec = 0;  // One-shot timer
     timer.it_interval.tv_usec = 0; // One-shot timer
 
@@ -0,0 +1,66 @@
+/*
+ * child_command.h
+ *
+ * Command channel from the parent to running children. The parent sends
+ * CHILD_COMMAND_SIGNAL with sigqueue(); the payload (sival_int) carries a
+ * command in its top byte and an argument in the low 24 bits. Unlike
+ * SIGUSR1/SIGUSR2, queued real-time signals are not merged: a burst of
+ * commands is delivered in order, one handler call each, up to the
+ * receiver's RLIMIT_SIGPENDING (sigqueue() then fails with EAGAIN).
+ *
+ * A persistent child (-M) signals the other way when it completes a round:
+ * CHILD_ROUND_SIGNAL to the parent with the round number as sival_int. It
+ * then waits for CHILD_COMMAND_NEXT_ROUND.
+ */
+#ifndef CHILD_COMMAND_H
+#define CHILD_COMMAND_H
+
+#include <signal.h>
+
+
+#define CHILD_COMMAND_SIGNAL (SIGRTMIN + 0)
+#define CHILD_ROUND_SIGNAL (SIGRTMIN + 2)    // Child to parent: round complete (the parent times thread workers on SIGRTMIN + 1)
+#define CHILD_COMMAND_ARG_MASK 0xFFFFFF
+#define CHILD_COMMAND_INTERVAL_MIN_US 10     // Shortest sample interval a child accepts
+#define CHILD_COMMAND_INTERVAL_MAX_US 999999 // setitimer() takes it in tv_usec alone
+
+
+// Commands carried in the payload's top byte.
+typedef enum child_command_e {
+    CHILD_COMMAND_NONE = 0,
+    CHILD_COMMAND_SET_INTERVAL,   // Argument: sample interval in microseconds
+    CHILD_COMMAND_RESET_COUNTERS, // Start the measurement over (argument unused)
+    CHILD_COMMAND_DUMP_STATS,     // Print the current counters; argument echoed as a tag
+    CHILD_COMMAND_PAUSED,         // The parent stopped the child for ARG milliseconds (SIGSTOP/SIGCONT)
+    CHILD_COMMAND_NEXT_ROUND      // Start the next round of a persistent child; argument: its number
+} child_command_t;
+
+
+/*
+ * child_command_encode
+ *
+ * Accepts:
+ *   command - child_command_t value
+ *   arg - Argument, truncated to 24 bits
+ *
+ * Returns: The sigqueue() payload.
+ */
+static inline int child_command_encode(int command, int arg) {
+    return (int)(((unsigned)command << 24) | ((unsigned)arg & CHILD_COMMAND_ARG_MASK));
+}
+
+/*
+ * child_command_decode
+ *
+ * Accepts:
+ *   payload - sival_int of a received CHILD_COMMAND_SIGNAL
+ *   arg - Output: argument
+ *
+ * Returns: The command (child_command_t value). Async-signal-safe.
+ */
+static inline int child_command_decode(int payload, int *arg) {
+    *arg = (int)((unsigned)payload & CHILD_COMMAND_ARG_MASK);
+    return (int)(((unsigned)payload >> 24) & 0xFFU);
+}
+
+#endif // CHILD_COMMAND_H
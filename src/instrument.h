@@ -0,0 +1,189 @@
+/*
+ * instrument.h
+ *
+ * Compile-time instrumentation for profiling builds (make profile-build,
+ * and debug builds). With INSTRUMENT set to 1 the hooks below time the
+ * child's SIGALRM handler, the interval between samples and count the
+ * writer loop's iterations per interval. Otherwise (release builds) every
+ * hook expands to nothing, so the hot paths compile exactly as if the hook
+ * lines were absent; make verify-release checks this by compiling a copy
+ * of the source with the hook lines deleted and comparing the machine code.
+ *
+ * Hooks must stay on lines of their own (the verification deletes them by
+ * pattern), and nothing outside them may refer to their variables except
+ * code under #if INSTRUMENT.
+ */
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#ifndef INSTRUMENT
+#define INSTRUMENT 0
+#endif
+
+#if INSTRUMENT
+
+#include <time.h>
+#include <limits.h> // For LLONG_MAX
+
+
+// Running summary of one measured quantity.
+typedef struct instr_stat_s {
+    long long count;
+    long long total;
+    long long min;
+    long long max;
+    long long last_ns; // Previous mark, for INSTR_MARK_INTERVAL
+    long long last_value; // Interval the previous mark added, -1 if none
+    long long prev_min; // min and max before that interval, to take it back
+    long long prev_max;
+} instr_stat_t;
+
+/*
+ * instr_now_ns
+ *
+ * Accepts: None
+ * Returns: CLOCK_MONOTONIC in nanoseconds (0 on failure). Async-signal-safe.
+ */
+static inline long long instr_now_ns(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * instr_stat_add
+ *
+ * Adds one value to a summary. Async-signal-safe; callers never update the
+ * same summary from a handler and the code it interrupted.
+ *
+ * Accepts:
+ *   stat - Summary to update
+ *   value - Measured value
+ *
+ * Returns: None
+ */
+static inline void instr_stat_add(volatile instr_stat_t *stat, long long value) {
+    if (stat->count == 0 || value < stat->min) {
+        stat->min = value;
+    }
+    if (value > stat->max) {
+        stat->max = value;
+    }
+    stat->total += value;
+    stat->count++;
+}
+
+/*
+ * instr_stat_reset
+ *
+ * Accepts:
+ *   stat - Summary to empty
+ *
+ * Returns: None
+ */
+static inline void instr_stat_reset(volatile instr_stat_t *stat) {
+    stat->count = 0;
+    stat->total = 0;
+    stat->min = 0;
+    stat->max = 0;
+    stat->last_ns = 0;
+    stat->last_value = -1;
+    stat->prev_min = 0;
+    stat->prev_max = 0;
+}
+
+/*
+ * instr_interval_paused
+ *
+ * Leaves a pause of the process out of an interval summary. If the last
+ * mark was taken before the pause, the next interval would span it, so the
+ * series starts over. If it was taken after the pause (a timer signal held
+ * while stopped is delivered before the pause is reported), the interval
+ * it added spans the pause and is taken back. Async-signal-safe; callers
+ * block the marking handler while this runs.
+ *
+ * Accepts:
+ *   stat - Interval summary
+ *   paused_ns - Length of the pause
+ *
+ * Returns: None
+ */
+static inline void instr_interval_paused(volatile instr_stat_t *stat, long long paused_ns) {
+    if (stat->last_ns == 0 || instr_now_ns() - stat->last_ns >= paused_ns) {
+        stat->last_ns = 0;
+        return;
+    }
+    if (stat->last_value >= 0) {
+        stat->total -= stat->last_value;
+        stat->count--;
+        stat->min = (stat->count > 0) ? stat->prev_min : 0;
+        stat->max = (stat->count > 0) ? stat->prev_max : 0;
+        stat->last_value = -1;
+    }
+}
+
+/*
+ * instr_stat_mean
+ *
+ * Accepts:
+ *   stat - Summary to read
+ *
+ * Returns: The mean value, 0 if nothing was added.
+ */
+static inline double instr_stat_mean(const volatile instr_stat_t *stat) {
+    return (stat->count > 0) ? (double)stat->total / (double)stat->count : 0.0;
+}
+
+// File scope: a summary
+#define INSTR_DEFINE(name) static volatile instr_stat_t name
+#define INSTR_RESET(name) instr_stat_reset(&(name))
+// Function scope: remember the current time in a new local
+#define INSTR_TIME_BEGIN(var) long long var = instr_now_ns()
+// Add the time since INSTR_TIME_BEGIN(var) to a summary
+#define INSTR_TIME_END(name, var) instr_stat_add(&(name), instr_now_ns() - (var))
+// Add the time since the previous mark (taken at time now_ns) to a summary
+#define INSTR_MARK_INTERVAL(name, now_ns) \
+    do { \
+        if ((name).last_ns != 0) { \
+            (name).prev_min = (name).min; \
+            (name).prev_max = (name).max; \
+            (name).last_value = (now_ns) - (name).last_ns; \
+            instr_stat_add(&(name), (name).last_value); \
+        } else { \
+            (name).last_value = -1; \
+        } \
+        (name).last_ns = (now_ns); \
+    } while (0)
+// The next mark starts a new series (after a pause in the measurement)
+#define INSTR_RESTART_INTERVAL(name) ((name).last_ns = 0)
+// The process was stopped for paused_ns; see instr_interval_paused
+#define INSTR_PAUSED_INTERVAL(name, paused_ns) instr_interval_paused(&(name), (paused_ns))
+// Function scope: a new local iteration counter, and its increment
+#define INSTR_COUNTER(var) long long var = 0
+#define INSTR_COUNT(var) (var)++
+// Add a counter to a summary and start it over
+#define INSTR_COUNTER_FLUSH(name, var) \
+    do { \
+        instr_stat_add(&(name), (var)); \
+        (var) = 0; \
+    } while (0)
+
+#else // Not instrumented: the hooks are empty
+
+#define INSTR_DEFINE(name) struct instr_unused_s
+#define INSTR_RESET(name) do { } while (0)
+#define INSTR_TIME_BEGIN(var) do { } while (0)
+#define INSTR_TIME_END(name, var) do { } while (0)
+#define INSTR_MARK_INTERVAL(name, now_ns) do { } while (0)
+#define INSTR_RESTART_INTERVAL(name) do { } while (0)
+#define INSTR_PAUSED_INTERVAL(name, paused_ns) do { } while (0)
+#define INSTR_COUNTER(var) do { } while (0)
+#define INSTR_COUNT(var) do { } while (0)
+#define INSTR_COUNTER_FLUSH(name, var) do { } while (0)
+
+#endif
+
+#endif // INSTRUMENT_H
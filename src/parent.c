@@ -5,10 +5,61 @@
  * Parent process for managing child processes based on keyboard input.
  * Spawns children ('+'), deletes the last one ('-'), lists all ('l'),
  * kills all ('k'), enables child output ('1'), disables child output ('2'),
- * or quits ('q').
+ * cycles the scheduling policy for new children ('s'), or quits ('q').
+ * Running children also take queued real-time signal commands: a new
+ * sample interval ('i'), a counter reset ('0') and a stats dump ('v').
+ * The whole fleet can be stopped ('p') and continued ('c') without killing
+ * it; paused time is tracked per child and left out of the children's
+ * interval statistics.
  * Children execute the 'child' program found via the CHILD_PATH env variable.
+ * Commands can be recorded with monotonic timestamps into a session file
+ * and replayed later at original or scaled speed. A churn generator mode
+ * issues spawn/kill/broadcast operations at a configured rate and mix to
+ * stress the registry, reaping and signaling paths.
+ * Exited children are reaped from the main loop (the SIGCHLD handler only
+ * timestamps the notification), so zombie lifetime and reap backlog can be
+ * measured ('z'). Every tracked child carries a lifecycle state
+ * (starting, running, signaled, exited, reaped) with per-state counters.
+ * Child stderr is captured through pipes, timestamped and written out in
+ * batches (to the terminal or a log file) under a line rate limit.
+ * Children publish live counters in a shared memory slot, which feeds a
+ * full-screen dashboard ('d') redrawn with differential updates.
+ * Children checkpoint their counters into the slot; checkpoints of
+ * children that did not finish are kept as partial results, included in
+ * the aggregate ('a'), resumable ('r') and persisted across runs (-K).
+ * Every reaped child can be appended to a binary results store (-o) with
+ * a block-summary index, which query mode (-q) filters and aggregates
+ * without reading blocks the index already summarizes. Two stores (-A, -B)
+ * can be compared run by run with Welch's t-test; significant regressions
+ * make the parent exit with AB_EXIT_REGRESSION. With -e, a sampler
+ * process reads each child's pair from outside with process_vm_readv()
+ * instead of the child sampling itself from a timer. The stats region can
+ * be put on huge pages, prefaulted and locked (-H). Runs can be time-boxed
+ * (-t) instead of lasting a fixed number of repetitions. With -P, spawns
+ * requested while the host is under CPU or memory pressure (Linux PSI
+ * triggers) are deferred until the pressure subsides. Children are created with clone3() where the kernel
+ * has it: the parent gets a pidfd for each child at birth (used for all
+ * signals), and with -C the child starts inside a cgroup v2 directory.
+ * With -M, children are persistent: they run several rounds, and the
+ * parent collects each round and starts the next one with a command.
+ * With -S, children are created by a small spawn helper forked at startup,
+ * so their creation does not copy the parent's growing address space.
+ * With -T, '+' starts the child's workload as a thread of the parent
+ * instead (a pair, a per-thread timer and its own stats slot), so process
+ * and thread fleets can be compared at sizes set with -N.
+ * With -O the parent is a child subreaper: processes the children fork are
+ * found in the process tree and tracked as descendants, and orphans are
+ * re-adopted by the parent, which reaps and accounts for them.
+ * 'H' restarts the parent in place: the registry, the children's pipes and
+ * pidfds and the stats region are passed through a memfd to a re-executed
+ * parent binary, which re-adopts the running fleet, so the parent can be
+ * upgraded without losing in-flight runs.
+ * Static tracepoints (trace_probe.h) mark spawn, exec confirmation, every
+ * signal sent to a child, signals received, reaping and teardown, for
+ * perf probe and bpftrace.
  */
 #define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE // Required for SCHED_BATCH and SCHED_IDLE (Linux-specific policies)
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -17,21 +68,684 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/resource.h> // For setpriority
+#include <sched.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <time.h>
+#include <limits.h> // For UCHAR_MAX
+#include <dirent.h>
 #include <errno.h>
 #include <stdint.h> // For SIZE_MAX
+#include <math.h>   // For sqrt, lgamma (A/B comparison)
+#include <sys/mman.h>
+#include <sys/ioctl.h> // For TIOCGWINSZ
+#include <sys/stat.h>
+#include <sys/uio.h>   // For process_vm_readv
+#include <sys/prctl.h> // For PR_SET_PDEATHSIG
+#include <sys/syscall.h> // For SYS_clone3, SYS_pidfd_send_signal
+#include <sys/vfs.h>     // For fstatfs
+#include <linux/sched.h> // For struct clone_args, CLONE_PIDFD, CLONE_INTO_CGROUP
+#include <linux/magic.h> // For CGROUP2_SUPER_MAGIC
+#include <pthread.h>     // Thread workers (-T)
+#include <sys/socket.h>  // Spawn helper requests and SCM_RIGHTS (-S)
+
+#include "stats_slot.h"
+#include "child_command.h"
+#include "sched_policy.h"
+#include "trace_probe.h"
 
 
 #define CHILD_PROG_NAME "child"
 #define INITIAL_CHILD_CAPACITY 8
 #define MAX_PATH_LEN 1024
+#define SCHED_NAME_LEN 32
+#define SESSION_COMMANDS "+-lk12szarqi0vpc" // Commands that are recorded and may be replayed
+#define SESSION_HEADER "# lab03 session v1\n# offset_ns command\n"
+#define SESSION_LINE_LEN 128
+#define CHURN_DEFAULT_RATE 100.0    // Operations per second
+#define CHURN_DEFAULT_MIX "40:20:20:20" // spawn:kill-last:kill-random:broadcast weights
+#define CHURN_SETTLE_NS 250000000LL  // Let killed children die and be reaped before checking
+#define KILL_GRACE_NS 1000000000LL   // A child sent SIGTERM gets SIGKILL if still alive this much later
+                                     // (long enough for a busy CPU to schedule it)
+#define EXIT_REAP_TIMEOUT_NS 2000000000LL // Longest wait for the children killed on exit to be reaped
+#define PROC_STAT_LEN 512
+#define EXIT_NOTE_RING 1024   // Per-child SIGCHLD notifications kept between reaper passes
+#define HISTOGRAM_BUCKETS 24  // log2 buckets: [0,1), [1,2), [2,4), ... [2^22, inf)
+#define POLL_SIGCHLD 0        // Fixed slots at the start of g_pollfds
+#define POLL_STDIN 1
+#define POLL_PSI_CPU 2        // PSI trigger fds (POLLPRI), -1 when not watched
+#define POLL_PSI_MEMORY 3
+#define POLL_WORKERS 4        // Finished thread workers (-T), -1 when unused
+#define POLL_FIXED_FDS 5
+#define LIST_LINE_LEN 160     // Upper bound of one child line in the 'l' output
+#define REAPED_RECENT_MAX 16  // Reaped children 'l' still lists with their exit status
+#define ERR_LINE_LEN 256      // Longest captured child stderr line; longer lines are split
+#define LOG_BATCH_SIZE 65536  // Captured child output is written in chunks of up to this size
+#define LOG_FLUSH_NS 50000000LL // Longest time a captured line waits in the batch
+#define LOG_DEFAULT_TTY_RATE 200.0 // Lines per second to the terminal unless -l is given
+#define LOG_RECENT_LINES 4    // Captured lines shown at the bottom of the dashboard
+#define DASH_DEFAULT_HZ 4.0   // Dashboard refresh rate unless -D is given
+#define DASH_MAX_COLS 512     // Wider terminals are drawn at this width
+#define DASH_HEADER_ROWS 6    // Summary rows above the per-child table
+#define DASH_BAR_WIDTH 20     // Width of the per-child progress bar
+#define DASH_RATE_SMOOTHING 0.3 // Weight of the newest frame in the spawn/reap rate averages
+#define CHECKPOINT_HEADER "# lab03 checkpoints v1\n# repetitions c00 c01 c10 c11 policy\n"
+#define CHECKPOINT_LINE_LEN 160
+#define AGGREGATE_LIST_MAX 10 // Partial results listed individually by 'a'
+#define SAMPLER_RESCAN_NS 10000000LL // 10 ms between scans of the stats region for new children
+#define SAMPLER_MAX_HZ 100000.0
+#define PSI_WINDOW_US 2000000LL      // Trigger window; unprivileged triggers need a multiple of 2 s
+// Spawns stay deferred this long after the last pressure event. A trigger fires at most once per
+// window while pressure lasts, so the hold spans two windows to bridge the gap between events.
+#define PSI_HOLD_NS (2 * PSI_WINDOW_US * 1000LL)
+#define PSI_POLL_NS 500000000LL      // Sampling period when triggers are unavailable
+#define PSI_RELEASE_NS 20000000LL    // Deferred spawns are released one per 20 ms
+#define PSI_RESOURCES 2              // cpu, memory
+#define WORKER_REPETITIONS 10001     // Same run length as the child's NUM_REPETITIONS
+#define WORKER_INTERVAL_US 500       // Same sample interval as the child's ALARM_INTERVAL_US
+#define WORKER_STACK_SIZE (64 * 1024) // A worker needs little stack; keeps 100k threads affordable
+#define WORKER_LIST_MAX 20           // Thread workers listed individually by 'l'
+#define WORKER_TIMER_SIGNAL (SIGRTMIN + 1) // Per-thread timer signal (CHILD_COMMAND_SIGNAL is SIGRTMIN)
+#define DESCENDANT_SCAN_NS 250000000LL // Default period of the process tree scan for descendants (-O)
+#define DESCENDANT_SCAN_MAX_MS 60000LL // Longest period accepted by -O
+#define DESCENDANT_SCAN_MAX 256        // Children read per process in one scan
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid // glibc before 2.41 does not name the SIGEV_THREAD_ID target
+#endif
+#define RESULTS_MAGIC "LAB03RS1"       // Results file header
+#define RESULTS_INDEX_MAGIC "LAB03IX1" // Index file header
+#define RESULTS_VERSION 1
+#define RESULTS_BYTE_ORDER 0x01020304U // Files are only read on machines with the same layout
+#define RESULTS_BLOCK_RECORDS 4096     // Records summarized by one index entry
+#define RESULTS_INDEX_SUFFIX ".idx"
+#define RESULT_COMPLETE 0x1U           // Child finished all repetitions
+#define RESULT_RESUMED 0x2U            // Child resumed from a checkpoint
+#define RESULT_THREAD 0x4U             // Thread worker (-T); pid is its TID, usage its own thread's
+#define QUERY_MAX_GROUPS 64
+#define QUERY_CHUNK_RECORDS 4096       // Records read per pread when scanning a whole file
+#define AB_METRIC_COUNT 3
+#define AB_ALPHA 0.05                  // Two-sided significance level (95% intervals)
+#define AB_EXIT_REGRESSION 2           // Exit status when the candidate regresses significantly
+#define RESTART_ENV "LAB03_RESTART_FD" // Image memfd passed to the re-executed parent ('H')
+#define RESTART_MAGIC "LAB03HR1"       // Hot restart image header
+#define RESTART_VERSION 2              // Bump when the image layout changes
+
+
+/*
+ * Scheduling policy applied to a child between fork() and execv().
+ * 'value' is the nice level for SCHED_OTHER/SCHED_BATCH/SCHED_IDLE and
+ * the real-time priority for SCHED_FIFO/SCHED_RR.
+ */
+typedef struct sched_spec_s {
+    int policy;
+    int value;
+} sched_spec_t;
+
+
+// What a new child needs to exec itself (exec_child()). Also the request sent to
+// the spawn helper (-S); its descriptors travel alongside it as SCM_RIGHTS.
+typedef struct child_exec_s {
+    int exec_fd;               // Write end of the close-on-exec status pipe
+    int err_fd;                // Write end of the stderr pipe, becomes the child's stderr
+    int stats_fd;              // Stats region, -1 if the child has no slot
+    int cgroup_fd;             // Spawn cgroup (-C) for CLONE_INTO_CGROUP, -1 if none
+    int slot;
+    int huge_pages;
+    pid_t sampler_pid;         // External sampler (-e), 0 if none
+    double duration_s;         // Time-boxed run (-t), 0 otherwise
+    int rounds;                // Rounds of a persistent child (-M), 0 until stopped, -1 if not persistent
+    sched_spec_t sched;
+    int resumed;               // resume holds the checkpoint to continue from
+    checkpoint_data_t resume;
+} child_exec_t;
+
+
+// Spawn helper's answer to a request; the child's pidfd travels alongside it.
+typedef struct spawn_reply_s {
+    pid_t pid;                 // -1 if the child could not be created
+    int error;                 // errno of the failure
+} spawn_reply_t;
+
+
+// Policies the 's' command cycles through, in order.
+static const sched_spec_t g_sched_presets[] = {
+    { SCHED_OTHER, 0 },
+    { SCHED_OTHER, 10 },
+    { SCHED_BATCH, 0 },
+    { SCHED_IDLE, 0 },
+    { SCHED_FIFO, 1 },
+    { SCHED_RR, 1 },
+};
+#define SCHED_PRESET_COUNT (sizeof(g_sched_presets) / sizeof(g_sched_presets[0]))
+
+
+// Sample intervals (microseconds) the 'i' command cycles running children through, in order.
+// The children start at 500 us.
+static const int g_interval_presets_us[] = { 250, 1000, 2000, 500 };
+#define INTERVAL_PRESET_COUNT (sizeof(g_interval_presets_us) / sizeof(g_interval_presets_us[0]))
+
+
+// One recorded command, timestamped relative to the start of the recording.
+typedef struct session_event_s {
+    long long offset_ns;
+    char command;
+} session_event_t;
+
+
+// Operations issued by the churn generator (indices into churn counters).
+typedef enum churn_op_e {
+    CHURN_OP_SPAWN = 0,
+    CHURN_OP_KILL_LAST,
+    CHURN_OP_KILL_RANDOM,
+    CHURN_OP_BROADCAST,
+    CHURN_OP_COUNT
+} churn_op_t;
+
+
+// Per-operation outcome counters for the churn generator.
+typedef struct churn_counters_s {
+    unsigned long long issued;
+    unsigned long long failed;  // The operation reported an error
+    unsigned long long noop;    // Nothing to act on (e.g., kill with no children)
+} churn_counters_t;
+
+
+// Lifecycle of a tracked child. REAPED entries leave the registry; only the counter remains.
+typedef enum child_state_e {
+    CHILD_STATE_STARTING = 0, // Forked, execv() not yet confirmed
+    CHILD_STATE_RUNNING,      // execv() succeeded
+    CHILD_STATE_DESCENDANT,   // Forked by a tracked process, found by the subreaper scan (-O); not a command target
+    CHILD_STATE_SIGNALED,     // Sent SIGTERM (or SIGKILL) by the parent, exit not yet observed
+    CHILD_STATE_EXITED,       // Exit observed, not yet reaped (a child of the parent is reaped as soon as it is seen)
+    CHILD_STATE_REAPED,       // Reaped (cumulative count); the newest stay listed in g_reaped_recent
+    CHILD_STATE_COUNT
+} child_state_t;
+
+
+// Registry entry for one child.
+typedef struct child_entry_s {
+    pid_t pid;
+    child_state_t state;
+    long long spawn_ns;    // fork() returned (CLOCK_MONOTONIC)
+    long long ready_ns;    // execv() confirmed, 0 until then
+    long long exit_ns;     // Exit notification, 0 while alive
+    int exit_status;       // waitpid() status, valid from EXITED on
+    int last_signal;       // Last signal sent by the parent, 0 if none
+    int exec_fd;           // Read end of the exec-status pipe while STARTING, -1 otherwise
+    int err_fd;            // Read end of the child's stderr pipe, -1 after EOF
+    int slot;              // Index in the shared stats region, -1 if none
+    long long resumed_reps; // Repetitions carried over from a checkpoint, 0 for a fresh run
+    double duration_s;     // Length of a time-boxed run, 0 for a fixed repetition count
+    long long paused_ns;   // SIGSTOP sent by 'p' (CLOCK_MONOTONIC), 0 while not paused
+    long long paused_total_ns; // Completed pauses
+    long long kill_deadline_ns; // SIGKILL due if the child outlives its SIGTERM, 0 if none
+    int pidfd;             // From clone3(CLONE_PIDFD), -1 if forked
+    int rounds_collected;  // Rounds of a persistent child (-M) already added to the totals
+    int descendant;        // Found in the process tree (-O), not spawned by the parent
+    pid_t parent_pid;      // Process that forked it; 0 for an orphan whose parent was never seen
+    int adopted;           // Descendant reparented to the parent after its own parent exited
+    size_t err_len;        // Bytes of an unterminated line in err_line
+    char err_line[ERR_LINE_LEN];
+    sched_spec_t sched;    // Policy applied before execv()
+} child_entry_t;
+
+
+// A child that left the registry, kept for 'l' (g_reaped_recent).
+typedef struct reaped_child_s {
+    pid_t pid;
+    int exit_status;       // waitpid() status, -1 if reaped by its own parent (descendant)
+    int descendant;
+    sched_spec_t sched;
+    long long spawn_ns;
+    long long exit_ns;     // Exit notification
+    long long reaped_ns;
+} reaped_child_t;
+
+
+// Exit notification recorded by the SIGCHLD handler for a single child.
+typedef struct exit_note_s {
+    pid_t pid;
+    long long notified_ns;
+} exit_note_t;
+
+
+// Reaping metrics: zombie lifetime per reap and zombies reaped per pass.
+typedef struct reap_metrics_s {
+    unsigned long long reaped;          // Children reaped in total
+    unsigned long long untracked;       // Reaped PIDs that were no longer in the registry
+    unsigned long long coalesced;       // Exit time taken from a coalesced SIGCHLD
+    unsigned long long notes_lost;      // Notifications dropped because the ring overflowed
+    unsigned long long passes;          // Reaper passes that reaped at least one child
+    long long latency_total_ns;
+    long long latency_max_ns;
+    size_t backlog_max;
+    unsigned long long latency_hist[HISTOGRAM_BUCKETS]; // Zombie lifetime in microseconds
+    unsigned long long backlog_hist[HISTOGRAM_BUCKETS]; // Zombies reaped per pass
+} reap_metrics_t;
+
+
+// Checkpoint of a child that ended before completing its repetitions.
+typedef struct partial_result_s {
+    pid_t pid;             // Child that wrote it, 0 if loaded from a checkpoint file
+    sched_spec_t sched;    // Policy it ran under; a resumed child gets the same
+    checkpoint_data_t data;
+} partial_result_t;
+
 
+// Totals over children that completed all repetitions.
+typedef struct completed_totals_s {
+    unsigned long long children;
+    long long repetitions;
+    long long counts[4];
+} completed_totals_t;
 
-static pid_t *g_child_pids = NULL;
+
+// Header of the results file and of its index.
+typedef struct results_header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;   // sizeof(result_record_t) or sizeof(results_block_t)
+    uint32_t block_records; // RESULTS_BLOCK_RECORDS
+    uint32_t byte_order;    // RESULTS_BYTE_ORDER as written by the producer
+    char reserved[40];
+} results_header_t;
+
+
+// One reaped child in the results file (fixed size, appended with a single write).
+typedef struct result_record_s {
+    int64_t finished_ns;    // CLOCK_REALTIME when the child was reaped
+    int64_t lifetime_ns;    // Spawn to exit notification
+    int64_t startup_ns;     // Spawn to execv() confirmed, 0 if never confirmed
+    int64_t repetitions;    // From the last checkpoint, 0 if none
+    int64_t resumed_reps;   // Repetitions carried over from an earlier run
+    int64_t counts[4];      // {0,0}, {0,1}, {1,0}, {1,1}
+    int64_t utime_us;       // Resource usage from wait4()
+    int64_t stime_us;
+    int64_t maxrss_kb;
+    int64_t nvcsw;
+    int64_t nivcsw;
+    int32_t pid;
+    int32_t policy;
+    int32_t policy_value;
+    int32_t exit_status;    // Raw wait status
+    uint32_t flags;         // RESULT_COMPLETE, RESULT_RESUMED, RESULT_THREAD
+    uint32_t duration_ms;   // Length of a time-boxed run, 0 for a fixed repetition count
+} result_record_t;
+
+
+// Sums over a set of records; what queries report.
+typedef struct results_totals_s {
+    uint64_t records;
+    uint64_t complete;
+    int64_t repetitions;
+    int64_t counts[4];
+    int64_t lifetime_ns;
+    int64_t startup_ns;
+    int64_t cpu_us;
+    int64_t maxrss_kb_max;
+} results_totals_t;
+
+
+// Index entry summarizing RESULTS_BLOCK_RECORDS consecutive records.
+typedef struct results_block_s {
+    uint64_t first_record;
+    uint32_t policy_mask;    // Bit per scheduling policy present
+    int32_t value_min;       // Range of policy values (nice or priority)
+    int32_t value_max;
+    uint32_t reserved;
+    int64_t finished_min_ns;
+    int64_t finished_max_ns;
+    results_totals_t totals;
+} results_block_t;
+
+
+// Parsed query (-q).
+typedef struct results_query_s {
+    int has_policy;
+    sched_spec_t policy;
+    int match_value;         // Policy given with an explicit value
+    pid_t pid;               // 0 = any
+    int64_t from_ns;         // Inclusive CLOCK_REALTIME range
+    int64_t to_ns;
+    int status;              // 0 any, 1 complete only, 2 partial only
+    int group_by_policy;
+} results_query_t;
+
+
+// Running mean and variance (Welford) of one per-run metric.
+typedef struct ab_metric_s {
+    uint64_t n;
+    double mean;
+    double m2; // Sum of squared deviations from the mean
+} ab_metric_t;
+
+
+// A metric compared by -A/-B and which direction is worse.
+typedef struct ab_metric_info_s {
+    const char *name;
+    const char *unit;
+    int worse_sign; // +1 if larger values are a regression, -1 if smaller ones are
+} ab_metric_info_t;
+
+
+// A spawn requested while spawns were throttled.
+typedef struct deferred_spawn_s {
+    sched_spec_t sched;
+    int has_resume;
+    checkpoint_data_t resume;  // Valid if has_resume
+    long long requested_ns;
+} deferred_spawn_t;
+
+
+// A thread running the child's workload (-T). The stats slot is the worker's
+// own (not in the shared region), written only by the worker's timer handler.
+typedef struct worker_s {
+    stats_slot_t stats;            // Live counters and checkpoints, as in a child's slot
+    _Alignas(STATS_SLOT_ALIGN) volatile int pair[2]; // Toggled by the worker, on its own cache line
+    volatile sig_atomic_t alarm_flag; // Set by the timer handler
+    atomic_int stop;               // Set by '-', 'k' and at exit
+    atomic_int interval_us;        // Sample interval, changed by 'i'
+    atomic_int output_enabled;     // '1'/'2'
+    atomic_int tid;                // Kernel thread ID, 0 until the worker runs
+    pthread_t thread;
+    int id;                        // Sequence number of the worker
+    size_t index;                  // Position in g_workers
+    int error;                     // errno if the worker could not create its timer
+    long long spawn_ns;            // pthread_create() called
+    long long deadline_ns;         // End of a time-boxed run (-t), 0 otherwise
+    long long start_ns;            // Written by the worker, read after the join
+    long long end_ns;
+    long long resumed_reps;        // Repetitions carried over from a partial result ('r'), 0 for a fresh run
+    struct rusage usage;           // The thread's own usage, taken by the worker as it ends
+} worker_t;
+
+
+// Pressure watch for one PSI resource (-P).
+typedef struct psi_watch_s {
+    const char *name;          // "cpu" or "memory"
+    const char *path;
+    double threshold_pct;      // "some" stall share of the window that throttles spawns
+    int fd;                    // Trigger fd, -1 if unavailable
+    long long last_total_us;   // Fallback sampling: previous "some total="
+    unsigned long long events; // Pressure events (trigger firings or samples over the threshold)
+} psi_watch_t;
+
+
+// Counters for captured child stderr.
+typedef struct log_metrics_s {
+    unsigned long long lines;     // Lines captured from children
+    unsigned long long bytes;     // Bytes read from the stderr pipes
+    unsigned long long dropped;   // Lines discarded by the rate limit
+    unsigned long long writes;    // write() calls that emitted batches
+} log_metrics_t;
+
+
+// Hot restart image ('H'): this header, then child_count restart_child_t and
+// partial_count partial_result_t, in a memfd the new parent inherits.
+typedef struct restart_header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;      // Sizes of the three record types; the new parent
+    uint32_t child_size;       // refuses an image whose layout differs from its own
+    uint32_t partial_size;
+    uint64_t child_count;
+    uint64_t partial_count;
+    int64_t requested_ns;      // 'H' read (CLOCK_MONOTONIC)
+    int64_t exec_ns;           // Image complete, execv() next
+    int64_t start_ns;          // g_start_ns of the first parent
+    uint64_t restart_count;    // Hot restarts before this one
+    int64_t restart_pause_total_ns;
+    int32_t stats_fd;          // Inherited stats region, -1 if none
+    int32_t sampler_pid;       // External sampler (-e) still running, -1 if none
+    uint64_t stats_len;
+    sched_spec_t sched;        // Policy for new children ('s')
+    uint32_t sched_preset_index;
+    uint32_t interval_preset_index;
+    int32_t dump_tag;
+    int32_t dashboard_active;
+    uint64_t state_reaped;     // g_state_counts[CHILD_STATE_REAPED]
+    uint64_t exit_normal;
+    uint64_t exit_failed;
+    uint64_t exit_signaled;
+    uint64_t spawned_total;
+    uint64_t spawn_calls;
+    int64_t spawn_call_total_ns;
+    uint64_t pause_count;
+    int64_t fleet_paused_ns;
+    int64_t fleet_paused_total_ns;
+    uint64_t rounds_collected;
+    uint64_t round_release_failed;
+    uint64_t descendants_found;
+    uint64_t orphans_adopted;
+    uint64_t descendants_reaped;
+    uint64_t descendants_gone;
+    uint64_t orphans_unseen;
+    uint64_t checkpoints_lost;
+    completed_totals_t completed;
+    reap_metrics_t reap_metrics;
+    log_metrics_t log_metrics;
+    reaped_child_t reaped_recent[REAPED_RECENT_MAX];
+    uint64_t reaped_recent_total;
+} restart_header_t;
+
+
+// One registry entry in the hot restart image. The descriptors are the
+// previous parent's numbers, still open in the new one.
+typedef struct restart_child_s {
+    int32_t pid;
+    int32_t state;             // child_state_t
+    int64_t spawn_ns;
+    int64_t ready_ns;
+    int64_t exit_ns;
+    int32_t exit_status;
+    int32_t last_signal;
+    int32_t exec_fd;
+    int32_t err_fd;
+    int32_t pidfd;
+    int32_t slot;
+    int64_t resumed_reps;
+    double duration_s;
+    int64_t paused_ns;
+    int64_t paused_total_ns;
+    int32_t rounds_collected;
+    int32_t descendant;
+    int32_t parent_pid;
+    int32_t adopted;
+    sched_spec_t sched;
+    uint32_t err_len;
+    char err_line[ERR_LINE_LEN];
+} restart_child_t;
+
+
+// Dispatch latency accumulated per command during a replay.
+typedef struct command_latency_s {
+    unsigned long long count;
+    long long total_ns;
+    long long max_ns;
+} command_latency_t;
+
+
+static child_entry_t *g_children = NULL;
 static size_t g_child_count = 0;
 static size_t g_child_capacity = 0;
+static size_t g_state_counts[CHILD_STATE_COUNT]; // Entries per state, updated by set_child_state
+static reaped_child_t g_reaped_recent[REAPED_RECENT_MAX]; // Ring of the newest reaped children
+static unsigned long long g_reaped_recent_total = 0;      // Children ever put in the ring
+static size_t g_kill_escalations = 0;     // Children with a SIGKILL deadline pending
+static unsigned long long g_kills_escalated = 0; // Children that outlived SIGTERM and got SIGKILL
+static unsigned long long g_exit_normal = 0;    // Reaped children that exited with status 0
+static unsigned long long g_exit_failed = 0;    // ... exited with a non-zero status
+static unsigned long long g_exit_signaled = 0;  // ... were terminated by a signal
+static struct pollfd *g_pollfds = NULL;          // Poll set rebuilt by the main loop
+static size_t *g_poll_owners = NULL;             // Registry index owning each child fd in g_pollfds
+static size_t g_pollfd_capacity = 0;
 static struct termios g_orig_termios; // Typedef'd to termios_t later, but struct termios is the actual type
 static char g_child_exec_path[MAX_PATH_LEN];
 static volatile sig_atomic_t g_terminate_flag = 0;
+static sched_spec_t g_sched_spec;      // Policy applied to subsequently spawned children
+static size_t g_sched_preset_index = 0; // Position in g_sched_presets for the 's' command
+static size_t g_interval_preset_index = INTERVAL_PRESET_COUNT - 1; // Last interval sent by 'i'
+static int g_dump_tag = 0;             // Tag of the last 'v' dump request
+static unsigned long long g_pause_count = 0;   // 'p' commands that stopped at least one child
+static long long g_fleet_paused_ns = 0;        // Start of the current fleet pause, 0 if none
+static long long g_fleet_paused_total_ns = 0;  // Completed fleet pauses
+
+static int g_clone3_available = 1;         // Cleared after clone3() returned ENOSYS/E2BIG; fork() is used then
+static const char *g_cgroup_path = NULL;   // cgroup v2 directory for new children (-C), NULL if none
+static int g_cgroup_fd = -1;               // That directory, for CLONE_INTO_CGROUP
+static int g_cgroup_procs_fd = -1;         // Its cgroup.procs, for children forked without clone3()
+
+static int g_round_limit = -1;             // Rounds per persistent child (-M), 0 until stopped, -1 if not persistent
+static volatile sig_atomic_t g_rounds_pending = 0; // Set by handle_round_done, cleared by service_rounds
+static unsigned long long g_rounds_collected = 0;  // Rounds added to the completed totals
+static unsigned long long g_round_release_failed = 0; // Next-round commands that could not be queued
+
+static int g_subreaper = 0;                // Child subreaper tracking descendants (-O)
+static long long g_descendant_scan_ns = 0; // Next process tree scan
+static long long g_descendant_scan_period_ns = DESCENDANT_SCAN_NS; // Period of the scan (-O[MS])
+static unsigned long long g_descendants_found = 0;  // Descendants added to the registry
+static unsigned long long g_orphans_adopted = 0;    // ... reparented to the parent since
+static unsigned long long g_descendants_reaped = 0; // ... reaped by the parent
+static unsigned long long g_descendants_gone = 0;   // ... reaped by their own parent
+static unsigned long long g_orphans_unseen = 0;     // Orphans reaped before any scan found them
+
+static char g_self_exe_path[MAX_PATH_LEN]; // Parent binary, resolved at startup; 'H' re-executes whatever is there then
+static char **g_argv = NULL;               // Command line, passed on by 'H'
+static int g_restarted = 0;                // Started by 'H' of a previous parent
+static restart_header_t g_restart_header;  // Image being restored (g_restarted)
+static restart_child_t *g_restart_children = NULL;
+static partial_result_t *g_restart_partials = NULL;
+static unsigned long long g_restart_count = 0; // Hot restarts since the first parent started
+static long long g_restart_pause_last_ns = 0;  // 'H' read to the new parent's main loop
+static long long g_restart_pause_total_ns = 0;
+
+static int g_spawn_helper = 0;             // Create children through the spawn helper (-S)
+static pid_t g_spawn_helper_pid = -1;      // Spawn helper process, -1 if not running
+static int g_spawn_helper_fd = -1;         // Parent's end of the helper's socket
+static unsigned long long g_spawn_calls = 0;  // Children created, and the time spent creating them
+static long long g_spawn_call_total_ns = 0;   // (clone3()/fork() or the helper round trip)
+
+static int g_thread_workers = 0;           // '+' starts thread workers instead of child processes (-T)
+static size_t g_initial_spawns = 0;        // Children or workers started before the main loop (-N)
+static worker_t **g_workers = NULL;        // Live thread workers, in start order
+static size_t g_worker_count = 0;
+static size_t g_worker_capacity = 0;
+static int g_worker_pipe[2] = { -1, -1 };  // Finished workers post their pointer here
+static int g_worker_next_id = 0;
+static unsigned long long g_workers_started = 0;
+static long long g_worker_start_total_ns = 0; // pthread_create() latency, summed
+static int g_stdin_interactive = 0;    // Commands are read from the raw-mode terminal
+
+static long long g_start_ns = 0;          // Monotonic time the parent started
+static FILE *g_session_file = NULL;       // Recording target (-w), NULL if not recording
+static const char *g_session_path = NULL;
+static const char *g_replay_path = NULL;  // Session to replay (-r), NULL if none
+static double g_replay_speed = 1.0;       // Replay speed factor (-x), 0 = no delays
+static session_event_t *g_replay_events = NULL;
+static size_t g_replay_count = 0;
+static size_t g_replay_index = 0;
+static long long g_replay_start_ns = 0;
+static long long g_replay_lag_total_ns = 0;
+static long long g_replay_lag_max_ns = 0;
+static command_latency_t g_replay_latency[UCHAR_MAX + 1];
+
+static int g_quiet_ops = 0;                // Suppress per-operation messages (churn generator)
+static double g_churn_duration_s = 0.0;    // Churn generator duration (-g), 0 = disabled
+static double g_churn_rate = CHURN_DEFAULT_RATE; // Operations per second (-R)
+static unsigned int g_churn_weights[CHURN_OP_COUNT]; // Operation mix (-m)
+static unsigned long long g_rng_state = 0; // xorshift64 state for the churn generator
+
+// Written by the SIGCHLD handler, consumed by reap_children() with SIGCHLD blocked.
+static int g_sigchld_pipe[2] = { -1, -1 };       // Self-pipe waking the main loop on SIGCHLD
+static volatile long long g_sigchld_pending_ns = 0; // First SIGCHLD not yet handled by the reaper
+static volatile exit_note_t g_exit_notes[EXIT_NOTE_RING];
+static volatile unsigned long g_exit_notes_head = 0; // Total notes written by the handler
+static unsigned long g_exit_notes_tail = 0;          // Total notes consumed by the reaper
+static reap_metrics_t g_reap_metrics;
+
+static const char *g_log_path = NULL;     // Child stderr log file (-L), NULL = terminal
+static int g_log_fd = -1;                 // Destination of captured child stderr
+static double g_log_rate = -1.0;          // Lines per second (-l), 0 = unlimited, <0 = default
+static double g_log_tokens = 0.0;         // Rate limiter bucket, refilled at g_log_rate
+static long long g_log_refill_ns = 0;
+static unsigned long long g_log_dropped_pending = 0; // Dropped lines not yet reported in the log
+static char g_log_batch[LOG_BATCH_SIZE];
+static size_t g_log_batch_len = 0;
+static long long g_log_batch_ns = 0;      // When the oldest line in the batch was captured
+static log_metrics_t g_log_metrics;
+static char g_log_recent[LOG_RECENT_LINES][ERR_LINE_LEN]; // Newest captured lines, for the dashboard
+static unsigned long g_log_recent_count = 0;
+
+static int g_stats_fd = -1;               // Shared stats region (close-on-exec), -1 if unavailable
+static size_t g_stats_region_len = 0;     // Mapped length (whole huge pages on hugetlbfs)
+static int g_huge_pages = 0;              // Back the stats region with huge pages and prefault it (-H)
+static stats_slot_t *g_stats_slots = NULL;
+static int g_free_slots[STATS_SLOT_COUNT]; // Stack of unused slot indices
+static size_t g_free_slot_count = 0;
+static unsigned long long g_spawned_total = 0; // Children added to the registry since start
+
+static int g_dashboard_active = 0;        // Full-screen dashboard is shown ('d')
+static double g_dashboard_hz = DASH_DEFAULT_HZ; // Refresh rate (-D)
+static long long g_dashboard_next_ns = 0; // When the next frame is due
+static int g_dashboard_rows = 0;          // Terminal size the previous frame was drawn for
+static int g_dashboard_cols = 0;
+static char *g_dashboard_prev = NULL;     // Previous frame, g_dashboard_rows lines of DASH_MAX_COLS + 1
+static char *g_dashboard_out = NULL;      // Escape sequences for one frame, written at once
+static size_t g_dashboard_out_size = 0;
+static int g_dashboard_valid = 0;         // Screen matches g_dashboard_prev
+static long long g_dashboard_last_ns = 0; // Time of the previous frame, for rates
+static unsigned long long g_dashboard_last_spawned = 0;
+static unsigned long long g_dashboard_last_reaped = 0;
+static double g_dashboard_spawn_rate = 0.0; // Smoothed spawns per second
+static double g_dashboard_reap_rate = 0.0;  // Smoothed reaps per second
+
+static partial_result_t *g_partials = NULL;  // Unfinished checkpoints, oldest first
+static size_t g_partial_count = 0;
+static size_t g_partial_capacity = 0;
+static completed_totals_t g_completed;       // Children that finished all repetitions
+static unsigned long long g_checkpoints_lost = 0; // Reaped children without a usable checkpoint
+static const char *g_checkpoint_path = NULL; // Checkpoint file (-K), NULL if none
+
+static double g_sample_rate = 0.0;         // External samples per second per child (-e), 0 = children sample themselves
+static double g_run_duration_s = 0.0;      // Time box passed to every spawned child (-t), 0 = fixed repetitions
+
+static int g_psi_enabled = 0;              // Pressure-aware spawn throttling (-P)
+static psi_watch_t g_psi[PSI_RESOURCES] = {
+    { "cpu", "/proc/pressure/cpu", 0.0, -1, -1, 0 },
+    { "memory", "/proc/pressure/memory", 0.0, -1, -1, 0 }
+};
+static int g_psi_polling = 0;              // Triggers unavailable; sample the files every PSI_POLL_NS
+static long long g_psi_next_poll_ns = 0;
+static long long g_psi_last_poll_ns = 0;
+static long long g_throttle_until_ns = 0;  // Spawns are deferred until then
+static long long g_throttle_start_ns = 0;  // Start of the current throttled period, 0 if none
+static long long g_throttled_total_ns = 0;
+static long long g_next_release_ns = 0;
+static deferred_spawn_t *g_deferred = NULL; // FIFO of deferred spawns
+static size_t g_deferred_head = 0;
+static size_t g_deferred_count = 0;
+static size_t g_deferred_capacity = 0;
+static unsigned long long g_deferred_total = 0;    // Spawns that had to wait
+static long long g_deferred_wait_total_ns = 0;     // Time they waited
+static long long g_deferred_wait_max_ns = 0;
+static pid_t g_sampler_pid = -1;           // External sampler process, -1 if not running
+
+static const char *g_results_path = NULL;  // Results store (-o), NULL if none
+static const char *g_query_text = NULL;    // Query (-q); runs query mode instead of the parent
+static int g_results_fd = -1;
+static int g_results_index_fd = -1;
+static uint64_t g_results_records = 0;     // Records in the results file
+static results_block_t g_results_block;    // Summary of the block being filled
+static const char *g_compare_base = NULL;  // Baseline results store (-A)
+static const char *g_compare_candidate = NULL; // Candidate results store (-B)
+
+// Per-run metrics of the A/B comparison, indexed like ab_metric_t arrays
+static const ab_metric_info_t g_ab_metrics[AB_METRIC_COUNT] = {
+    { "torn rate", "%", +1 },
+    { "throughput", "reps/s", -1 },
+    { "spawn latency", "us", +1 }
+};
 
 
 typedef struct termios termios_t; // This is fine, but g_orig_termios is already declared
@@ -41,16 +755,152 @@ static void enable_raw_mode(void);
 static void disable_raw_mode(void);
 static void cleanup_resources(void);
 static void handle_signal(int sig);
+static void handle_sigchld(int sig, siginfo_t *info, void *context);
+static int create_sigchld_pipe(void);
+static void reap_children(void);
+static int histogram_bucket(unsigned long long value);
+static void print_histogram(const char *label, const unsigned long long *hist);
+static void print_reap_metrics(void);
+static ssize_t find_child_index(pid_t pid);
+static void set_child_state(child_entry_t *child, child_state_t state);
+static int is_child_live(const child_entry_t *child);
+static size_t live_child_count(void);
+static const char *child_state_name(child_state_t state);
+static size_t build_poll_set(void);
+static void service_child_fds(size_t nfds);
+static void handle_exec_status(child_entry_t *child);
+static void raise_fd_limit(void);
+static int open_child_log(const char *path);
+static void read_child_stderr(child_entry_t *child);
+static void capture_child_line(const char *text, size_t len);
+static void flush_child_log(int force);
+static int log_timeout_ms(int timeout_ms);
+static int create_stats_region(void);
+static void *map_stats_region(int fd, size_t len, const char *backing);
+static int acquire_stats_slot(void);
+static void release_stats_slot(int slot);
+static void toggle_dashboard(void);
+static void render_dashboard(int force);
+static int dashboard_timeout_ms(int timeout_ms);
+static int format_dashboard_child(const child_entry_t *child, long long now_ns, char *buf, size_t buf_size);
+static int read_child_checkpoint(const child_entry_t *child, checkpoint_data_t *data);
+static void collect_child_checkpoint(const child_entry_t *child);
+static void handle_round_done(int sig, siginfo_t *info, void *context);
+static void service_rounds(void);
+static int add_partial_result(pid_t pid, const sched_spec_t *sched, const checkpoint_data_t *data);
+static void print_aggregate(void);
+static void resume_partials(void);
+static int load_checkpoint_file(const char *path);
+static int save_checkpoint_file(const char *path);
+static int start_sampler(void);
+static void run_sampler(void);
+static void stop_sampler(void);
+static int parse_psi_thresholds(const char *text);
+static int open_psi_watches(void);
+static int read_psi_some_total(const char *path, long long *total_us);
+static void note_pressure(psi_watch_t *watch, long long now_ns);
+static void service_psi(void);
+static int psi_timeout_ms(int timeout_ms);
+static int request_spawn(const sched_spec_t *sched, const checkpoint_data_t *resume);
+static void requeue_deferred_resumes(void);
+static int open_results_store(const char *path);
+static int read_results_header(int fd, const char *path, const char *magic, uint32_t record_size);
+static void reset_results_block(uint64_t first_record);
+static void add_record_to_block(results_block_t *block, const result_record_t *record);
+static void add_record_to_totals(results_totals_t *totals, const result_record_t *record);
+static void merge_totals(results_totals_t *into, const results_totals_t *from);
+static void append_child_result(const child_entry_t *child, int status, const struct rusage *usage);
+static void append_worker_result(const worker_t *worker, const checkpoint_data_t *data);
+static void write_result_record(const result_record_t *record);
+static int parse_results_query(const char *text, results_query_t *query);
+static int record_matches_query(const result_record_t *record, const results_query_t *query);
+static int block_query_overlap(const results_block_t *block, const results_query_t *query);
+static int run_results_query(void);
+static int collect_ab_sample(const char *path, const results_query_t *query, ab_metric_t *metrics);
+static void add_ab_value(ab_metric_t *metric, double value);
+static double incomplete_beta(double a, double b, double x);
+static double student_t_two_sided_p(double t, double df);
+static double student_t_critical(double df);
+static int run_ab_comparison(void);
 static void register_signal_handlers(void);
-static int add_child_pid(pid_t pid);
-static void remove_child_pid_at_index(size_t index);
+static child_entry_t *add_child_entry(pid_t pid, int exec_fd, int err_fd, int slot);
+static void remove_child_at_index(size_t index);
+static void retire_child(size_t index, long long reaped_ns);
 static void kill_all_children(const char *reason);
-static void signal_all_children(int sig);
-static void spawn_child(void);
-static void kill_last_child(void);
+static void reap_killed_children(void);
+static int signal_all_children(int sig);
+static int queue_command_to_children(int command, int arg, const char *description);
+static void cycle_sample_interval(void);
+static void pause_all_children(void);
+static int open_spawn_cgroup(void);
+static int open_worker_pipe(void);
+static int start_worker(const checkpoint_data_t *resume);
+static void *run_worker(void *arg);
+static void handle_worker_timer(int sig, siginfo_t *info, void *context);
+static int worker_finished(worker_t *worker);
+static void stop_worker(worker_t *worker);
+static void stop_last_worker(void);
+static void stop_all_workers(const char *reason);
+static void service_workers(void);
+static void finish_worker(worker_t *worker);
+static void compact_workers(void);
+static void set_workers_output(int enabled);
+static void spawn_initial_fleet(void);
+static pid_t clone_child(int *pidfd);
+static void exec_child(const child_exec_t *spec, int cgroup_procs_fd);
+static int start_spawn_helper(void);
+static void run_spawn_helper(int sock);
+static pid_t spawn_via_helper(const child_exec_t *spec, int *pidfd);
+static void stop_spawn_helper(void);
+static int send_with_fds(int sock, const void *buf, size_t len, const int *fds, size_t nfds);
+static ssize_t recv_with_fds(int sock, void *buf, size_t len, int *fds, size_t max_fds, size_t *nfds);
+static int signal_child(const child_entry_t *child, int sig, const union sigval *value);
+static void resume_all_children(void);
+static int spawn_child(void);
+static int spawn_child_with(const sched_spec_t *sched, const checkpoint_data_t *resume);
+static int kill_last_child(void);
+static int kill_child_at_index(size_t index);
+static void escalate_kills(void);
+static int kill_timeout_ms(int timeout_ms);
 static void list_children(void);
 static void initialize_globals(void);
 static ssize_t safe_write(int fd, const void *buf, size_t count);
+static void print_usage(const char *prog_name);
+static int parse_arguments(int argc, char *argv[]);
+static int parse_sched_spec(const char *text, sched_spec_t *spec);
+static void format_sched_spec(const sched_spec_t *spec, char *buf, size_t buf_size);
+static void apply_sched_spec(const sched_spec_t *spec);
+static void cycle_sched_policy(void);
+static long long monotonic_ns(void);
+static long long dispatch_command(char c);
+static long long replay_due_ns(size_t index);
+static int open_session_recording(const char *path);
+static void record_session_command(char c);
+static int load_session_replay(const char *path);
+static int replay_timeout_ms(void);
+static void issue_due_replay_commands(void);
+static void print_replay_summary(void);
+static int parse_churn_mix(const char *text);
+static unsigned long long next_random(void);
+static void run_churn_generator(void);
+static void sleep_until_ns(long long deadline_ns);
+static int read_proc_stat(pid_t pid, char *state, pid_t *ppid);
+static void check_registry_consistency(void);
+static int enable_subreaper(void);
+static size_t read_task_children(pid_t pid, pid_t *pids, size_t max_pids);
+static void note_descendant(pid_t pid, pid_t parent_pid);
+static void scan_descendants(void);
+static void handle_descendant_exit(child_entry_t *child);
+static int descendant_timeout_ms(int timeout_ms);
+static void restart_signal_set(sigset_t *set);
+static void set_restart_fds_inheritable(int inheritable);
+static int write_restart_image(long long requested_ns, int dashboard_active);
+static int hot_restart(void);
+static int load_restart_image(void);
+static int adopt_stats_region(void);
+static int restore_registry(void);
+static void finish_hot_restart(void);
+static void close_restart_fds(void);
 
 
 /*
@@ -60,25 +910,28 @@ static ssize_t safe_write(int fd, const void *buf, size_t count);
  * Sets up terminal, signal handlers, and the main command loop.
  *
  * Accepts:
- *   argc - Argument count (expected: 1)
- *   argv - Argument vector (unused)
+ *   argc - Argument count
+ *   argv - Argument vector (options, see print_usage)
  *
  * Returns:
  *   EXIT_SUCCESS on normal exit.
  *   EXIT_FAILURE on critical errors (e.g., setup failure).
  */
 int main(int argc, char *argv[]) {
-    (void)argv; // Mark as unused
-
-
     initialize_globals();
 
 
-    if (argc > 1) {
-        if (fprintf(stderr, "Info: This program doesn't expect command-line arguments.\r\n") < 0) { /* Handle error? */ }
-        if (fprintf(stderr, "      It uses the CHILD_PATH environment variable to find the child executable.\r\n") < 0) { /* Handle error? */ }
+    if (parse_arguments(argc, argv) != 0) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
     }
 
+    if (g_compare_base != NULL) {
+        return run_ab_comparison();
+    }
+    if (g_query_text != NULL) {
+        return (run_results_query() == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
     const char *child_path_dir = getenv("CHILD_PATH");
     if (child_path_dir == NULL) {
@@ -93,6 +946,18 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    g_start_ns = monotonic_ns();
+    g_argv = argv;
+    ssize_t exe_len = readlink("/proc/self/exe", g_self_exe_path, sizeof(g_self_exe_path) - 1);
+    g_self_exe_path[(exe_len > 0) ? exe_len : 0] = '\0';
+    if (load_restart_image() != 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (g_replay_path != NULL && load_session_replay(g_replay_path) != 0) {
+        return EXIT_FAILURE;
+    }
+
     if (access(g_child_exec_path, X_OK) != 0) {
         // Use \r\n for consistency in raw mode messages
         if (fprintf(stderr, "Error: Child executable '%s' not found or not executable (errno %d: %s).\r\n",
@@ -108,25 +973,97 @@ int main(int argc, char *argv[]) {
         // No need to call disable_raw_mode() here as it wasn't enabled yet.
         exit(EXIT_FAILURE); // Exit directly if atexit registration fails
     }
+    // Before anything large is allocated: the helper's own fork copies only this much
+    if (g_spawn_helper && start_spawn_helper() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
 
-    enable_raw_mode(); // Now enable raw mode
+    // A replay or churn run may be unattended with stdin redirected; otherwise a terminal is required.
+    if ((g_replay_path == NULL && g_churn_duration_s <= 0.0) || isatty(STDIN_FILENO)) {
+        enable_raw_mode(); // Now enable raw mode
+        g_stdin_interactive = 1;
+    }
+    if (create_sigchld_pipe() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
     register_signal_handlers();
+    if (g_subreaper && enable_subreaper() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
 
-    g_child_pids = malloc(INITIAL_CHILD_CAPACITY * sizeof(pid_t));
-    if (g_child_pids == NULL) {
+    if (g_session_path != NULL && open_session_recording(g_session_path) != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (open_child_log(g_log_path) != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    raise_fd_limit(); // Every child holds a stderr pipe open in the parent
+    if ((g_restarted ? adopt_stats_region() : create_stats_region()) != 0) {
+        if (g_sample_rate > 0.0) {
+            exit(EXIT_FAILURE); // External sampling publishes through the slots; This will trigger atexit
+        }
+        // Not fatal: children run without live statistics and the dashboard shows less
+        if (fprintf(stderr, "Warning: Live child statistics are unavailable.\r\n") < 0) { /* Handle error? */ }
+    }
+    if (g_sample_rate > 0.0 && g_sampler_pid <= 0 && start_sampler() != 0) { // A restarted parent keeps the sampler
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (g_psi_enabled && open_psi_watches() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (g_cgroup_path != NULL && open_spawn_cgroup() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (g_thread_workers && open_worker_pipe() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (g_checkpoint_path != NULL && !g_restarted && load_checkpoint_file(g_checkpoint_path) != 0) { // Restored with the registry otherwise
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+    if (g_results_path != NULL && open_results_store(g_results_path) != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
+
+    g_children = malloc(INITIAL_CHILD_CAPACITY * sizeof(child_entry_t));
+    if (g_children == NULL) {
         // disable_raw_mode(); // Already handled by atexit
-        perror("Error: Failed to allocate memory for child PIDs"); // perror adds its own newline
+        perror("Error: Failed to allocate memory for child registry"); // perror adds its own newline
         exit(EXIT_FAILURE); // This will trigger atexit
     }
     g_child_capacity = INITIAL_CHILD_CAPACITY;
     g_child_count = 0;
+    if (g_restarted && restore_registry() != 0) {
+        exit(EXIT_FAILURE); // This will trigger atexit
+    }
 
     // Use \r\n for all multi-line or full-line outputs when terminal is raw
     if (printf("Parent process started (PID: %d).\r\n", getpid()) < 0) { /* Handle error? */ }
     if (printf("Commands: '+' spawn, '-' kill last, 'l' list, 'k' kill all,\r\n") < 0) { /* Handle error? */ }
     if (printf("          '1' enable child output (SIGUSR1), '2' disable child output (SIGUSR2),\r\n") < 0) { /* Handle error? */ }
-    if (printf("          'q' quit.\r\n") < 0) { /* Handle error? */ }
+    if (printf("          's' cycle scheduling policy for new children, 'z' reap metrics,\r\n") < 0) { /* Handle error? */ }
+    if (printf("          'a' aggregate results, 'r' resume partial results,\r\n") < 0) { /* Handle error? */ }
+    if (printf("          'i' cycle the children's sample interval, '0' reset child counters,\r\n") < 0) { /* Handle error? */ }
+    if (printf("          'v' dump child counters (queued real-time signal commands),\r\n") < 0) { /* Handle error? */ }
+    if (printf("          'p' pause all children (SIGSTOP), 'c' continue them (SIGCONT),\r\n") < 0) { /* Handle error? */ }
+    if (printf("          'd' toggle the live dashboard, 'H' hot-restart the parent, 'q' quit.\r\n") < 0) { /* Handle error? */ }
     if (printf("Using child executable: %s\r\n", g_child_exec_path) < 0) { /* Handle error? */ }
+    if (g_run_duration_s > 0.0) {
+        if (printf("Children run for %.3f s each instead of a fixed repetition count\r\n", g_run_duration_s) < 0) { /* Handle error? */ }
+    }
+    char sched_name[SCHED_NAME_LEN];
+    format_sched_spec(&g_sched_spec, sched_name, sizeof(sched_name));
+    if (printf("Scheduling policy for new children: %s\r\n", sched_name) < 0) { /* Handle error? */ }
+    if (g_log_rate > 0.0) {
+        if (printf("Child stderr: %s, limited to %.0f lines/s\r\n", (g_log_path != NULL) ? g_log_path : "terminal", g_log_rate) < 0) { /* Handle error? */ }
+    } else {
+        if (printf("Child stderr: %s, unlimited\r\n", (g_log_path != NULL) ? g_log_path : "terminal") < 0) { /* Handle error? */ }
+    }
+    if (g_results_path != NULL) {
+        if (printf("Appending results to %s (%llu records so far)\r\n", g_results_path, (unsigned long long)g_results_records) < 0) { /* Handle error? */ }
+    }
+    if (g_partial_count > 0 && !g_restarted) {
+        if (printf("Loaded %zu partial results from %s; press 'r' to resume them.\r\n", g_partial_count, g_checkpoint_path) < 0) { /* Handle error? */ }
+    }
     if (fflush(stdout) == EOF) {
         // disable_raw_mode(); // Already handled by atexit
         perror("PARENT: Error flushing initial messages");
@@ -134,56 +1071,103 @@ int main(int argc, char *argv[]) {
     }
 
 
+    if (g_churn_duration_s > 0.0) {
+        run_churn_generator();
+        if (!g_stdin_interactive && !g_terminate_flag) {
+            if (fprintf(stderr, "PARENT [%d]: Churn run finished. Initiating shutdown.\r\n", getpid()) < 0) { /* Handle error? */ }
+            g_terminate_flag = 1;
+        }
+    }
+
+    if (g_dashboard_active) { // Requested with -D
+        g_dashboard_active = 0;
+        toggle_dashboard();
+    }
+
+    if (g_replay_count > 0) {
+        if (printf("Replaying %zu commands from %s at speed %.2fx.\r\n", g_replay_count, g_replay_path, g_replay_speed) < 0) { /* Handle error? */ }
+        g_replay_start_ns = monotonic_ns();
+    }
+
+    if (g_initial_spawns > 0 && !g_restarted) {
+        spawn_initial_fleet();
+    }
+    if (g_restarted) {
+        finish_hot_restart();
+    }
+
     char c;
     while (!g_terminate_flag) {
-        ssize_t read_result = read(STDIN_FILENO, &c, 1);
+        int timeout_ms = -1;
 
-        if (read_result == 1) {
-            // Echoing commands or providing feedback can be done here if desired
-            // For example, to ensure the command prompt is clean after each command:
-            // safe_write(STDOUT_FILENO, "\r\n", 2); // Move to new line before processing/printing output
-
-            switch (c) {
-                case '+':
-                    safe_write(STDOUT_FILENO, "\r\n", 2); // Ensure command output starts on a new line
-                    spawn_child();
-                    break;
-                case '-':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    kill_last_child();
-                    break;
-                case 'l':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    list_children();
-                    break;
-                case 'k':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    kill_all_children("Received 'k' command.");
-                    break;
-                case '1':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    signal_all_children(SIGUSR1);
-                    break;
-                case '2':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    signal_all_children(SIGUSR2);
-                    break;
-                case 'q':
-                    safe_write(STDOUT_FILENO, "\r\n", 2);
-                    if (fprintf(stderr, "PARENT [%d]: Received 'q' command. Initiating shutdown.\r\n", getpid()) < 0) { /* Handle error? */ }
-                    g_terminate_flag = 1; // Set flag to terminate
-                    break;
-                default:
-                    // Optionally, provide feedback for unknown characters or ignore
-                    // safe_write(STDOUT_FILENO, "\a", 1); // Bell for unknown command
-                    break;
+        if (g_replay_index < g_replay_count) {
+            timeout_ms = replay_timeout_ms();
+        }
+        timeout_ms = log_timeout_ms(timeout_ms);
+        timeout_ms = dashboard_timeout_ms(timeout_ms);
+        timeout_ms = psi_timeout_ms(timeout_ms);
+        timeout_ms = descendant_timeout_ms(timeout_ms);
+        timeout_ms = kill_timeout_ms(timeout_ms);
+
+        size_t nfds = build_poll_set();
+        int poll_result = poll(g_pollfds, (nfds_t)nfds, timeout_ms);
+        if (poll_result == -1) {
+            if (errno == EINTR) { // Interrupted by a signal; g_terminate_flag is checked by the loop
+                continue;
             }
-            // It's good practice to flush output streams, especially in raw mode
-            if (fflush(stdout) == EOF) {
-                fprintf(stderr, "Warning: fflush(stdout) failed in command loop.\r\n");
+            perror("PARENT: Error polling stdin");
+            exit(EXIT_FAILURE); // This will trigger atexit
+        }
+
+        // Child pipes first: reaping below removes entries
+        service_child_fds(nfds);
+        if (g_pollfds[POLL_SIGCHLD].revents != 0) {
+            reap_children();
+        }
+        if (g_rounds_pending) {
+            service_rounds();
+        }
+        service_psi();
+        if (g_pollfds[POLL_WORKERS].revents != 0) {
+            service_workers();
+        }
+        if (g_subreaper && monotonic_ns() >= g_descendant_scan_ns) {
+            scan_descendants();
+        }
+        escalate_kills();
+        flush_child_log(0);
+        render_dashboard(0);
+        struct pollfd stdin_pfd = g_pollfds[POLL_STDIN];
+
+        if (g_replay_index < g_replay_count) {
+            issue_due_replay_commands();
+            if (g_replay_index == g_replay_count) {
+                print_replay_summary();
+                if (!g_stdin_interactive && !g_terminate_flag) {
+                    if (fprintf(stderr, "PARENT [%d]: Replay finished. Initiating shutdown.\r\n", getpid()) < 0) { /* Handle error? */ }
+                    g_terminate_flag = 1;
+                }
             }
-            if (fflush(stderr) == EOF) {
-                fprintf(stderr, "Warning: fflush(stderr) failed in command loop.\r\n");
+        }
+
+        if (poll_result == 0 || !g_stdin_interactive || stdin_pfd.revents == 0) {
+            continue;
+        }
+
+        ssize_t read_result = read(STDIN_FILENO, &c, 1);
+
+        if (read_result == 1) {
+            if (c == 'd') { // Display only, so it is neither recorded nor replayed
+                toggle_dashboard();
+            } else if (c == 'H') { // Not recorded either: a replay could not continue across it
+                safe_write(STDOUT_FILENO, "\r\n", 2);
+                hot_restart(); // Returns only if the restart was refused or failed
+            } else {
+                dispatch_command(c);
+                if (g_dashboard_active) {
+                    g_dashboard_valid = 0; // Repaint over whatever the command printed
+                    render_dashboard(1);
+                }
             }
         } else if (read_result == 0) { // EOF
             safe_write(STDOUT_FILENO, "\r\n", 2); // Ensure cursor is on a new line
@@ -205,707 +1189,7356 @@ int main(int argc, char *argv[]) {
 }
 
 /*
- * initialize_globals
+ * dispatch_command
  *
- * Explicitly initializes static global variables at runtime.
+ * Executes a single-character command, records it to the session file when
+ * recording, and flushes output streams afterwards.
+ *
+ * Accepts:
+ *   c - Command character
+ *
+ * Returns:
+ *   Time spent executing the command in nanoseconds, or -1 if the character
+ *   is not a command.
+ */
+static long long dispatch_command(char c) {
+    long long started_ns = monotonic_ns();
+
+    if (c == '\0' || strchr(SESSION_COMMANDS, c) == NULL) {
+        // Optionally, provide feedback for unknown characters or ignore
+        // safe_write(STDOUT_FILENO, "\a", 1); // Bell for unknown command
+        return -1;
+    }
+
+    record_session_command(c);
+
+    safe_write(STDOUT_FILENO, "\r\n", 2); // Ensure command output starts on a new line
+    switch (c) {
+        case '+':
+            if (g_thread_workers) {
+                start_worker(NULL);
+            } else {
+                request_spawn(&g_sched_spec, NULL);
+            }
+            break;
+        case '-':
+            if (g_thread_workers) {
+                stop_last_worker();
+            } else {
+                kill_last_child();
+            }
+            break;
+        case 'l':
+            list_children();
+            break;
+        case 'k':
+            kill_all_children("Received 'k' command.");
+            stop_all_workers("Received 'k' command.");
+            break;
+        case '1':
+            signal_all_children(SIGUSR1);
+            set_workers_output(1);
+            break;
+        case '2':
+            signal_all_children(SIGUSR2);
+            set_workers_output(0);
+            break;
+        case 's':
+            cycle_sched_policy();
+            break;
+        case 'z':
+            print_reap_metrics();
+            break;
+        case 'a':
+            print_aggregate();
+            break;
+        case 'r':
+            resume_partials();
+            break;
+        case 'i':
+            cycle_sample_interval();
+            break;
+        case '0':
+            queue_command_to_children(CHILD_COMMAND_RESET_COUNTERS, 0, "counter reset");
+            break;
+        case 'v':
+            g_dump_tag = (g_dump_tag + 1) & CHILD_COMMAND_ARG_MASK;
+            queue_command_to_children(CHILD_COMMAND_DUMP_STATS, g_dump_tag, "stats dump");
+            break;
+        case 'p':
+            pause_all_children();
+            break;
+        case 'c':
+            resume_all_children();
+            break;
+        case 'q':
+            if (fprintf(stderr, "PARENT [%d]: Received 'q' command. Initiating shutdown.\r\n", getpid()) < 0) { /* Handle error? */ }
+            g_terminate_flag = 1; // Set flag to terminate
+            break;
+        default:
+            break;
+    }
+
+    // It's good practice to flush output streams, especially in raw mode
+    if (fflush(stdout) == EOF) {
+        fprintf(stderr, "Warning: fflush(stdout) failed in command loop.\r\n");
+    }
+    if (fflush(stderr) == EOF) {
+        fprintf(stderr, "Warning: fflush(stderr) failed in command loop.\r\n");
+    }
+
+    return monotonic_ns() - started_ns;
+}
+
+/*
+ * monotonic_ns
+ *
+ * Returns the current CLOCK_MONOTONIC time in nanoseconds, or 0 if the
+ * clock cannot be read.
  *
  * Accepts: None
- * Returns: None
+ * Returns: Monotonic time in nanoseconds.
  */
-static void initialize_globals(void) {
-    g_child_pids = NULL;
-    g_child_count = 0;
-    g_child_capacity = 0;
-    memset(&g_orig_termios, 0, sizeof(g_orig_termios)); // Initialize original termios settings
-    g_child_exec_path[0] = '\0';
-    g_terminate_flag = 0;
+static long long monotonic_ns(void) {
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        return 0;
+    }
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
 }
 
 /*
- * safe_write
+ * open_session_recording
  *
- * Wrapper around write() to handle EINTR and partial writes.
- * Suitable for use outside signal handlers. For signal handlers,
- * direct write() with loop might be needed if partial writes are possible.
- * This version is fine for its current uses.
+ * Creates (truncates) the session file and writes its header. Every command
+ * dispatched afterwards is appended with its offset from parent start.
  *
  * Accepts:
- *   fd - File descriptor
- *   buf - Buffer to write
- *   count - Number of bytes to write
+ *   path - Session file path
  *
  * Returns:
- *   Total bytes written, or -1 on error (sets errno).
+ *   0 on success, -1 on failure (prints error message).
  */
-static ssize_t safe_write(int fd, const void *buf, size_t count) {
-    size_t total_written = 0;
-    const char *ptr = (const char *)buf;
-
-    while (total_written < count) {
-        ssize_t written = write(fd, ptr + total_written, count - total_written);
-        if (written == -1) {
-            if (errno == EINTR) {
-                continue; // Retry on interrupt
-            }
-            return -1; // Other error
-        }
-        if (written == 0) {
-            // According to POSIX write(2), a return of 0 means nothing was written
-            // and this should not happen if count > 0.
-            // However, some interpretations treat it as an error or EOF on certain devices.
-            // For robustness, treat as an error if count > 0 and written is 0.
-            errno = EIO; // Indicate an I/O error
-            return -1;
-        }
-        total_written += (size_t)written;
+static int open_session_recording(const char *path) {
+    g_session_file = fopen(path, "w");
+    if (g_session_file == NULL) {
+        if (fprintf(stderr, "Error: Cannot create session file '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
     }
-    return (ssize_t)total_written;
+    // Children must not inherit the session file descriptor across execv
+    if (fcntl(fileno(g_session_file), F_SETFD, FD_CLOEXEC) == -1) {
+        if (fprintf(stderr, "Warning: Failed to set FD_CLOEXEC on session file.\r\n") < 0) { /* Handle error? */ }
+    }
+    if (fputs(SESSION_HEADER, g_session_file) == EOF || fflush(g_session_file) == EOF) {
+        if (fprintf(stderr, "Error: Cannot write session file '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (printf("Recording session to %s\r\n", path) < 0) { /* Handle error? */ }
+    return 0;
 }
 
-
 /*
- * enable_raw_mode
+ * record_session_command
  *
- * Switches the terminal controlling stdin to raw mode.
- * Disables echo and canonical processing. Saves original settings.
- * **MODIFIED: Keeps ISIG enabled so Ctrl+C generates SIGINT.**
- * Exits on failure.
+ * Appends a command to the session file, if recording. The line is flushed
+ * immediately so the session survives a crash of the parent.
+ *
+ * Accepts:
+ *   c - Command character
  *
- * Accepts: None
  * Returns: None
  */
-static void enable_raw_mode(void) {
-    if (!isatty(STDIN_FILENO)) {
-        if (fprintf(stderr, "Error: Standard input is not a terminal. Raw mode not applicable.\r\n") < 0) { /* Handle error? */ }
-        // No raw mode to disable, so exit directly. atexit will handle g_child_pids if allocated.
-        exit(EXIT_FAILURE);
+static void record_session_command(char c) {
+    if (g_session_file == NULL) {
+        return;
     }
-    if (tcgetattr(STDIN_FILENO, &g_orig_termios) == -1) {
-        perror("Error: tcgetattr failed");
-        // No raw mode to disable. atexit will handle g_child_pids if allocated.
-        exit(EXIT_FAILURE);
+    if (fprintf(g_session_file, "%lld %c\n", monotonic_ns() - g_start_ns, c) < 0 || fflush(g_session_file) == EOF) {
+        if (fprintf(stderr, "Warning: Failed to record command '%c'; recording stopped.\r\n", c) < 0) { /* Handle error? */ }
+        fclose(g_session_file);
+        g_session_file = NULL;
     }
+}
 
-    termios_t raw = g_orig_termios;
+/*
+ * load_session_replay
+ *
+ * Reads a session file into g_replay_events. Blank lines and lines starting
+ * with '#' are ignored; every other line must be "<offset_ns> <command>"
+ * with non-decreasing offsets.
+ *
+ * Accepts:
+ *   path - Session file path
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int load_session_replay(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[SESSION_LINE_LEN];
+    size_t capacity = 0;
+    size_t line_number = 0;
+    long long previous_offset = 0;
 
-    // Configure input flags
-    raw.c_iflag &= ~(unsigned long)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    if (file == NULL) {
+        if (fprintf(stderr, "Error: Cannot open session file '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        long long offset_ns;
+        char command;
+
+        line_number++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%lld %c", &offset_ns, &command) != 2 || offset_ns < previous_offset ||
+            strchr(SESSION_COMMANDS, command) == NULL) {
+            if (fprintf(stderr, "Error: Malformed session line %zu in '%s'.\r\n", line_number, path) < 0) { /* Handle error? */ }
+            fclose(file);
+            return -1;
+        }
+
+        if (g_replay_count >= capacity) {
+            size_t new_capacity = (capacity == 0) ? 64 : capacity * 2;
+            session_event_t *new_events = realloc(g_replay_events, new_capacity * sizeof(*new_events));
+            if (new_events == NULL) {
+                perror("Error: Failed to allocate memory for session events");
+                fclose(file);
+                return -1;
+            }
+            g_replay_events = new_events;
+            capacity = new_capacity;
+        }
+        g_replay_events[g_replay_count].offset_ns = offset_ns;
+        g_replay_events[g_replay_count].command = command;
+        g_replay_count++;
+        previous_offset = offset_ns;
+    }
+
+    if (ferror(file)) {
+        if (fprintf(stderr, "Error: Failed reading session file '%s'.\r\n", path) < 0) { /* Handle error? */ }
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    if (g_replay_count == 0) {
+        if (fprintf(stderr, "Error: Session file '%s' contains no commands.\r\n", path) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    // Replay relative to the first command so startup time is not replayed
+    long long base_ns = g_replay_events[0].offset_ns;
+    for (size_t i = 0; i < g_replay_count; ++i) {
+        g_replay_events[i].offset_ns -= base_ns;
+    }
+    return 0;
+}
+
+/*
+ * replay_due_ns
+ *
+ * Computes the monotonic time at which a replay command is due, with its
+ * recorded offset scaled by the replay speed.
+ *
+ * Accepts:
+ *   index - Index into g_replay_events
+ *
+ * Returns: Due time in nanoseconds (CLOCK_MONOTONIC).
+ */
+static long long replay_due_ns(size_t index) {
+    if (g_replay_speed <= 0.0) {
+        return g_replay_start_ns; // No delays: everything is due immediately
+    }
+    return g_replay_start_ns + (long long)((double)g_replay_events[index].offset_ns / g_replay_speed);
+}
+
+/*
+ * replay_timeout_ms
+ *
+ * Computes the poll() timeout until the next replay command is due.
+ *
+ * Accepts: None
+ * Returns: Timeout in milliseconds (0 if a command is already due).
+ */
+static int replay_timeout_ms(void) {
+    long long remaining_ns = replay_due_ns(g_replay_index) - monotonic_ns();
+
+    if (remaining_ns <= 0) {
+        return 0;
+    }
+    long long timeout_ms = (remaining_ns + 999999LL) / 1000000LL; // Round up to avoid busy polling
+    return (timeout_ms > INT_MAX) ? INT_MAX : (int)timeout_ms;
+}
+
+/*
+ * issue_due_replay_commands
+ *
+ * Dispatches every replay command whose due time has passed, accumulating
+ * per-command dispatch latency and the lag behind the scheduled time.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void issue_due_replay_commands(void) {
+    while (g_replay_index < g_replay_count && !g_terminate_flag) {
+        long long now_ns = monotonic_ns();
+        long long due_ns = replay_due_ns(g_replay_index);
+
+        if (due_ns > now_ns) {
+            break;
+        }
+
+        char command = g_replay_events[g_replay_index].command;
+        long long lag_ns = now_ns - due_ns;
+        g_replay_lag_total_ns += lag_ns;
+        if (lag_ns > g_replay_lag_max_ns) {
+            g_replay_lag_max_ns = lag_ns;
+        }
+
+        long long latency_ns = dispatch_command(command);
+        if (latency_ns >= 0) {
+            command_latency_t *stats = &g_replay_latency[(unsigned char)command];
+            stats->count++;
+            stats->total_ns += latency_ns;
+            if (latency_ns > stats->max_ns) {
+                stats->max_ns = latency_ns;
+            }
+        }
+        g_replay_index++;
+    }
+}
+
+/*
+ * print_replay_summary
+ *
+ * Prints per-command dispatch latency and schedule lag for the replay.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void print_replay_summary(void) {
+    pid_t parent_pid = getpid();
+    double wall_ms = (double)(monotonic_ns() - g_replay_start_ns) / 1e6;
+
+    if (printf("PARENT [%d]: Replay complete: %zu commands in %.3f ms. Schedule lag mean %.3f ms, max %.3f ms.\r\n",
+        parent_pid, g_replay_index, wall_ms,
+        (g_replay_index > 0) ? (double)g_replay_lag_total_ns / (double)g_replay_index / 1e6 : 0.0,
+        (double)g_replay_lag_max_ns / 1e6) < 0) { /* Handle error? */ }
+
+    for (const char *cmd = SESSION_COMMANDS; *cmd != '\0'; ++cmd) {
+        const command_latency_t *stats = &g_replay_latency[(unsigned char)*cmd];
+        if (stats->count == 0) {
+            continue;
+        }
+        if (printf("  '%c': count %llu, latency mean %.3f ms, max %.3f ms\r\n", *cmd, stats->count,
+            (double)stats->total_ns / (double)stats->count / 1e6, (double)stats->max_ns / 1e6) < 0) { /* Handle error? */ }
+    }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+}
+
+/*
+ * parse_churn_mix
+ *
+ * Parses the churn operation mix "SPAWN:KILL_LAST:KILL_RANDOM:BROADCAST",
+ * four non-negative integer weights of which at least one is non-zero.
+ *
+ * Accepts:
+ *   text - Mix specification
+ *
+ * Returns:
+ *   0 on success (g_churn_weights updated), -1 if malformed.
+ */
+static int parse_churn_mix(const char *text) {
+    unsigned int weights[CHURN_OP_COUNT];
+    unsigned int total = 0;
+    const char *cursor = text;
+
+    for (int op = 0; op < CHURN_OP_COUNT; ++op) {
+        char *end = NULL;
+        errno = 0;
+        unsigned long value = strtoul(cursor, &end, 10);
+        if (errno != 0 || end == cursor || value > 1000000UL || *cursor == '-') {
+            return -1;
+        }
+        if (op < CHURN_OP_COUNT - 1 ? *end != ':' : *end != '\0') {
+            return -1;
+        }
+        weights[op] = (unsigned int)value;
+        total += weights[op];
+        cursor = end + 1;
+    }
+    if (total == 0) {
+        return -1;
+    }
+    memcpy(g_churn_weights, weights, sizeof(g_churn_weights));
+    return 0;
+}
+
+/*
+ * next_random
+ *
+ * Returns the next value of a xorshift64 generator. Statistical quality is
+ * irrelevant here; it only picks churn operations and victims.
+ *
+ * Accepts: None
+ * Returns: Pseudo-random 64-bit value.
+ */
+static unsigned long long next_random(void) {
+    unsigned long long x = g_rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    g_rng_state = x;
+    return x;
+}
+
+/*
+ * sleep_until_ns
+ *
+ * Sleeps until the given CLOCK_MONOTONIC deadline. Returns early if a
+ * termination signal sets g_terminate_flag.
+ *
+ * Accepts:
+ *   deadline_ns - Absolute monotonic time in nanoseconds
+ *
+ * Returns: None
+ */
+static void sleep_until_ns(long long deadline_ns) {
+    struct timespec deadline;
+
+    deadline.tv_sec = (time_t)(deadline_ns / 1000000000LL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000LL);
+    while (!g_terminate_flag) {
+        int result = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        if (result != EINTR) {
+            break; // Done, or an error we cannot do anything about
+        }
+    }
+}
+
+/*
+ * run_churn_generator
+ *
+ * Issues spawn, kill-last, kill-random and broadcast operations at
+ * g_churn_rate operations per second, chosen by g_churn_weights, for
+ * g_churn_duration_s seconds. Operations are paced against an absolute
+ * schedule; if the parent falls behind, operations are issued back to back.
+ * Prints throughput and failure counts, then checks the registry.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void run_churn_generator(void) {
+    static const char *const op_names[CHURN_OP_COUNT] = { "spawn", "kill-last", "kill-random", "broadcast" };
+    churn_counters_t counters[CHURN_OP_COUNT];
+    unsigned int weight_total = 0;
+    long long interval_ns = (long long)(1e9 / g_churn_rate);
+    long long start_ns = monotonic_ns();
+    long long end_ns = start_ns + (long long)(g_churn_duration_s * 1e9);
+    long long next_ns = start_ns;
+    unsigned long long broadcasts = 0;
+    pid_t parent_pid = getpid();
+
+    memset(counters, 0, sizeof(counters));
+    for (int op = 0; op < CHURN_OP_COUNT; ++op) {
+        weight_total += g_churn_weights[op];
+    }
+    if (interval_ns < 1) {
+        interval_ns = 1;
+    }
+
+    g_rng_state = (unsigned long long)start_ns ^ ((unsigned long long)parent_pid << 32);
+    if (g_rng_state == 0) {
+        g_rng_state = 0x9E3779B97F4A7C15ULL; // xorshift must not start at zero
+    }
+
+    if (printf("PARENT [%d]: Churn generator: %.1f s at %.1f ops/s, mix %u:%u:%u:%u (seed %llu).\r\n",
+        parent_pid, g_churn_duration_s, g_churn_rate,
+        g_churn_weights[CHURN_OP_SPAWN], g_churn_weights[CHURN_OP_KILL_LAST],
+        g_churn_weights[CHURN_OP_KILL_RANDOM], g_churn_weights[CHURN_OP_BROADCAST], g_rng_state) < 0) { /* Handle error? */ }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+
+    g_quiet_ops = 1;
+    while (!g_terminate_flag && next_ns < end_ns) {
+        sleep_until_ns(next_ns);
+        if (g_terminate_flag) {
+            break;
+        }
+        size_t nfds = build_poll_set();
+        if (poll(g_pollfds, (nfds_t)nfds, 0) > 0) {
+            service_child_fds(nfds); // Keep stderr pipes drained so children never block
+        }
+        reap_children();
+        if (g_subreaper && monotonic_ns() >= g_descendant_scan_ns) {
+            scan_descendants();
+        }
+        escalate_kills();
+        flush_child_log(0);
+
+        unsigned int pick = (unsigned int)(next_random() % weight_total);
+        int op = 0;
+        while (pick >= g_churn_weights[op]) {
+            pick -= g_churn_weights[op];
+            op++;
+        }
+
+        churn_counters_t *counter = &counters[op];
+        counter->issued++;
+        switch (op) {
+            case CHURN_OP_SPAWN:
+                if (spawn_child() != 0) {
+                    counter->failed++;
+                }
+                break;
+            case CHURN_OP_KILL_LAST:
+            case CHURN_OP_KILL_RANDOM: {
+                if (live_child_count() == 0) {
+                    counter->noop++;
+                    break;
+                }
+                int result;
+                if (op == CHURN_OP_KILL_LAST) {
+                    result = kill_last_child();
+                } else {
+                    // Victims already signaled count as no-ops, like a real operator retrying
+                    result = kill_child_at_index((size_t)(next_random() % g_child_count));
+                }
+                if (result < 0) {
+                    counter->failed++;
+                } else if (result > 0) {
+                    counter->noop++; // Victim had already exited
+                }
+                break;
+            }
+            case CHURN_OP_BROADCAST:
+                if (live_child_count() == 0) {
+                    counter->noop++;
+                } else if (signal_all_children((broadcasts++ % 2 == 0) ? SIGUSR1 : SIGUSR2) != 0) {
+                    counter->failed++;
+                }
+                break;
+            default:
+                break;
+        }
+        next_ns += interval_ns;
+    }
+    g_quiet_ops = 0;
+
+    double elapsed_s = (double)(monotonic_ns() - start_ns) / 1e9;
+    unsigned long long total_ops = 0;
+    unsigned long long total_failed = 0;
+    for (int op = 0; op < CHURN_OP_COUNT; ++op) {
+        total_ops += counters[op].issued;
+        total_failed += counters[op].failed;
+    }
+
+    if (printf("PARENT [%d]: Churn complete: %llu ops in %.3f s (%.1f ops/s, target %.1f), %llu failed.\r\n",
+        parent_pid, total_ops, elapsed_s, (elapsed_s > 0.0) ? (double)total_ops / elapsed_s : 0.0,
+        g_churn_rate, total_failed) < 0) { /* Handle error? */ }
+    for (int op = 0; op < CHURN_OP_COUNT; ++op) {
+        if (printf("  %-11s issued %llu, failed %llu, no-op %llu\r\n", op_names[op],
+            counters[op].issued, counters[op].failed, counters[op].noop) < 0) { /* Handle error? */ }
+    }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+
+    sleep_until_ns(monotonic_ns() + CHURN_SETTLE_NS);
+    escalate_kills(); // The grace period is shorter than the settle time
+    sleep_until_ns(monotonic_ns() + CHURN_SETTLE_NS);
+    size_t nfds = build_poll_set();
+    if (poll(g_pollfds, (nfds_t)nfds, 0) > 0) {
+        service_child_fds(nfds);
+    }
+    reap_children();
+    if (g_subreaper) {
+        scan_descendants(); // Orphans adopted since the last scan are tracked, not leaked
+    }
+    flush_child_log(1);
+    check_registry_consistency();
+    print_reap_metrics();
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+}
+
+/*
+ * read_proc_stat
+ *
+ * Reads the state letter and parent PID of a process from /proc/<pid>/stat.
+ * The command name may contain spaces and parentheses, so parsing starts
+ * after the last ')'.
+ *
+ * Accepts:
+ *   pid - Process to inspect
+ *   state - Output: state letter (R, S, D, Z, T, ...)
+ *   ppid - Output: parent PID
+ *
+ * Returns:
+ *   0 on success, -1 if the process does not exist or the file is malformed.
+ */
+static int read_proc_stat(pid_t pid, char *state, pid_t *ppid) {
+    char path[64];
+    char buf[PROC_STAT_LEN];
+    int ppid_value;
+
+    if (snprintf(path, sizeof(path), "/proc/%d/stat", pid) < 0) {
+        return -1;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) {
+        return -1;
+    }
+    buf[len] = '\0';
+
+    char *close_paren = strrchr(buf, ')');
+    if (close_paren == NULL || sscanf(close_paren + 1, " %c %d", state, &ppid_value) != 2) {
+        return -1;
+    }
+    *ppid = (pid_t)ppid_value;
+    return 0;
+}
+
+/*
+ * check_registry_consistency
+ *
+ * Compares the registry with what the kernel reports. Each tracked PID is
+ * classified as alive, zombie (exited but not reaped) or stale (no longer
+ * exists), and the per-state counters are checked against the entries.
+ * /proc is then scanned for children of this process that the registry
+ * does not know about.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void check_registry_consistency(void) {
+    pid_t parent_pid = getpid();
+    size_t tracked_alive = 0;
+    size_t tracked_zombie = 0;
+    size_t tracked_stale = 0;
+    size_t untracked_alive = 0;
+    size_t untracked_zombie = 0;
+    char state;
+    pid_t ppid;
+
+    size_t recounted[CHILD_STATE_COUNT];
+    int counters_match = 1;
+
+    memset(recounted, 0, sizeof(recounted));
+    for (size_t i = 0; i < g_child_count; ++i) {
+        recounted[g_children[i].state]++;
+        // A descendant (-O) is the child of its own parent until it is adopted
+        if (read_proc_stat(g_children[i].pid, &state, &ppid) != 0 ||
+            (ppid != parent_pid && (!g_children[i].descendant || ppid != g_children[i].parent_pid))) {
+            tracked_stale++; // Gone, or the PID was reused by an unrelated process
+        } else if (state == 'Z') {
+            tracked_zombie++;
+        } else {
+            tracked_alive++;
+        }
+    }
+
+    DIR *proc_dir = opendir("/proc");
+    if (proc_dir == NULL) {
+        if (fprintf(stderr, "Warning: Cannot open /proc to look for untracked children (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+    } else {
+        struct dirent *entry;
+        while ((entry = readdir(proc_dir)) != NULL) {
+            char *end = NULL;
+            long pid_value = strtol(entry->d_name, &end, 10);
+            if (end == entry->d_name || *end != '\0' || pid_value <= 0) {
+                continue; // Not a process directory
+            }
+            pid_t pid = (pid_t)pid_value;
+            if (read_proc_stat(pid, &state, &ppid) != 0 || ppid != parent_pid) {
+                continue;
+            }
+            int tracked = 0;
+            if (find_child_index(pid) >= 0 || pid == g_sampler_pid || pid == g_spawn_helper_pid) {
+                tracked = 1;
+            }
+            if (!tracked) {
+                if (state == 'Z') {
+                    untracked_zombie++;
+                } else {
+                    untracked_alive++;
+                }
+            }
+        }
+        closedir(proc_dir);
+    }
+    for (int st = 0; st < CHILD_STATE_REAPED; ++st) { // REAPED is cumulative, not recountable
+        if (recounted[st] != g_state_counts[st]) {
+            counters_match = 0;
+        }
+    }
+
+    if (printf("PARENT [%d]: Registry: %zu tracked (%zu alive, %zu zombie, %zu stale); untracked children: %zu alive, %zu zombie.\r\n",
+        parent_pid, g_child_count, tracked_alive, tracked_zombie, tracked_stale, untracked_alive, untracked_zombie) < 0) { /* Handle error? */ }
+    if (!counters_match) {
+        if (printf("PARENT [%d]: Registry INCONSISTENT: per-state counters do not match the entries.\r\n", parent_pid) < 0) { /* Handle error? */ }
+    }
+    if (untracked_alive > 0 || tracked_zombie > 0 || untracked_zombie > 0) {
+        if (printf("PARENT [%d]: Registry INCONSISTENT: children are leaked or not reaped.\r\n", parent_pid) < 0) { /* Handle error? */ }
+    } else if (counters_match) {
+        if (printf("PARENT [%d]: Registry consistent.\r\n", parent_pid) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * enable_subreaper
+ *
+ * Makes the parent a child subreaper (-O): descendants of its children
+ * whose own parent exits are reparented to it instead of to init, so their
+ * exit is reported to it and it reaps them.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int enable_subreaper(void) {
+    if (prctl(PR_SET_CHILD_SUBREAPER, 1L, 0L, 0L, 0L) == -1) {
+        if (fprintf(stderr, "Error: Failed to become a child subreaper (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    g_descendant_scan_ns = monotonic_ns() + g_descendant_scan_period_ns;
+    if (printf("Subreaper: descendants of the children are tracked (scanned every %lld ms) and orphans re-adopted\r\n",
+        g_descendant_scan_period_ns / 1000000LL) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * read_task_children
+ *
+ * Reads the children of a process from /proc/PID/task/PID/children, i.e.
+ * those forked by its main thread (and orphans reparented to it).
+ *
+ * Accepts:
+ *   pid - Process to look at
+ *   pids - Output: child PIDs
+ *   max_pids - Capacity of pids
+ *
+ * Returns: Number of PIDs stored (0 if the process is gone).
+ */
+static size_t read_task_children(pid_t pid, pid_t *pids, size_t max_pids) {
+    char path[64];
+    char buf[DESCENDANT_SCAN_MAX * 12];
+    size_t count = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/children", (int)pid, (int)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    buf[len] = '\0';
+
+    char *cursor = buf;
+    while (count < max_pids) {
+        char *end = NULL;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        if (value > 0) {
+            pids[count++] = (pid_t)value;
+        }
+        cursor = end;
+    }
+    return count;
+}
+
+/*
+ * note_descendant
+ *
+ * Adds a process found in the tree to the registry as a DESCENDANT, unless
+ * it is already tracked or is the sampler or spawn helper. A pidfd is
+ * opened for it where possible, so a later SIGKILL cannot reach a process
+ * that reused its PID.
+ *
+ * Accepts:
+ *   pid - Process found
+ *   parent_pid - Tracked process it is a child of, or 0 if it was found
+ *     among the parent's own children (an orphan whose parent was never seen)
+ *
+ * Returns: None
+ */
+static void note_descendant(pid_t pid, pid_t parent_pid) {
+    if (pid == g_sampler_pid || pid == g_spawn_helper_pid || find_child_index(pid) >= 0) {
+        return;
+    }
+    int pidfd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pidfd == -1 && errno == ESRCH) {
+        return; // Already gone
+    }
+
+    // add_child_entry aborts on failure
+    child_entry_t *child = add_child_entry(pid, -1, -1, -1);
+    child->pidfd = pidfd; // -1 without pidfd_open(); signals then go through kill()
+    child->descendant = 1;
+    child->parent_pid = parent_pid;
+    child->adopted = (parent_pid == 0);
+    set_child_state(child, CHILD_STATE_DESCENDANT);
+    g_descendants_found++;
+    if (child->adopted) {
+        g_orphans_adopted++;
+    }
+}
+
+/*
+ * scan_descendants
+ *
+ * Walks the process tree below the parent (-O). A tracked descendant whose
+ * pidfd reported its exit (EXITED) and that no longer exists was reaped by
+ * its own parent; it leaves the registry for the list of recently reaped
+ * children. Without a pidfd, a descendant that is gone or has a new parent
+ * is treated the same way. Descendants now parented by this process were
+ * adopted. The parent's own children that were never spawned are orphans;
+ * the children of every tracked process that has not exited (descendants
+ * found in this scan included) are descendants.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void scan_descendants(void) {
+    pid_t self = getpid();
+    pid_t pids[DESCENDANT_SCAN_MAX];
+    char state;
+    pid_t ppid;
+
+    for (size_t i = g_child_count; i > 0; --i) {
+        child_entry_t *child = &g_children[i - 1];
+        if (!child->descendant) {
+            continue;
+        }
+        if (child->state == CHILD_STATE_EXITED && child->pidfd != -1) {
+            // A zombie still answers signal 0; an exited child of this process is the reaper's
+            if (syscall(SYS_pidfd_send_signal, child->pidfd, 0, NULL, 0) == -1 && errno == ESRCH) {
+                child->exit_status = -1; // Collected by its own parent
+                g_descendants_gone++;
+                retire_child(i - 1, monotonic_ns());
+            }
+            continue;
+        }
+        if (child->pidfd == -1 &&
+            (read_proc_stat(child->pid, &state, &ppid) != 0 || (ppid != self && ppid != child->parent_pid))) {
+            child->exit_ns = monotonic_ns(); // Within one scan period
+            child->exit_status = -1;
+            g_descendants_gone++;
+            retire_child(i - 1, child->exit_ns);
+        } else if (!child->adopted && read_proc_stat(child->pid, &state, &ppid) == 0 && ppid == self) {
+            child->adopted = 1;
+            g_orphans_adopted++;
+        }
+    }
+
+    size_t count = read_task_children(self, pids, DESCENDANT_SCAN_MAX);
+    for (size_t k = 0; k < count; ++k) {
+        note_descendant(pids[k], 0);
+    }
+    for (size_t i = 0; i < g_child_count; ++i) { // Grows while descendants are found
+        if (g_children[i].state == CHILD_STATE_EXITED) {
+            continue;
+        }
+        pid_t parent_pid = g_children[i].pid;
+        count = read_task_children(parent_pid, pids, DESCENDANT_SCAN_MAX);
+        for (size_t k = 0; k < count; ++k) {
+            note_descendant(pids[k], parent_pid);
+        }
+    }
+    g_descendant_scan_ns = monotonic_ns() + g_descendant_scan_period_ns;
+}
+
+/*
+ * handle_descendant_exit
+ *
+ * Notes the exit of a descendant whose pidfd became readable (-O): it
+ * becomes EXITED with its exit time and its pidfd leaves the poll set. The
+ * entry stays listed until it is reaped, by this process if it adopted the
+ * descendant, otherwise as noticed by the next scan.
+ *
+ * Accepts:
+ *   child - The descendant whose pidfd is readable
+ *
+ * Returns: None
+ */
+static void handle_descendant_exit(child_entry_t *child) {
+    if (child->state != CHILD_STATE_DESCENDANT) {
+        return;
+    }
+    child->exit_ns = monotonic_ns();
+    set_child_state(child, CHILD_STATE_EXITED);
+}
+
+/*
+ * descendant_timeout_ms
+ *
+ * Shortens the main loop's poll timeout so the next descendant scan (-O)
+ * runs on time.
+ *
+ * Accepts:
+ *   timeout_ms - Timeout computed so far (-1 = infinite)
+ *
+ * Returns: The possibly shortened timeout.
+ */
+static int descendant_timeout_ms(int timeout_ms) {
+    if (!g_subreaper) {
+        return timeout_ms;
+    }
+    long long now_ns = monotonic_ns();
+    long long wait_ms = (g_descendant_scan_ns > now_ns) ? (g_descendant_scan_ns - now_ns + 999999LL) / 1000000LL : 0;
+    return (timeout_ms < 0 || wait_ms < timeout_ms) ? (int)wait_ms : timeout_ms;
+}
+
+/*
+ * restart_signal_set
+ *
+ * Signals held back while the parent re-executes itself ('H'): those it
+ * handles, whose default action (after execv() resets the handlers) would
+ * either lose them or kill the new parent before it has installed its own.
+ * They stay pending across execv() and are delivered to the new handlers.
+ *
+ * Accepts:
+ *   set - Output: the signal set
+ *
+ * Returns: None
+ */
+static void restart_signal_set(sigset_t *set) {
+    sigemptyset(set);
+    sigaddset(set, SIGCHLD);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGQUIT);
+    sigaddset(set, CHILD_ROUND_SIGNAL);
+}
+
+/*
+ * set_restart_fds_inheritable
+ *
+ * Clears (or sets again) FD_CLOEXEC on every descriptor the registry and
+ * the stats region hold: the exec-status and stderr pipes, the pidfds and
+ * the region itself. Only these survive the re-exec; everything else (log,
+ * results store, PSI triggers, cgroup) is reopened by the new parent.
+ *
+ * Accepts:
+ *   inheritable - 1 to keep the descriptors open across execv(), 0 to close them on exec again
+ *
+ * Returns: None
+ */
+static void set_restart_fds_inheritable(int inheritable) {
+    int flags = inheritable ? 0 : FD_CLOEXEC;
+
+    if (g_stats_fd != -1) {
+        fcntl(g_stats_fd, F_SETFD, flags);
+    }
+    for (size_t i = 0; i < g_child_count; ++i) {
+        const child_entry_t *child = &g_children[i];
+        const int fds[3] = { child->exec_fd, child->err_fd, child->pidfd };
+        for (int f = 0; f < 3; ++f) {
+            if (fds[f] != -1) {
+                fcntl(fds[f], F_SETFD, flags);
+            }
+        }
+    }
+}
+
+/*
+ * write_restart_image
+ *
+ * Serializes what the new parent needs to carry on into an unlinked memfd
+ * (not close-on-exec): a restart_header_t with the counters and the stats
+ * region, one restart_child_t per registry entry (including its
+ * descriptor numbers, which stay valid across execv()) and the partial
+ * results.
+ *
+ * Accepts:
+ *   requested_ns - When 'H' was read (CLOCK_MONOTONIC)
+ *   dashboard_active - The dashboard was shown, so the new parent shows it again
+ *
+ * Returns: The memfd, or -1 on failure (errno set).
+ */
+static int write_restart_image(long long requested_ns, int dashboard_active) {
+    size_t len = sizeof(restart_header_t) + g_child_count * sizeof(restart_child_t) + g_partial_count * sizeof(partial_result_t);
+    unsigned char *image = calloc(1, len);
+    int saved_errno;
+
+    if (image == NULL) {
+        return -1;
+    }
+    int fd = memfd_create("lab03-restart", 0); // Inherited by the new parent
+    if (fd == -1) {
+        saved_errno = errno;
+        free(image);
+        errno = saved_errno;
+        return -1;
+    }
+
+    restart_header_t *header = (restart_header_t *)image;
+    memcpy(header->magic, RESTART_MAGIC, sizeof(header->magic));
+    header->version = RESTART_VERSION;
+    header->header_size = sizeof(restart_header_t);
+    header->child_size = sizeof(restart_child_t);
+    header->partial_size = sizeof(partial_result_t);
+    header->child_count = g_child_count;
+    header->partial_count = g_partial_count;
+    header->requested_ns = requested_ns;
+    header->start_ns = g_start_ns;
+    header->restart_count = g_restart_count;
+    header->restart_pause_total_ns = g_restart_pause_total_ns;
+    header->stats_fd = g_stats_fd;
+    header->sampler_pid = g_sampler_pid;
+    header->stats_len = g_stats_region_len;
+    header->sched = g_sched_spec;
+    header->sched_preset_index = (uint32_t)g_sched_preset_index;
+    header->interval_preset_index = (uint32_t)g_interval_preset_index;
+    header->dump_tag = g_dump_tag;
+    header->dashboard_active = dashboard_active;
+    header->state_reaped = g_state_counts[CHILD_STATE_REAPED];
+    header->exit_normal = g_exit_normal;
+    header->exit_failed = g_exit_failed;
+    header->exit_signaled = g_exit_signaled;
+    header->spawned_total = g_spawned_total;
+    header->spawn_calls = g_spawn_calls;
+    header->spawn_call_total_ns = g_spawn_call_total_ns;
+    header->pause_count = g_pause_count;
+    header->fleet_paused_ns = g_fleet_paused_ns;
+    header->fleet_paused_total_ns = g_fleet_paused_total_ns;
+    header->rounds_collected = g_rounds_collected;
+    header->round_release_failed = g_round_release_failed;
+    header->descendants_found = g_descendants_found;
+    header->orphans_adopted = g_orphans_adopted;
+    header->descendants_reaped = g_descendants_reaped;
+    header->descendants_gone = g_descendants_gone;
+    header->orphans_unseen = g_orphans_unseen;
+    header->checkpoints_lost = g_checkpoints_lost;
+    header->completed = g_completed;
+    header->reap_metrics = g_reap_metrics;
+    header->log_metrics = g_log_metrics;
+    memcpy(header->reaped_recent, g_reaped_recent, sizeof(g_reaped_recent));
+    header->reaped_recent_total = g_reaped_recent_total;
+
+    restart_child_t *records = (restart_child_t *)(image + sizeof(restart_header_t));
+    for (size_t i = 0; i < g_child_count; ++i) {
+        const child_entry_t *child = &g_children[i];
+        restart_child_t *record = &records[i];
+        record->pid = child->pid;
+        record->state = (int32_t)child->state;
+        record->spawn_ns = child->spawn_ns;
+        record->ready_ns = child->ready_ns;
+        record->exit_ns = child->exit_ns;
+        record->exit_status = child->exit_status;
+        record->last_signal = child->last_signal;
+        record->exec_fd = child->exec_fd;
+        record->err_fd = child->err_fd;
+        record->pidfd = child->pidfd;
+        record->slot = child->slot;
+        record->resumed_reps = child->resumed_reps;
+        record->duration_s = child->duration_s;
+        record->paused_ns = child->paused_ns;
+        record->paused_total_ns = child->paused_total_ns;
+        record->rounds_collected = child->rounds_collected;
+        record->descendant = child->descendant;
+        record->parent_pid = child->parent_pid;
+        record->adopted = child->adopted;
+        record->sched = child->sched;
+        record->err_len = (uint32_t)child->err_len;
+        memcpy(record->err_line, child->err_line, child->err_len);
+    }
+    if (g_partial_count > 0) {
+        memcpy(image + sizeof(restart_header_t) + g_child_count * sizeof(restart_child_t), g_partials,
+            g_partial_count * sizeof(partial_result_t));
+    }
+
+    header->exec_ns = monotonic_ns();
+    if (safe_write(fd, image, len) != (ssize_t)len) {
+        saved_errno = errno;
+        free(image);
+        close(fd);
+        errno = saved_errno;
+        return -1;
+    }
+    free(image);
+    return fd;
+}
+
+/*
+ * hot_restart
+ *
+ * Re-executes the parent binary ('H') without stopping the fleet: the
+ * registry, the children's descriptors and the stats region are handed to
+ * the new parent through a memfd (write_restart_image), which re-adopts
+ * the children (they stay the same process's children across execv()).
+ * Signals the parent handles are blocked meanwhile and delivered to the
+ * new parent. The spawn helper is restarted by the new parent; an external
+ * sampler keeps running. Plain spawns still deferred by -P are dropped,
+ * deferred resumes become partial results again. Refused while thread
+ * workers are live or a session is recorded, replayed or churned, since
+ * the new parent could not continue those. If execv() fails, everything is
+ * restored and the parent carries on.
+ *
+ * Accepts: None
+ * Returns:
+ *   -1 if the restart was refused or failed; does not return otherwise.
+ */
+static int hot_restart(void) {
+    long long requested_ns = monotonic_ns();
+    pid_t parent_pid = getpid();
+    const char *reason = NULL;
+
+    if (g_worker_count > 0) {
+        reason = "thread workers cannot survive execv(); stop them first ('k')";
+    } else if (g_session_file != NULL) {
+        reason = "the new parent would truncate the session being recorded (-w)";
+    } else if (g_replay_path != NULL) {
+        reason = "the new parent would replay the session (-r) again";
+    } else if (g_churn_duration_s > 0.0) {
+        reason = "the new parent would run the churn generator (-g) again";
+    } else if (g_self_exe_path[0] == '\0' || access(g_self_exe_path, X_OK) != 0) {
+        reason = "the parent's executable cannot be found";
+    }
+    if (reason != NULL) {
+        if (fprintf(stderr, "PARENT [%d]: Hot restart refused: %s.\r\n", parent_pid, reason) < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    int dashboard_was_active = g_dashboard_active;
+    if (g_dashboard_active) {
+        toggle_dashboard();
+    }
+    if (printf("PARENT [%d]: Hot restart: re-executing %s with %zu tracked children.\r\n",
+        parent_pid, g_self_exe_path, g_child_count) < 0) { /* Handle error? */ }
+    flush_child_log(1);
+    size_t deferred_dropped = 0;
+    for (size_t i = 0; i < g_deferred_count; ++i) {
+        deferred_dropped += !g_deferred[(g_deferred_head + i) % g_deferred_capacity].has_resume;
+    }
+    requeue_deferred_resumes();
+    if (deferred_dropped > 0) {
+        if (fprintf(stderr, "PARENT [%d]: Warning: %zu deferred spawns dropped by the restart.\r\n", parent_pid, deferred_dropped) < 0) { /* Handle error? */ }
+    }
+    stop_spawn_helper(); // The new parent starts its own (without the inherited descriptors)
+
+    sigset_t block_set, old_set;
+    restart_signal_set(&block_set);
+    sigprocmask(SIG_BLOCK, &block_set, &old_set);
+
+    int exec_errno = 0;
+    int image_fd = write_restart_image(requested_ns, dashboard_was_active);
+    if (image_fd == -1) {
+        exec_errno = errno;
+    } else {
+        char fd_text[16];
+        snprintf(fd_text, sizeof(fd_text), "%d", image_fd);
+        set_restart_fds_inheritable(1);
+        if (setenv(RESTART_ENV, fd_text, 1) == -1) {
+            exec_errno = errno;
+        } else {
+            if (g_stdin_interactive) {
+                disable_raw_mode(); // The new parent saves the terminal settings again
+            }
+            if (fflush(stdout) == EOF || fflush(stderr) == EOF) { /* Handle error? */ }
+            execv(g_self_exe_path, g_argv);
+            exec_errno = errno;
+            unsetenv(RESTART_ENV);
+            if (g_stdin_interactive) {
+                enable_raw_mode();
+            }
+        }
+        set_restart_fds_inheritable(0);
+        close(image_fd);
+    }
+
+    sigprocmask(SIG_SETMASK, &old_set, NULL);
+    if (fprintf(stderr, "PARENT [%d]: Hot restart failed (errno %d: %s); the parent carries on.\r\n",
+        parent_pid, exec_errno, strerror(exec_errno)) < 0) { /* Handle error? */ }
+    if (g_spawn_helper && start_spawn_helper() != 0) {
+        if (fprintf(stderr, "PARENT [%d]: Warning: Children are created directly from now on.\r\n", parent_pid) < 0) { /* Handle error? */ }
+    }
+    if (dashboard_was_active) {
+        toggle_dashboard();
+    }
+    return -1;
+}
+
+/*
+ * load_restart_image
+ *
+ * Called early in main(): if the parent was re-executed by 'H'
+ * (RESTART_ENV names the image memfd), reads and checks the image and
+ * marks the inherited descriptors close-on-exec again. The image is kept
+ * in g_restart_header/g_restart_children/g_restart_partials until
+ * adopt_stats_region() and restore_registry() apply it.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 if there is no image or it was loaded (g_restarted set), -1 if it is
+ *   unusable (prints error message; the children are then left to finish
+ *   as orphans).
+ */
+static int load_restart_image(void) {
+    const char *fd_text = getenv(RESTART_ENV);
+    char *end = NULL;
+
+    if (fd_text == NULL) {
+        return 0;
+    }
+    long fd_value = strtol(fd_text, &end, 10);
+    unsetenv(RESTART_ENV); // Not for the children
+    if (end == fd_text || *end != '\0' || fd_value < 0 || fd_value > INT_MAX) {
+        if (fprintf(stderr, "Error: Malformed %s.\r\n", RESTART_ENV) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    int fd = (int)fd_value;
+
+    restart_header_t *header = &g_restart_header;
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header) ||
+        memcmp(header->magic, RESTART_MAGIC, sizeof(header->magic)) != 0 || header->version != RESTART_VERSION ||
+        header->header_size != sizeof(restart_header_t) || header->child_size != sizeof(restart_child_t) ||
+        header->partial_size != sizeof(partial_result_t) || header->child_count > SIZE_MAX / sizeof(restart_child_t) ||
+        header->partial_count > SIZE_MAX / sizeof(partial_result_t)) {
+        if (fprintf(stderr, "Error: The hot restart image is unreadable or from an incompatible parent (version %u expected).\r\n",
+            RESTART_VERSION) < 0) { /* Handle error? */ }
+        close(fd);
+        return -1;
+    }
+
+    size_t children_len = (size_t)header->child_count * sizeof(restart_child_t);
+    size_t partials_len = (size_t)header->partial_count * sizeof(partial_result_t);
+    g_restart_children = malloc(children_len > 0 ? children_len : 1);
+    g_restart_partials = malloc(partials_len > 0 ? partials_len : 1);
+    if (g_restart_children == NULL || g_restart_partials == NULL ||
+        pread(fd, g_restart_children, children_len, sizeof(restart_header_t)) != (ssize_t)children_len ||
+        pread(fd, g_restart_partials, partials_len, (off_t)(sizeof(restart_header_t) + children_len)) != (ssize_t)partials_len) {
+        if (fprintf(stderr, "Error: Failed to read the hot restart image (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    if (header->stats_fd != -1) {
+        fcntl(header->stats_fd, F_SETFD, FD_CLOEXEC);
+    }
+    for (size_t i = 0; i < header->child_count; ++i) {
+        const restart_child_t *record = &g_restart_children[i];
+        const int fds[3] = { record->exec_fd, record->err_fd, record->pidfd };
+        for (int f = 0; f < 3; ++f) {
+            if (fds[f] != -1) {
+                fcntl(fds[f], F_SETFD, FD_CLOEXEC);
+            }
+        }
+    }
+    g_restarted = 1;
+    return 0;
+}
+
+/*
+ * close_restart_fds
+ *
+ * Closes the descriptors a hot restart image names (the stats region and
+ * the children's pipes and pidfds). Called in a process forked by a
+ * restarted parent before restore_registry() has freed the image, i.e.
+ * the spawn helper, which has no use for them. Does nothing otherwise.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void close_restart_fds(void) {
+    if (!g_restarted || g_restart_children == NULL) {
+        return;
+    }
+    if (g_restart_header.stats_fd != -1) {
+        close(g_restart_header.stats_fd);
+    }
+    for (size_t i = 0; i < g_restart_header.child_count; ++i) {
+        const restart_child_t *record = &g_restart_children[i];
+        const int fds[3] = { record->exec_fd, record->err_fd, record->pidfd };
+        for (int f = 0; f < 3; ++f) {
+            if (fds[f] != -1) {
+                close(fds[f]);
+            }
+        }
+    }
+}
+
+/*
+ * adopt_stats_region
+ *
+ * Maps the stats region inherited from the previous parent instead of
+ * creating one, and rebuilds the free slot stack without the slots the
+ * restored children hold. An external sampler still running keeps it.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int adopt_stats_region(void) {
+    unsigned char used[STATS_SLOT_COUNT];
+
+    g_sampler_pid = (g_restart_header.sampler_pid > 0) ? g_restart_header.sampler_pid : -1;
+    if (g_restart_header.stats_fd == -1) {
+        return -1;
+    }
+    g_stats_fd = g_restart_header.stats_fd;
+    void *region = map_stats_region(g_stats_fd, (size_t)g_restart_header.stats_len, g_huge_pages ? "the inherited region" : NULL);
+    if (region == MAP_FAILED) {
+        if (fprintf(stderr, "Error: Failed to map the inherited stats region (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(g_stats_fd);
+        g_stats_fd = -1;
+        return -1;
+    }
+    g_stats_slots = region;
+
+    memset(used, 0, sizeof(used));
+    for (size_t i = 0; i < g_restart_header.child_count; ++i) {
+        int slot = g_restart_children[i].slot;
+        if (slot >= 0 && slot < STATS_SLOT_COUNT) {
+            used[slot] = 1;
+        }
+    }
+    g_free_slot_count = 0;
+    for (int slot = STATS_SLOT_COUNT - 1; slot >= 0; --slot) {
+        if (!used[slot]) {
+            g_free_slots[g_free_slot_count++] = slot;
+        }
+    }
+    return 0;
+}
+
+/*
+ * restore_registry
+ *
+ * Fills the (freshly allocated) registry and the counters from the hot
+ * restart image, then frees the image. The per-state counters are rebuilt
+ * from the entries.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on allocation failure (prints error message).
+ */
+static int restore_registry(void) {
+    const restart_header_t *header = &g_restart_header;
+    size_t count = (size_t)header->child_count;
+
+    if (count > g_child_capacity) {
+        child_entry_t *children = realloc(g_children, count * sizeof(child_entry_t));
+        if (children == NULL) {
+            perror("Error: Failed to allocate memory for the restored registry");
+            return -1;
+        }
+        g_children = children;
+        g_child_capacity = count;
+    }
+    memset(g_state_counts, 0, sizeof(g_state_counts));
+    for (size_t i = 0; i < count; ++i) {
+        const restart_child_t *record = &g_restart_children[i];
+        child_entry_t *child = &g_children[i];
+        memset(child, 0, sizeof(*child));
+        child->pid = record->pid;
+        child->state = (record->state >= 0 && record->state < CHILD_STATE_REAPED) ? (child_state_t)record->state : CHILD_STATE_EXITED;
+        child->spawn_ns = record->spawn_ns;
+        child->ready_ns = record->ready_ns;
+        child->exit_ns = record->exit_ns;
+        child->exit_status = record->exit_status;
+        child->last_signal = record->last_signal;
+        child->exec_fd = record->exec_fd;
+        child->err_fd = record->err_fd;
+        child->pidfd = record->pidfd;
+        child->slot = record->slot;
+        child->resumed_reps = record->resumed_reps;
+        child->duration_s = record->duration_s;
+        child->paused_ns = record->paused_ns;
+        child->paused_total_ns = record->paused_total_ns;
+        child->rounds_collected = record->rounds_collected;
+        child->descendant = record->descendant;
+        child->parent_pid = record->parent_pid;
+        child->adopted = record->adopted;
+        if (child->state == CHILD_STATE_SIGNALED && child->last_signal == SIGTERM) {
+            child->kill_deadline_ns = monotonic_ns() + KILL_GRACE_NS; // Deadlines are not in the image
+            g_kill_escalations++;
+        }
+        child->sched = record->sched;
+        child->err_len = (record->err_len < ERR_LINE_LEN) ? record->err_len : 0;
+        memcpy(child->err_line, record->err_line, child->err_len);
+        g_state_counts[child->state]++;
+    }
+    g_child_count = count;
+    g_state_counts[CHILD_STATE_REAPED] = (size_t)header->state_reaped;
+
+    g_start_ns = header->start_ns;
+    g_restart_count = header->restart_count;
+    g_restart_pause_total_ns = header->restart_pause_total_ns;
+    g_sched_spec = header->sched;
+    g_sched_preset_index = header->sched_preset_index % SCHED_PRESET_COUNT;
+    g_interval_preset_index = header->interval_preset_index % INTERVAL_PRESET_COUNT;
+    g_dump_tag = header->dump_tag;
+    g_dashboard_active = header->dashboard_active;
+    g_exit_normal = header->exit_normal;
+    g_exit_failed = header->exit_failed;
+    g_exit_signaled = header->exit_signaled;
+    g_spawned_total = header->spawned_total;
+    g_spawn_calls = header->spawn_calls;
+    g_spawn_call_total_ns = header->spawn_call_total_ns;
+    g_pause_count = header->pause_count;
+    g_fleet_paused_ns = header->fleet_paused_ns;
+    g_fleet_paused_total_ns = header->fleet_paused_total_ns;
+    g_rounds_collected = header->rounds_collected;
+    g_round_release_failed = header->round_release_failed;
+    g_descendants_found = header->descendants_found;
+    g_orphans_adopted = header->orphans_adopted;
+    g_descendants_reaped = header->descendants_reaped;
+    g_descendants_gone = header->descendants_gone;
+    g_orphans_unseen = header->orphans_unseen;
+    g_checkpoints_lost = header->checkpoints_lost;
+    g_completed = header->completed;
+    g_reap_metrics = header->reap_metrics;
+    g_log_metrics = header->log_metrics;
+    memcpy(g_reaped_recent, header->reaped_recent, sizeof(g_reaped_recent));
+    g_reaped_recent_total = header->reaped_recent_total;
+
+    for (size_t i = 0; i < header->partial_count; ++i) {
+        const partial_result_t *partial = &g_restart_partials[i];
+        add_partial_result(partial->pid, &partial->sched, &partial->data);
+    }
+    free(g_restart_children);
+    g_restart_children = NULL;
+    free(g_restart_partials);
+    g_restart_partials = NULL;
+    return 0;
+}
+
+/*
+ * finish_hot_restart
+ *
+ * Last step of a hot restart, right before the main loop: lets the signals
+ * held back since 'H' in (to the new handlers), reaps children that exited
+ * meanwhile, re-checks persistent children's rounds and reports the pause,
+ * from 'H' being read to now.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void finish_hot_restart(void) {
+    sigset_t block_set;
+
+    restart_signal_set(&block_set);
+    sigprocmask(SIG_UNBLOCK, &block_set, NULL);
+
+    long long now_ns = monotonic_ns();
+    g_restart_pause_last_ns = now_ns - g_restart_header.requested_ns;
+    g_restart_pause_total_ns += g_restart_pause_last_ns;
+    g_restart_count++;
+    TRACE_PROBE2(hot_restart, g_restart_header.child_count, g_restart_pause_last_ns);
+    if (printf("PARENT [%d]: Hot restart complete in %.1f ms (%.1f ms to save the state, %.1f ms to exec and restore); "
+        "%llu tracked processes re-adopted, %zu partial results kept.\r\n",
+        getpid(), (double)g_restart_pause_last_ns / 1e6, (double)(g_restart_header.exec_ns - g_restart_header.requested_ns) / 1e6,
+        (double)(now_ns - g_restart_header.exec_ns) / 1e6, (unsigned long long)g_restart_header.child_count,
+        g_partial_count) < 0) { /* Handle error? */ }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+
+    reap_children(); // Children that exited during the restart
+    if (g_round_limit >= 0) {
+        g_rounds_pending = 1; // A round may have completed while the signal was held
+    }
+}
+
+/*
+ * initialize_globals
+ *
+ * Explicitly initializes static global variables at runtime.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void initialize_globals(void) {
+    g_children = NULL;
+    g_child_count = 0;
+    g_child_capacity = 0;
+    memset(g_state_counts, 0, sizeof(g_state_counts));
+    memset(g_reaped_recent, 0, sizeof(g_reaped_recent));
+    g_reaped_recent_total = 0;
+    g_kill_escalations = 0;
+    g_kills_escalated = 0;
+    g_exit_normal = 0;
+    g_exit_failed = 0;
+    g_exit_signaled = 0;
+    g_pollfds = NULL;
+    g_poll_owners = NULL;
+    g_pollfd_capacity = 0;
+    memset(&g_orig_termios, 0, sizeof(g_orig_termios)); // Initialize original termios settings
+    g_child_exec_path[0] = '\0';
+    g_terminate_flag = 0;
+    g_sched_spec = g_sched_presets[0];
+    g_sched_preset_index = 0;
+    g_interval_preset_index = INTERVAL_PRESET_COUNT - 1;
+    g_dump_tag = 0;
+    g_pause_count = 0;
+    g_fleet_paused_ns = 0;
+    g_fleet_paused_total_ns = 0;
+    g_clone3_available = 1;
+    g_cgroup_path = NULL;
+    g_cgroup_fd = -1;
+    g_cgroup_procs_fd = -1;
+    g_round_limit = -1;
+    g_rounds_pending = 0;
+    g_rounds_collected = 0;
+    g_round_release_failed = 0;
+    g_subreaper = 0;
+    g_descendant_scan_ns = 0;
+    g_descendant_scan_period_ns = DESCENDANT_SCAN_NS;
+    g_descendants_found = 0;
+    g_orphans_adopted = 0;
+    g_descendants_reaped = 0;
+    g_descendants_gone = 0;
+    g_orphans_unseen = 0;
+    g_self_exe_path[0] = '\0';
+    g_argv = NULL;
+    g_restarted = 0;
+    memset(&g_restart_header, 0, sizeof(g_restart_header));
+    g_restart_children = NULL;
+    g_restart_partials = NULL;
+    g_restart_count = 0;
+    g_restart_pause_last_ns = 0;
+    g_restart_pause_total_ns = 0;
+    g_spawn_helper = 0;
+    g_spawn_helper_pid = -1;
+    g_spawn_helper_fd = -1;
+    g_spawn_calls = 0;
+    g_spawn_call_total_ns = 0;
+    g_thread_workers = 0;
+    g_initial_spawns = 0;
+    g_workers = NULL;
+    g_worker_count = 0;
+    g_worker_capacity = 0;
+    g_worker_pipe[0] = -1;
+    g_worker_pipe[1] = -1;
+    g_worker_next_id = 0;
+    g_workers_started = 0;
+    g_worker_start_total_ns = 0;
+    g_stdin_interactive = 0;
+    g_start_ns = 0;
+    g_session_file = NULL;
+    g_session_path = NULL;
+    g_replay_path = NULL;
+    g_replay_speed = 1.0;
+    g_replay_events = NULL;
+    g_replay_count = 0;
+    g_replay_index = 0;
+    g_replay_start_ns = 0;
+    g_replay_lag_total_ns = 0;
+    g_replay_lag_max_ns = 0;
+    memset(g_replay_latency, 0, sizeof(g_replay_latency));
+    g_quiet_ops = 0;
+    g_churn_duration_s = 0.0;
+    g_churn_rate = CHURN_DEFAULT_RATE;
+    parse_churn_mix(CHURN_DEFAULT_MIX);
+    g_rng_state = 0;
+    g_sigchld_pipe[0] = -1;
+    g_sigchld_pipe[1] = -1;
+    g_sigchld_pending_ns = 0;
+    g_exit_notes_head = 0;
+    g_exit_notes_tail = 0;
+    memset(&g_reap_metrics, 0, sizeof(g_reap_metrics));
+    g_log_path = NULL;
+    g_log_fd = -1;
+    g_log_rate = -1.0;
+    g_log_tokens = 0.0;
+    g_log_refill_ns = 0;
+    g_log_dropped_pending = 0;
+    g_log_batch_len = 0;
+    g_log_batch_ns = 0;
+    memset(&g_log_metrics, 0, sizeof(g_log_metrics));
+    memset(g_log_recent, 0, sizeof(g_log_recent));
+    g_log_recent_count = 0;
+    g_stats_fd = -1;
+    g_stats_region_len = 0;
+    g_huge_pages = 0;
+    g_stats_slots = NULL;
+    g_free_slot_count = 0;
+    g_spawned_total = 0;
+    g_dashboard_active = 0;
+    g_dashboard_hz = DASH_DEFAULT_HZ;
+    g_dashboard_next_ns = 0;
+    g_dashboard_rows = 0;
+    g_dashboard_cols = 0;
+    g_dashboard_prev = NULL;
+    g_dashboard_out = NULL;
+    g_dashboard_out_size = 0;
+    g_dashboard_valid = 0;
+    g_dashboard_last_ns = 0;
+    g_dashboard_last_spawned = 0;
+    g_dashboard_last_reaped = 0;
+    g_dashboard_spawn_rate = 0.0;
+    g_dashboard_reap_rate = 0.0;
+    g_partials = NULL;
+    g_partial_count = 0;
+    g_partial_capacity = 0;
+    memset(&g_completed, 0, sizeof(g_completed));
+    g_checkpoints_lost = 0;
+    g_checkpoint_path = NULL;
+    g_sample_rate = 0.0;
+    g_run_duration_s = 0.0;
+    g_psi_enabled = 0;
+    for (int r = 0; r < PSI_RESOURCES; ++r) {
+        g_psi[r].threshold_pct = 0.0;
+        g_psi[r].fd = -1;
+        g_psi[r].last_total_us = -1;
+        g_psi[r].events = 0;
+    }
+    g_psi_polling = 0;
+    g_psi_next_poll_ns = 0;
+    g_psi_last_poll_ns = 0;
+    g_throttle_until_ns = 0;
+    g_throttle_start_ns = 0;
+    g_throttled_total_ns = 0;
+    g_next_release_ns = 0;
+    g_deferred = NULL;
+    g_deferred_head = 0;
+    g_deferred_count = 0;
+    g_deferred_capacity = 0;
+    g_deferred_total = 0;
+    g_deferred_wait_total_ns = 0;
+    g_deferred_wait_max_ns = 0;
+    g_sampler_pid = -1;
+    g_results_path = NULL;
+    g_query_text = NULL;
+    g_results_fd = -1;
+    g_results_index_fd = -1;
+    g_results_records = 0;
+    g_compare_base = NULL;
+    g_compare_candidate = NULL;
+    memset(&g_results_block, 0, sizeof(g_results_block));
+}
+
+/*
+ * print_usage
+ *
+ * Prints command-line usage to stderr.
+ *
+ * Accepts:
+ *   prog_name - Name the program was invoked as (argv[0])
+ *
+ * Returns: None
+ */
+static void print_usage(const char *prog_name) {
+    if (fprintf(stderr, "Usage: %s [-s POLICY[:VALUE]] [-w SESSION] [-r SESSION [-x SPEED]]\r\n", prog_name) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "       %*s [-g SECONDS [-R OPS_PER_SEC] [-m MIX]] [-L LOGFILE] [-l LINES_PER_SEC]\r\n", (int)strlen(prog_name), "") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "       %*s [-D HZ] [-K CHECKPOINTS] [-o RESULTS] [-e HZ] [-H] [-t SECONDS]\r\n", (int)strlen(prog_name), "") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "       %*s [-P CPU%%[:MEM%%]] [-C CGROUP] [-S] [-T] [-N COUNT] [-M ROUNDS]\r\n", (int)strlen(prog_name), "") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "       %s -o RESULTS -q QUERY\r\n", prog_name) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "       %s -A BASE -B CANDIDATE [-q QUERY]\r\n", prog_name) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -s POLICY[:VALUE]  Scheduling policy for spawned children:\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     other|batch|idle[:NICE] or fifo|rr[:RT_PRIORITY]\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -w SESSION         Record every command with its timestamp to SESSION\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -r SESSION         Replay the commands recorded in SESSION\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -x SPEED           Replay speed factor (default 1.0, 0 = no delays)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -g SECONDS         Run the churn generator for SECONDS before accepting commands\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -R OPS_PER_SEC     Churn operation rate (default %.0f)\r\n", CHURN_DEFAULT_RATE) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -m MIX             Churn weights spawn:kill-last:kill-random:broadcast (default %s)\r\n", CHURN_DEFAULT_MIX) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -L LOGFILE         Append captured child stderr to LOGFILE instead of the terminal\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -l LINES_PER_SEC   Child stderr rate limit (default %.0f to the terminal, unlimited to a file; 0 = unlimited)\r\n", LOG_DEFAULT_TTY_RATE) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -D HZ              Start with the live dashboard, refreshed HZ times per second (default %.0f)\r\n", DASH_DEFAULT_HZ) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -K CHECKPOINTS     Load partial results from CHECKPOINTS and save unfinished ones there on exit\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -e HZ              Sample children externally: a sampler process reads each child's pair HZ\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     times per second with process_vm_readv; children arm no timer\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -M ROUNDS          Persistent children: each runs ROUNDS rounds (0 = until killed); the parent\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     collects every round and then starts the next one\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -O[MS]             Subreaper: track the processes children fork as descendants, re-adopt\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     orphans and reap and account for them; the process tree is rescanned\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     every MS ms (attached, e.g. -O1000; default %lld)\r\n", DESCENDANT_SCAN_NS / 1000000LL) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -S                 Create children through a spawn helper forked at startup, so spawn cost\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     does not grow with the parent's memory\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -T                 Thread workers: '+', '-', 'k', '1', '2', 'i' and 'l' act on threads of the parent\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     running the child's workload (per-thread timer, own stats slot)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -N COUNT           Start COUNT children (or thread workers with -T) before reading commands\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -C CGROUP          Start every child inside the cgroup v2 directory CGROUP (clone3 CLONE_INTO_CGROUP)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -P CPU[:MEM]       Defer '+' and 'r' spawns while the share of time some task stalled on CPU\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     (memory) exceeds CPU%% (MEM%%, default CPU%%) of a 2 s window (Linux PSI)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -t SECONDS         Run each child for SECONDS of wall-clock time instead of a fixed repetition count\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -H                 Put the shared stats region on huge pages (hugetlbfs, else transparent\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     huge pages, else normal pages), prefaulted and locked\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -o RESULTS         Append a record for every reaped child to the results store RESULTS\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -q QUERY           Filter and aggregate RESULTS, then exit. QUERY is a comma-separated list of\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     policy=NAME[:VALUE], pid=PID, from=UNIX_SECONDS, to=UNIX_SECONDS,\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     status=complete|partial, group=policy (\"all\" matches everything)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "  -A BASE -B CAND    Compare two results stores per run (torn rate, throughput, spawn latency)\r\n") < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "                     and exit with status %d on a significant regression; -q filters both\r\n", AB_EXIT_REGRESSION) < 0) { /* Handle error? */ }
+    if (fprintf(stderr, "The CHILD_PATH environment variable must name the directory containing '%s'.\r\n", CHILD_PROG_NAME) < 0) { /* Handle error? */ }
+}
+
+/*
+ * parse_arguments
+ *
+ * Parses command-line options into the corresponding globals.
+ *
+ * Accepts:
+ *   argc - Argument count
+ *   argv - Argument vector
+ *
+ * Returns:
+ *   0 on success, -1 on invalid options (prints error message).
+ */
+static int parse_arguments(int argc, char *argv[]) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:w:r:x:g:R:m:L:l:D:K:o:q:A:B:e:Ht:P:C:STN:M:O::")) != -1) {
+        switch (opt) {
+            case 's':
+                if (parse_sched_spec(optarg, &g_sched_spec) != 0) {
+                    if (fprintf(stderr, "Error: Invalid scheduling policy '%s'.\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                // The first 's' command then starts over at the first preset
+                g_sched_preset_index = SCHED_PRESET_COUNT - 1;
+                break;
+            case 'w':
+                g_session_path = optarg;
+                break;
+            case 'r':
+                g_replay_path = optarg;
+                break;
+            case 'x': {
+                char *end = NULL;
+                errno = 0;
+                g_replay_speed = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || g_replay_speed < 0.0) {
+                    if (fprintf(stderr, "Error: Invalid replay speed '%s'.\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            }
+            case 'g':
+            case 'R': {
+                char *end = NULL;
+                errno = 0;
+                double value = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || !(value > 0.0)) {
+                    if (fprintf(stderr, "Error: Option -%c expects a positive number, got '%s'.\r\n", opt, optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                if (opt == 'g') {
+                    g_churn_duration_s = value;
+                } else {
+                    g_churn_rate = value;
+                }
+                break;
+            }
+            case 'm':
+                if (parse_churn_mix(optarg) != 0) {
+                    if (fprintf(stderr, "Error: Invalid churn mix '%s' (expected four weights, e.g. %s).\r\n", optarg, CHURN_DEFAULT_MIX) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            case 'L':
+                g_log_path = optarg;
+                break;
+            case 'K':
+                g_checkpoint_path = optarg;
+                break;
+            case 'o':
+                g_results_path = optarg;
+                break;
+            case 'q':
+                g_query_text = optarg;
+                break;
+            case 'A':
+                g_compare_base = optarg;
+                break;
+            case 'B':
+                g_compare_candidate = optarg;
+                break;
+            case 'H':
+                g_huge_pages = 1;
+                break;
+            case 'C':
+                g_cgroup_path = optarg;
+                break;
+            case 'S':
+                g_spawn_helper = 1;
+                break;
+            case 'O':
+                g_subreaper = 1;
+                if (optarg != NULL) { // Optional argument, attached: -O1000
+                    char *end = NULL;
+                    errno = 0;
+                    long period_ms = strtol(optarg, &end, 10);
+                    if (errno != 0 || end == optarg || *end != '\0' || period_ms < 1 || period_ms > DESCENDANT_SCAN_MAX_MS) {
+                        if (fprintf(stderr, "Error: Invalid scan period '%s' (expected 1 to %lld ms).\r\n", optarg, DESCENDANT_SCAN_MAX_MS) < 0) { /* Handle error? */ }
+                        return -1;
+                    }
+                    g_descendant_scan_period_ns = period_ms * 1000000LL;
+                }
+                break;
+            case 'M': {
+                char *end = NULL;
+                errno = 0;
+                long rounds = strtol(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || rounds < 0 || rounds > 10000000L) {
+                    if (fprintf(stderr, "Error: Invalid round count '%s' (expected 0 to 10000000).\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                g_round_limit = (int)rounds;
+                break;
+            }
+            case 'T':
+                g_thread_workers = 1;
+                break;
+            case 'N': {
+                char *end = NULL;
+                errno = 0;
+                unsigned long long count = strtoull(optarg, &end, 10);
+                if (errno != 0 || end == optarg || *end != '\0' || count == 0 || count > 1000000ULL) {
+                    if (fprintf(stderr, "Error: Invalid count '%s' (expected 1 to 1000000).\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                g_initial_spawns = (size_t)count;
+                break;
+            }
+            case 'P':
+                if (parse_psi_thresholds(optarg) != 0) {
+                    if (fprintf(stderr, "Error: Invalid pressure thresholds '%s' (expected CPU%%[:MEM%%], each 0 < %% <= 100).\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            case 't': {
+                char *end = NULL;
+                errno = 0;
+                g_run_duration_s = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || !(g_run_duration_s > 0.0) || g_run_duration_s > 1e6) {
+                    if (fprintf(stderr, "Error: Invalid run duration '%s' (expected 0 < SECONDS <= 1000000).\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            }
+            case 'e': {
+                char *end = NULL;
+                errno = 0;
+                g_sample_rate = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || !(g_sample_rate > 0.0) || g_sample_rate > SAMPLER_MAX_HZ) {
+                    if (fprintf(stderr, "Error: Invalid sampling rate '%s' (expected 0 < HZ <= %.0f).\r\n", optarg, SAMPLER_MAX_HZ) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            }
+            case 'D': {
+                char *end = NULL;
+                errno = 0;
+                g_dashboard_hz = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || !(g_dashboard_hz > 0.0) || g_dashboard_hz > 1000.0) {
+                    if (fprintf(stderr, "Error: Invalid dashboard refresh rate '%s' (expected 0 < HZ <= 1000).\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                g_dashboard_active = 1; // Shown once the main loop starts
+                break;
+            }
+            case 'l': {
+                char *end = NULL;
+                errno = 0;
+                g_log_rate = strtod(optarg, &end);
+                if (errno != 0 || end == optarg || *end != '\0' || g_log_rate < 0.0) {
+                    if (fprintf(stderr, "Error: Invalid child stderr rate '%s'.\r\n", optarg) < 0) { /* Handle error? */ }
+                    return -1;
+                }
+                break;
+            }
+            default:
+                return -1; // getopt already printed a diagnostic
+        }
+    }
+
+    if (optind < argc) {
+        if (fprintf(stderr, "Error: Unexpected argument '%s'.\r\n", argv[optind]) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (g_session_path != NULL && g_replay_path != NULL && strcmp(g_session_path, g_replay_path) == 0) {
+        if (fprintf(stderr, "Error: Cannot record to the session file being replayed.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (g_churn_duration_s > 0.0 && g_replay_path != NULL) {
+        if (fprintf(stderr, "Error: Churn generator (-g) and replay (-r) cannot be combined.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if ((g_compare_base == NULL) != (g_compare_candidate == NULL)) {
+        if (fprintf(stderr, "Error: Comparison needs both a baseline (-A) and a candidate (-B).\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (g_query_text != NULL && g_results_path == NULL && g_compare_base == NULL) {
+        if (fprintf(stderr, "Error: Query mode (-q) needs a results store (-o) or a comparison (-A/-B).\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (g_round_limit >= 0 && g_sample_rate > 0.0) {
+        if (fprintf(stderr, "Error: Persistent children (-M) sample themselves and cannot be combined with -e.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (g_log_rate < 0.0) {
+        g_log_rate = (g_log_path != NULL) ? 0.0 : LOG_DEFAULT_TTY_RATE;
+    }
+    return 0;
+}
+
+/*
+ * parse_sched_spec
+ *
+ * Parses a policy specification of the form NAME[:VALUE], where NAME is one
+ * of other, batch, idle, fifo, rr. VALUE is a nice level (-20..19) for the
+ * normal policies and a real-time priority for fifo/rr (1 by default).
+ *
+ * Accepts:
+ *   text - Specification string
+ *   spec - Output structure
+ *
+ * Returns:
+ *   0 on success, -1 if the specification is malformed or out of range.
+ */
+static int parse_sched_spec(const char *text, sched_spec_t *spec) {
+    const char *colon = strchr(text, ':');
+    size_t name_len = (colon != NULL) ? (size_t)(colon - text) : strlen(text);
+    sched_spec_t parsed = { sched_policy_lookup(text, name_len), 0 };
+
+    if (parsed.policy == -1) {
+        return -1;
+    }
+
+    int is_realtime = (parsed.policy == SCHED_FIFO || parsed.policy == SCHED_RR);
+    parsed.value = is_realtime ? 1 : 0;
+
+    if (colon != NULL) {
+        char *end = NULL;
+        errno = 0;
+        long value = strtol(colon + 1, &end, 10);
+        if (errno != 0 || end == colon + 1 || *end != '\0') {
+            return -1;
+        }
+        if (is_realtime) {
+            if (value < sched_get_priority_min(parsed.policy) || value > sched_get_priority_max(parsed.policy)) {
+                return -1;
+            }
+        } else if (value < -20 || value > 19) {
+            return -1;
+        }
+        parsed.value = (int)value;
+    }
+
+    *spec = parsed;
+    return 0;
+}
+
+/*
+ * format_sched_spec
+ *
+ * Formats a policy specification as NAME:VALUE (the form accepted by -s).
+ *
+ * Accepts:
+ *   spec - Policy to format
+ *   buf - Output buffer
+ *   buf_size - Size of buf in bytes
+ *
+ * Returns: None
+ */
+static void format_sched_spec(const sched_spec_t *spec, char *buf, size_t buf_size) {
+    if (snprintf(buf, buf_size, "%s:%d", sched_policy_name(spec->policy), spec->value) < 0 && buf_size > 0) {
+        buf[0] = '\0';
+    }
+}
+
+/*
+ * apply_sched_spec
+ *
+ * Applies a scheduling policy to the calling process. Called in the child
+ * between fork() and execv(), so only async-signal-safe calls are used.
+ * Real-time policies fall back to SCHED_OTHER when not permitted (EPERM).
+ * A normal policy that cannot be set is replaced by the inherited one, but
+ * its nice level is still applied; failure to set the nice level is
+ * reported but not fatal. The child reports
+ * the policy it actually ended up with in its statistics line.
+ *
+ * Accepts:
+ *   spec - Policy to apply
+ *
+ * Returns: None
+ */
+static void apply_sched_spec(const sched_spec_t *spec) {
+    struct sched_param param;
+    char err_buf[160];
+    int len;
+    int is_realtime = (spec->policy == SCHED_FIFO || spec->policy == SCHED_RR);
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = is_realtime ? spec->value : 0;
+
+    if (sched_setscheduler(0, spec->policy, &param) == -1) {
+        int sched_errno = errno;
+        len = snprintf(err_buf, sizeof(err_buf), "CHILD_SCHED: Failed to set policy %s (errno %d: %s), using default%s.\r\n",
+                       sched_policy_name(spec->policy), sched_errno, strerror(sched_errno),
+                       (!is_realtime && spec->value != 0) ? " with the requested nice level" : "");
+        if (len > 0 && (size_t)len < sizeof(err_buf)) {
+            safe_write(STDERR_FILENO, err_buf, (size_t)len);
+        }
+        if (is_realtime) {
+            return; // The value is a real-time priority, not a nice level
+        }
+    }
+
+    if (!is_realtime && spec->value != 0) {
+        if (setpriority(PRIO_PROCESS, 0, spec->value) == -1) {
+            int nice_errno = errno;
+            len = snprintf(err_buf, sizeof(err_buf), "CHILD_SCHED: Failed to set nice %d (errno %d: %s).\r\n",
+                           spec->value, nice_errno, strerror(nice_errno));
+            if (len > 0 && (size_t)len < sizeof(err_buf)) {
+                safe_write(STDERR_FILENO, err_buf, (size_t)len);
+            }
+        }
+    }
+}
+
+/*
+ * cycle_sched_policy
+ *
+ * Advances the policy used for subsequently spawned children to the next
+ * entry of g_sched_presets. Running children are not affected.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void cycle_sched_policy(void) {
+    char sched_name[SCHED_NAME_LEN];
+
+    g_sched_preset_index = (g_sched_preset_index + 1) % SCHED_PRESET_COUNT;
+    g_sched_spec = g_sched_presets[g_sched_preset_index];
+    format_sched_spec(&g_sched_spec, sched_name, sizeof(sched_name));
+    if (printf("PARENT [%d]: New children will use scheduling policy %s.\r\n", getpid(), sched_name) < 0) { /* Handle error? */ }
+}
+
+/*
+ * cycle_sample_interval
+ *
+ * Advances to the next entry of g_interval_presets_us and asks every
+ * running child (and thread worker) to sample at that interval. Children spawned later start
+ * at the default interval.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void cycle_sample_interval(void) {
+    char description[48];
+
+    g_interval_preset_index = (g_interval_preset_index + 1) % INTERVAL_PRESET_COUNT;
+    int interval_us = g_interval_presets_us[g_interval_preset_index];
+    snprintf(description, sizeof(description), "sample interval %d us", interval_us);
+    queue_command_to_children(CHILD_COMMAND_SET_INTERVAL, interval_us, description);
+    for (size_t i = 0; i < g_worker_count; ++i) {
+        atomic_store_explicit(&g_workers[i]->interval_us, interval_us, memory_order_relaxed);
+    }
+    if (g_worker_count > 0 && !g_quiet_ops) {
+        if (printf("PARENT [%d]: %zu thread workers now sample every %d us.\r\n", getpid(), g_worker_count, interval_us) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * safe_write
+ *
+ * Wrapper around write() to handle EINTR and partial writes.
+ * Suitable for use outside signal handlers. For signal handlers,
+ * direct write() with loop might be needed if partial writes are possible.
+ * This version is fine for its current uses.
+ *
+ * Accepts:
+ *   fd - File descriptor
+ *   buf - Buffer to write
+ *   count - Number of bytes to write
+ *
+ * Returns:
+ *   Total bytes written, or -1 on error (sets errno).
+ */
+static ssize_t safe_write(int fd, const void *buf, size_t count) {
+    size_t total_written = 0;
+    const char *ptr = (const char *)buf;
+
+    while (total_written < count) {
+        ssize_t written = write(fd, ptr + total_written, count - total_written);
+        if (written == -1) {
+            if (errno == EINTR) {
+                continue; // Retry on interrupt
+            }
+            return -1; // Other error
+        }
+        if (written == 0) {
+            // According to POSIX write(2), a return of 0 means nothing was written
+            // and this should not happen if count > 0.
+            // However, some interpretations treat it as an error or EOF on certain devices.
+            // For robustness, treat as an error if count > 0 and written is 0.
+            errno = EIO; // Indicate an I/O error
+            return -1;
+        }
+        total_written += (size_t)written;
+    }
+    return (ssize_t)total_written;
+}
+
+
+/*
+ * enable_raw_mode
+ *
+ * Switches the terminal controlling stdin to raw mode.
+ * Disables echo and canonical processing. Saves original settings.
+ * **MODIFIED: Keeps ISIG enabled so Ctrl+C generates SIGINT.**
+ * Exits on failure.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void enable_raw_mode(void) {
+    if (!isatty(STDIN_FILENO)) {
+        if (fprintf(stderr, "Error: Standard input is not a terminal. Raw mode not applicable.\r\n") < 0) { /* Handle error? */ }
+        // No raw mode to disable, so exit directly. atexit will handle g_children if allocated.
+        exit(EXIT_FAILURE);
+    }
+    if (tcgetattr(STDIN_FILENO, &g_orig_termios) == -1) {
+        perror("Error: tcgetattr failed");
+        // No raw mode to disable. atexit will handle g_children if allocated.
+        exit(EXIT_FAILURE);
+    }
+
+    termios_t raw = g_orig_termios;
+
+    // Configure input flags
+    raw.c_iflag &= ~(unsigned long)(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
 
     // Configure output flags: OPOST is often disabled in raw mode for full control.
     // If OPOST is disabled, the application must manually send \r\n for newlines.
     // The current code uses \r\n for its outputs, so disabling OPOST is consistent.
     raw.c_oflag &= ~(unsigned long)(OPOST);
 
-    // Configure control flags
-    raw.c_cflag |= (unsigned long)(CS8); // 8 bits per byte
+    // Configure control flags
+    raw.c_cflag |= (unsigned long)(CS8); // 8 bits per byte
+
+    // Configure local flags:
+    // Disable ECHO (characters not echoed back)
+    // Disable ICANON (canonical mode, no line buffering)
+    // Disable IEXTEN (implementation-defined input processing)
+    // **KEEP ISIG ENABLED** so Ctrl+C, Ctrl+\, etc., generate signals.
+    raw.c_lflag &= ~(unsigned long)(ECHO | ICANON | IEXTEN);
+    // If you wanted to disable ISIG, it would be:
+    // raw.c_lflag &= ~(unsigned long)(ECHO | ICANON | IEXTEN | ISIG);
+
+    // Control characters for non-canonical mode
+    raw.c_cc[VMIN] = 1;  // read() blocks until at least 1 byte is available
+    raw.c_cc[VTIME] = 0; // No timeout for read()
+
+    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) {
+        perror("Error: tcsetattr failed to enable raw mode");
+        // Attempt to restore original settings if possible, though unlikely to succeed if setattr failed.
+        // tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_orig_termios); // This might also fail.
+        // atexit handler will attempt to restore, but it's best effort.
+        exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * disable_raw_mode
+ *
+ * Restores the terminal settings for stdin to their original state.
+ * Ensures cursor is on a new line. Uses safe_write for output.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void disable_raw_mode(void) {
+    // Only attempt to restore if stdin is a TTY and g_orig_termios has been populated
+    if (!isatty(STDIN_FILENO)) {
+        return;
+    }
+
+    // Check if g_orig_termios seems initialized (not all zeros, which is its state after memset)
+    // This is a basic check; a more robust way would be a flag set after successful tcgetattr.
+    int is_orig_termios_set = 0;
+    for (size_t i = 0; i < sizeof(g_orig_termios.c_cc); ++i) {
+        if (g_orig_termios.c_cc[i] != 0) { is_orig_termios_set = 1; break; }
+    }
+    if (!is_orig_termios_set && g_orig_termios.c_iflag == 0 &&
+        g_orig_termios.c_oflag == 0 && g_orig_termios.c_cflag == 0 &&
+        g_orig_termios.c_lflag == 0) {
+        // g_orig_termios appears to be uninitialized or all zeros, possibly tcgetattr failed
+        // or was never called. Avoid restoring with potentially invalid settings.
+        const char msg[] = "Warning: Original terminal attributes not available for restoration or were all zero.\r\n";
+    safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        } else {
+            if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_orig_termios) == -1) {
+                // Use a simple message for async-signal safety if this were called from a signal handler
+                // (though atexit is not a signal handler context).
+                const char msg[] = "Warning: Failed to restore terminal attributes.\r\n";
+                safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            }
+        }
+
+        // Ensure the cursor is at the beginning of a new line after exiting raw mode.
+        // This is important because the application might have left the cursor anywhere.
+        safe_write(STDOUT_FILENO, "\r\n", 2);
+        fflush(stdout); // Try to flush any buffered output
+}
+
+/*
+ * cleanup_resources
+ *
+ * Frees allocated memory, kills remaining children, and restores terminal mode.
+ * Intended to be registered with atexit(). Uses stderr for messages via safe_write.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void cleanup_resources(void) {
+    if (g_dashboard_active) {
+        toggle_dashboard(); // Back to the normal screen before anything else is printed
+    }
+    // disable_raw_mode must be called first to ensure subsequent messages are seen correctly.
+    disable_raw_mode();
+
+    pid_t pid = getpid(); // Safe to call getpid()
+    char msg_buf[128];
+    int len;
+
+    // Using snprintf and safe_write for messages from atexit handler
+    TRACE_PROBE2(teardown, live_child_count(), g_worker_count);
+    len = snprintf(msg_buf, sizeof(msg_buf), "PARENT [%d]: Cleaning up...\r\n", pid);
+    if (len > 0 && (size_t)len < sizeof(msg_buf)) {
+        safe_write(STDERR_FILENO, msg_buf, (size_t)len);
+    }
+
+    kill_all_children("Parent exiting.");
+    reap_killed_children(); // Their checkpoints are final only once they are gone
+    stop_all_workers(NULL);
+    stop_sampler();
+    stop_spawn_helper();
+    requeue_deferred_resumes(); // Resumes that never got to spawn stay partial results
+    if (g_checkpoint_path != NULL) {
+        save_checkpoint_file(g_checkpoint_path); // Before the stats region is unmapped
+    }
+    free(g_partials);
+    g_partials = NULL;
+    g_partial_count = 0;
+    g_partial_capacity = 0;
+    // The block being filled is not indexed yet; readers scan it as the unindexed tail
+    if (g_results_fd != -1) {
+        close(g_results_fd);
+        g_results_fd = -1;
+    }
+    if (g_results_index_fd != -1) {
+        close(g_results_index_fd);
+        g_results_index_fd = -1;
+    }
+    for (int r = 0; r < PSI_RESOURCES; ++r) {
+        if (g_psi[r].fd != -1) {
+            close(g_psi[r].fd);
+            g_psi[r].fd = -1;
+        }
+    }
+    free(g_deferred);
+    g_deferred = NULL;
+    g_deferred_count = 0;
+    g_deferred_capacity = 0;
+    if (g_cgroup_fd != -1) {
+        close(g_cgroup_fd);
+        g_cgroup_fd = -1;
+    }
+    if (g_cgroup_procs_fd != -1) {
+        close(g_cgroup_procs_fd);
+        g_cgroup_procs_fd = -1;
+    }
+    free(g_workers);
+    g_workers = NULL;
+    g_worker_capacity = 0;
+    for (int end = 0; end < 2; ++end) {
+        if (g_worker_pipe[end] != -1) {
+            close(g_worker_pipe[end]);
+            g_worker_pipe[end] = -1;
+        }
+    }
+    flush_child_log(1);
+    if (g_log_fd != -1 && g_log_fd != STDERR_FILENO) {
+        close(g_log_fd);
+    }
+    g_log_fd = -1;
+
+    if (g_session_file != NULL) {
+        fclose(g_session_file);
+        g_session_file = NULL;
+    }
+    free(g_replay_events);
+    g_replay_events = NULL;
+    g_replay_count = 0;
+
+    // Children not reaped above in time become zombies of this process; they are reparented to init when it exits.
+    for (int i = 0; i < 2; ++i) {
+        if (g_sigchld_pipe[i] != -1) {
+            close(g_sigchld_pipe[i]);
+            g_sigchld_pipe[i] = -1;
+        }
+    }
+
+    if (g_children != NULL) {
+        for (size_t i = 0; i < g_child_count; ++i) {
+            if (g_children[i].exec_fd != -1) {
+                close(g_children[i].exec_fd);
+            }
+            if (g_children[i].err_fd != -1) {
+                close(g_children[i].err_fd);
+            }
+        }
+        free(g_children);
+        g_children = NULL; // Important to prevent double-free if cleanup is somehow called again
+        g_child_count = 0;
+        g_child_capacity = 0;
+    }
+    free(g_dashboard_prev);
+    free(g_dashboard_out);
+    g_dashboard_prev = NULL;
+    g_dashboard_out = NULL;
+    if (g_stats_slots != NULL) {
+        munmap(g_stats_slots, g_stats_region_len);
+        g_stats_slots = NULL;
+    }
+    if (g_stats_fd != -1) {
+        close(g_stats_fd);
+        g_stats_fd = -1;
+    }
+    if (g_pollfds != NULL) {
+        free(g_pollfds);
+        free(g_poll_owners);
+        g_pollfds = NULL;
+        g_poll_owners = NULL;
+        g_pollfd_capacity = 0;
+    }
+
+    len = snprintf(msg_buf, sizeof(msg_buf), "PARENT [%d]: Cleanup complete.\r\n", pid);
+    if (len > 0 && (size_t)len < sizeof(msg_buf)) {
+        safe_write(STDERR_FILENO, msg_buf, (size_t)len);
+    }
+    fflush(stderr); // Try to flush stderr
+}
+
+/*
+ * handle_signal
+ *
+ * Signal handler for SIGINT, SIGTERM, SIGQUIT (sets termination flag).
+ * Async-signal-safe. SIGCHLD is handled by handle_sigchld.
+ *
+ * Accepts:
+ *   sig - The signal number received.
+ *
+ * Returns: None
+ */
+static void handle_signal(int sig) {
+    int saved_errno = errno; // Preserve errno
+
+    if (sig == SIGINT || sig == SIGTERM || sig == SIGQUIT) {
+        // Set the flag that the main loop will check.
+        g_terminate_flag = 1;
+
+        // Output a message. This must be async-signal-safe.
+        // Using safe_write directly.
+        const char msg[] = "\r\nPARENT: Termination signal received, initiating shutdown...\r\n";
+        safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
+        // Note: The main loop will detect g_terminate_flag and exit,
+        // then atexit handler (cleanup_resources) will run.
+    }
+
+    errno = saved_errno; // Restore errno
+}
+
+/*
+ * handle_sigchld
+ *
+ * Signal handler for SIGCHLD. Does NOT reap: it timestamps the notification
+ * (per child via si_pid, and the first notification not yet handled for
+ * coalesced signals) and wakes the main loop through the self-pipe, which
+ * then reaps in reap_children(). Async-signal-safe (clock_gettime, write).
+ *
+ * Accepts:
+ *   sig - The signal number received (SIGCHLD).
+ *   info - Signal details; si_pid identifies the child.
+ *   context - Unused.
+ *
+ * Returns: None
+ */
+static void handle_sigchld(int sig, siginfo_t *info, void *context) {
+    int saved_errno = errno; // Preserve errno
+    long long now_ns = monotonic_ns();
+    (void)context;
+
+    TRACE_PROBE3(signal_receive, sig, (info != NULL) ? info->si_pid : 0, (info != NULL) ? info->si_code : 0);
+    if (g_sigchld_pending_ns == 0) {
+        g_sigchld_pending_ns = now_ns;
+    }
+    if (info != NULL && (info->si_code == CLD_EXITED || info->si_code == CLD_KILLED || info->si_code == CLD_DUMPED)) {
+        // Overwrites the oldest note if the reaper fell more than a ring behind
+        unsigned long head = g_exit_notes_head;
+        g_exit_notes[head % EXIT_NOTE_RING].pid = info->si_pid;
+        g_exit_notes[head % EXIT_NOTE_RING].notified_ns = now_ns;
+        g_exit_notes_head = head + 1;
+    }
+    if (g_sigchld_pipe[1] != -1) {
+        const char wake = 'c';
+        if (write(g_sigchld_pipe[1], &wake, 1) == -1) {
+            // EAGAIN: the pipe is full, so the main loop is already due to wake up
+        }
+    }
+
+    errno = saved_errno; // Restore errno
+}
+
+/*
+ * create_sigchld_pipe
+ *
+ * Creates the non-blocking, close-on-exec self-pipe used by handle_sigchld
+ * to wake the main loop.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int create_sigchld_pipe(void) {
+    if (pipe(g_sigchld_pipe) == -1) {
+        perror("Error: Failed to create SIGCHLD self-pipe");
+        return -1;
+    }
+    for (int i = 0; i < 2; ++i) {
+        int flags = fcntl(g_sigchld_pipe[i], F_GETFL);
+        if (flags == -1 || fcntl(g_sigchld_pipe[i], F_SETFL, flags | O_NONBLOCK) == -1 ||
+            fcntl(g_sigchld_pipe[i], F_SETFD, FD_CLOEXEC) == -1) {
+            perror("Error: Failed to configure SIGCHLD self-pipe");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * reap_children
+ *
+ * Reaps every exited child without blocking (wait4, so its resource usage
+ * can go to the results store) and records how long each was
+ * a zombie: from its SIGCHLD notification (or, if signals coalesced, the
+ * first pending notification) to the waitpid() that reaped it. The number
+ * of zombies reaped in one pass is recorded as the backlog depth. Reaped
+ * children are removed from the registry. SIGCHLD is blocked meanwhile so
+ * the handler's notes stay consistent.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void reap_children(void) {
+    sigset_t block_set, old_set;
+    exit_note_t notes[EXIT_NOTE_RING];
+    size_t note_count = 0;
+    char drain_buf[64];
+    size_t reaped_this_pass = 0;
+    pid_t child_pid;
+
+    sigemptyset(&block_set);
+    sigaddset(&block_set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block_set, &old_set);
+
+    while (read(g_sigchld_pipe[0], drain_buf, sizeof(drain_buf)) > 0) {
+        // Drain wake-ups; the notes below carry the information
+    }
+
+    long long batch_ns = g_sigchld_pending_ns;
+    g_sigchld_pending_ns = 0;
+
+    unsigned long head = g_exit_notes_head;
+    if (head - g_exit_notes_tail > EXIT_NOTE_RING) {
+        g_reap_metrics.notes_lost += head - g_exit_notes_tail - EXIT_NOTE_RING;
+        g_exit_notes_tail = head - EXIT_NOTE_RING;
+    }
+    for (; g_exit_notes_tail != head; ++g_exit_notes_tail) {
+        notes[note_count].pid = g_exit_notes[g_exit_notes_tail % EXIT_NOTE_RING].pid;
+        notes[note_count].notified_ns = g_exit_notes[g_exit_notes_tail % EXIT_NOTE_RING].notified_ns;
+        note_count++;
+    }
+
+    int status;
+    struct rusage usage;
+    while ((child_pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        long long reaped_ns = monotonic_ns();
+        long long exited_ns = 0;
+
+        for (size_t i = 0; i < note_count; ++i) {
+            if (notes[i].pid == child_pid) {
+                exited_ns = notes[i].notified_ns;
+                notes[i].pid = 0; // A recycled PID must not match this note again
+                break;
+            }
+        }
+        if (exited_ns == 0) {
+            g_reap_metrics.coalesced++;
+            // Signal still pending (SIGCHLD blocked) if no batch time either: zombie just appeared
+            exited_ns = (batch_ns != 0) ? batch_ns : reaped_ns;
+        }
+
+        long long latency_ns = reaped_ns - exited_ns;
+        if (latency_ns < 0) {
+            latency_ns = 0;
+        }
+        TRACE_PROBE3(reap, child_pid, status, latency_ns);
+        g_reap_metrics.reaped++;
+        g_reap_metrics.latency_total_ns += latency_ns;
+        if (latency_ns > g_reap_metrics.latency_max_ns) {
+            g_reap_metrics.latency_max_ns = latency_ns;
+        }
+        g_reap_metrics.latency_hist[histogram_bucket((unsigned long long)latency_ns / 1000ULL)]++;
+        reaped_this_pass++;
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+            g_exit_normal++;
+        } else if (WIFEXITED(status)) {
+            g_exit_failed++;
+        } else {
+            g_exit_signaled++;
+        }
+
+        if (child_pid == g_sampler_pid) {
+            g_sampler_pid = -1;
+            if (fprintf(stderr, "PARENT [%d]: Warning: The external sampler exited; externally sampled children will not progress.\r\n", getpid()) < 0) { /* Handle error? */ }
+            continue;
+        }
+        if (child_pid == g_spawn_helper_pid) {
+            g_spawn_helper_pid = -1;
+            stop_spawn_helper();
+            if (fprintf(stderr, "PARENT [%d]: Warning: The spawn helper exited; children are spawned by the parent.\r\n", getpid()) < 0) { /* Handle error? */ }
+            continue;
+        }
+        ssize_t index = find_child_index(child_pid);
+        if (index < 0) {
+            g_reap_metrics.untracked++; // Not spawned through the registry
+            if (g_subreaper) {
+                g_orphans_unseen++; // Reparented and exited between two scans
+            }
+            continue;
+        }
+        child_entry_t *child = &g_children[index];
+        child->exit_ns = exited_ns;
+        child->exit_status = status;
+        if (child->descendant) {
+            g_descendants_reaped++; // Not a workload: no output pipe, checkpoint or result record
+        } else {
+            read_child_stderr(child); // Collect whatever the child wrote before exiting
+            collect_child_checkpoint(child);
+            append_child_result(child, status, &usage);
+        }
+        retire_child((size_t)index, reaped_ns);
+    }
+    // ECHILD means no more children to wait for, which is not an error in this loop.
+    if (child_pid == -1 && errno != ECHILD) {
+        if (fprintf(stderr, "PARENT: Error in wait4 (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+    }
+
+    if (reaped_this_pass > 0) {
+        g_dashboard_valid = 0; // Exiting children may have printed their statistics over it
+        g_reap_metrics.passes++;
+        g_reap_metrics.backlog_hist[histogram_bucket(reaped_this_pass)]++;
+        if (reaped_this_pass > g_reap_metrics.backlog_max) {
+            g_reap_metrics.backlog_max = reaped_this_pass;
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &old_set, NULL);
+}
+
+/*
+ * histogram_bucket
+ *
+ * Maps a value to its log2 histogram bucket: 0 for 0, otherwise
+ * floor(log2(value)) + 1, capped at the last bucket.
+ *
+ * Accepts:
+ *   value - Value to classify
+ *
+ * Returns: Bucket index in [0, HISTOGRAM_BUCKETS).
+ */
+static int histogram_bucket(unsigned long long value) {
+    int bucket = 0;
+
+    while (value > 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/*
+ * print_histogram
+ *
+ * Prints the non-empty buckets of a log2 histogram on one line as
+ * "[low,high):count" entries.
+ *
+ * Accepts:
+ *   label - Line prefix
+ *   hist - HISTOGRAM_BUCKETS counters
+ *
+ * Returns: None
+ */
+static void print_histogram(const char *label, const unsigned long long *hist) {
+    char line[1024];
+    int pos = snprintf(line, sizeof(line), "  %s:", label);
+
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS && pos > 0 && (size_t)pos < sizeof(line); ++bucket) {
+        if (hist[bucket] == 0) {
+            continue;
+        }
+        unsigned long long low = (bucket == 0) ? 0ULL : 1ULL << (bucket - 1);
+        int ret;
+        if (bucket == HISTOGRAM_BUCKETS - 1) {
+            ret = snprintf(line + pos, sizeof(line) - (size_t)pos, " [%llu,inf):%llu", low, hist[bucket]);
+        } else {
+            ret = snprintf(line + pos, sizeof(line) - (size_t)pos, " [%llu,%llu):%llu", low, 1ULL << bucket, hist[bucket]);
+        }
+        if (ret < 0) {
+            break;
+        }
+        pos += ret;
+    }
+    if (printf("%s\r\n", line) < 0) { /* Handle error? */ }
+}
+
+/*
+ * print_reap_metrics
+ *
+ * Prints reaping statistics: zombie lifetime (mean, max, histogram in
+ * microseconds), reap backlog depth per pass (max, histogram) and the
+ * number of exit notifications not yet handled by the reaper.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void print_reap_metrics(void) {
+    const reap_metrics_t *m = &g_reap_metrics;
+    unsigned long pending = g_exit_notes_head - g_exit_notes_tail;
+
+    if (printf("PARENT [%d]: Reaped %llu children in %llu passes (%llu unknown, %llu via coalesced SIGCHLD, %llu notes lost).\r\n",
+        getpid(), m->reaped, m->passes, m->untracked, m->coalesced, m->notes_lost) < 0) { /* Handle error? */ }
+    if (printf("  zombie lifetime: mean %.1f us, max %.1f us; backlog: max %zu per pass, %lu notified now\r\n",
+        (m->reaped > 0) ? (double)m->latency_total_ns / (double)m->reaped / 1e3 : 0.0,
+        (double)m->latency_max_ns / 1e3, m->backlog_max, pending) < 0) { /* Handle error? */ }
+    print_histogram("zombie lifetime (us)", m->latency_hist);
+    print_histogram("backlog (zombies/pass)", m->backlog_hist);
+}
+
+
+/*
+ * register_signal_handlers
+ *
+ * Sets up signal handlers for SIGINT, SIGTERM, SIGQUIT, and SIGCHLD.
+ * Exits on failure.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void register_signal_handlers(void) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_signal;
+
+    // Block common signals within the handler to prevent reentrancy issues
+    // for these specific signals, though handle_signal is designed to be safe.
+    if (sigfillset(&sa.sa_mask) == -1) { // Block all signals during handler execution
+        // disable_raw_mode(); // Handled by atexit if main exits
+        perror("Error: sigfillset failed");
+        exit(EXIT_FAILURE);
+    }
+    // Alternatively, more targeted:
+    // if (sigemptyset(&sa.sa_mask) == -1) { perror("Error: sigemptyset failed"); exit(EXIT_FAILURE); }
+    // if (sigaddset(&sa.sa_mask, SIGINT) == -1) { /* ... */ }
+    // if (sigaddset(&sa.sa_mask, SIGTERM) == -1) { /* ... */ }
+    // if (sigaddset(&sa.sa_mask, SIGQUIT) == -1) { /* ... */ }
+    // if (sigaddset(&sa.sa_mask, SIGCHLD) == -1) { /* ... */ }
+
+
+    // For SIGINT, SIGTERM, SIGQUIT:
+    // sa.sa_flags = 0; // Default: signal handler is not re-entered, syscalls not restarted
+    // If syscalls (like read) should be interrupted and return EINTR:
+    sa.sa_flags = 0; // Let them be interrupted. The main loop handles EINTR from read.
+
+    if (sigaction(SIGINT, &sa, NULL) == -1 ||
+        sigaction(SIGTERM, &sa, NULL) == -1 ||
+        sigaction(SIGQUIT, &sa, NULL) == -1) {
+        // disable_raw_mode(); // Handled by atexit
+        perror("Error: Failed to register termination signal handlers");
+    exit(EXIT_FAILURE);
+        }
+
+        // For SIGCHLD:
+        // SA_SIGINFO delivers si_pid so the exit can be timestamped per child.
+        // SA_RESTART can be useful for SIGCHLD if you want interrupted syscalls to restart.
+        // SA_NOCLDSTOP prevents SIGCHLD when a child is stopped (e.g., by SIGSTOP/SIGTSTP).
+        sa.sa_handler = NULL;
+        sa.sa_sigaction = handle_sigchld;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART | SA_NOCLDSTOP;
+        if (sigaction(SIGCHLD, &sa, NULL) == -1) {
+            // disable_raw_mode(); // Handled by atexit
+            perror("Error: Failed to register SIGCHLD handler");
+            exit(EXIT_FAILURE);
+        }
+
+        // Persistent children (-M) report completed rounds
+        if (g_round_limit >= 0) {
+            sa.sa_sigaction = handle_round_done;
+            sa.sa_flags = SA_SIGINFO | SA_RESTART;
+            if (sigaction(CHILD_ROUND_SIGNAL, &sa, NULL) == -1) {
+                perror("Error: Failed to register the round handler");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Parent should ignore SIGUSR1 and SIGUSR2 if it's not meant to act on them.
+        // This prevents accidental termination if a child (or other process) sends them to the parent.
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = SIG_IGN; // Ignore the signal
+        sa.sa_flags = 0;
+        if (sigaction(SIGUSR1, &sa, NULL) == -1 || sigaction(SIGUSR2, &sa, NULL) == -1) {
+            // This is a warning because the program can still function.
+            fprintf(stderr, "Warning: Failed to ignore SIGUSR1/SIGUSR2 in parent.\r\n");
+        }
+}
+
+
+/*
+ * add_child_entry
+ *
+ * Adds a child to the registry in the STARTING state, resizing if necessary.
+ * Aborts on memory allocation failure (as this is a critical part of tracking).
+ *
+ * Accepts:
+ *   pid - The PID of the child process to add.
+ *   exec_fd - Read end of the child's exec-status pipe (-1 if none).
+ *   err_fd - Read end of the child's stderr pipe (-1 if none).
+ *   slot - Shared stats slot of the child (-1 if none).
+ *
+ * Returns:
+ *   Pointer to the new entry (valid until the registry is next modified).
+ *   Aborts on failure.
+ */
+static child_entry_t *add_child_entry(pid_t pid, int exec_fd, int err_fd, int slot) {
+    if (g_child_count >= g_child_capacity) {
+        size_t new_capacity = (g_child_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_child_capacity * 2;
+        // Check for overflow before multiplication
+        if (g_child_capacity > SIZE_MAX / 2 && g_child_capacity != 0) { // Potential overflow with * 2
+            // disable_raw_mode(); // Handled by atexit via abort()
+            if (fprintf(stderr, "Error: Child registry capacity overflow (requested %zu).\r\n", new_capacity) < 0) { /* Handle error? */ }
+            abort(); // Critical error
+        }
+        // Check if new_capacity * sizeof(child_entry_t) would overflow size_t
+        if (new_capacity > SIZE_MAX / sizeof(child_entry_t)) {
+            // disable_raw_mode(); // Handled by atexit via abort()
+            if (fprintf(stderr, "Error: Child registry memory size overflow (requested %zu elements).\r\n", new_capacity) < 0) { /* Handle error? */ }
+            abort(); // Critical error
+        }
+
+        child_entry_t *new_children = realloc(g_children, new_capacity * sizeof(child_entry_t));
+        if (new_children == NULL) {
+            // disable_raw_mode(); // Handled by atexit via abort()
+            perror("Error: Failed to reallocate memory for child registry");
+            // Try to kill the newly created child if we can't track it.
+            // This is best effort as we are about to abort.
+            kill(pid, SIGKILL); // Send SIGKILL to the child we just forked but can't track
+            waitpid(pid, NULL, 0); // Wait for it to ensure it's gone before aborting parent
+            abort(); // Critical error
+        }
+        g_children = new_children;
+        g_child_capacity = new_capacity;
+    }
+
+    child_entry_t *child = &g_children[g_child_count++];
+    memset(child, 0, sizeof(*child));
+    child->pid = pid;
+    child->state = CHILD_STATE_STARTING;
+    child->spawn_ns = monotonic_ns();
+    child->exec_fd = exec_fd;
+    child->err_fd = err_fd;
+    child->slot = slot;
+    child->pidfd = -1;
+    child->parent_pid = getpid();
+    child->sched = g_sched_spec;
+    g_state_counts[CHILD_STATE_STARTING]++;
+    return child;
+}
+
+/*
+ * remove_child_at_index
+ *
+ * Removes a child from the registry at the specified index by shifting
+ * subsequent elements down, so entries stay in spawn order. Assumes index
+ * is valid relative to current count. The entry's state counter must
+ * already have been moved to REAPED by the caller.
+ * Does NOT shrink the allocated memory (g_child_capacity remains).
+ *
+ * Accepts:
+ *   index - The index of the entry to remove.
+ *
+ * Returns: None
+ */
+static void remove_child_at_index(size_t index) {
+    pid_t parent_pid = getpid();
+    if (index >= g_child_count) {
+        // This should ideally not happen if logic is correct elsewhere.
+        if (fprintf(stderr, "PARENT [%d]: Error: Invalid index %zu in remove_child_at_index (count=%zu).\r\n",
+            parent_pid, index, g_child_count) < 0) { /* Handle error? */ }
+            return;
+    }
+
+    if (g_children[index].exec_fd != -1) {
+        close(g_children[index].exec_fd);
+    }
+    if (g_children[index].err_fd != -1) {
+        close(g_children[index].err_fd);
+    }
+    if (g_children[index].pidfd != -1) {
+        close(g_children[index].pidfd);
+    }
+    if (g_children[index].kill_deadline_ns != 0) {
+        g_kill_escalations--;
+    }
+    release_stats_slot(g_children[index].slot);
+
+    // Number of elements to move is g_child_count - 1 (new count) - index
+    size_t elements_to_move = g_child_count - 1 - index;
+    if (elements_to_move > 0) {
+        // memmove is safe for overlapping regions
+        memmove(&g_children[index], &g_children[index + 1], elements_to_move * sizeof(child_entry_t));
+    }
+    // else: removing the last element, no move needed.
+
+    g_child_count--;
+}
+
+/*
+ * retire_child
+ *
+ * Moves a child whose exit has been dealt with out of the registry: its
+ * PID, exit status and timestamps go to the ring of recently reaped
+ * children listed by 'l' (the oldest falls out), its state counter to
+ * REAPED, and the entry is removed.
+ *
+ * Accepts:
+ *   index - Registry index of the child (exit_ns and exit_status already set)
+ *   reaped_ns - When it was reaped (CLOCK_MONOTONIC)
+ *
+ * Returns: None
+ */
+static void retire_child(size_t index, long long reaped_ns) {
+    child_entry_t *child = &g_children[index];
+    reaped_child_t *reaped = &g_reaped_recent[g_reaped_recent_total % REAPED_RECENT_MAX];
+
+    reaped->pid = child->pid;
+    reaped->exit_status = child->exit_status;
+    reaped->descendant = child->descendant;
+    reaped->sched = child->sched;
+    reaped->spawn_ns = child->spawn_ns;
+    reaped->exit_ns = child->exit_ns;
+    reaped->reaped_ns = reaped_ns;
+    g_reaped_recent_total++;
+    set_child_state(child, CHILD_STATE_REAPED);
+    remove_child_at_index(index);
+}
+
+/*
+ * find_child_index
+ *
+ * Looks up a child in the registry by PID.
+ *
+ * Accepts:
+ *   pid - The PID to look for.
+ *
+ * Returns:
+ *   Index of the entry, or -1 if the PID is not tracked.
+ */
+static ssize_t find_child_index(pid_t pid) {
+    for (size_t i = g_child_count; i > 0; --i) { // Recent children exit more often under churn
+        if (g_children[i - 1].pid == pid) {
+            return (ssize_t)(i - 1);
+        }
+    }
+    return -1;
+}
+
+/*
+ * set_child_state
+ *
+ * Moves a child to a new lifecycle state and updates the per-state
+ * counters in O(1).
+ *
+ * Accepts:
+ *   child - Registry entry
+ *   state - New state
+ *
+ * Returns: None
+ */
+static void set_child_state(child_entry_t *child, child_state_t state) {
+    g_state_counts[child->state]--;
+    g_state_counts[state]++;
+    child->state = state;
+}
+
+/*
+ * is_child_live
+ *
+ * Tells whether a child is still a valid target for commands, i.e. it has
+ * not been killed by the parent and has not exited.
+ *
+ * Accepts:
+ *   child - Registry entry
+ *
+ * Returns: 1 if STARTING or RUNNING, 0 otherwise.
+ */
+static int is_child_live(const child_entry_t *child) {
+    return child->state == CHILD_STATE_STARTING || child->state == CHILD_STATE_RUNNING;
+}
+
+/*
+ * live_child_count
+ *
+ * Returns the number of children that are STARTING or RUNNING, from the
+ * per-state counters.
+ *
+ * Accepts: None
+ * Returns: Number of live children.
+ */
+static size_t live_child_count(void) {
+    return g_state_counts[CHILD_STATE_STARTING] + g_state_counts[CHILD_STATE_RUNNING];
+}
+
+/*
+ * child_state_name
+ *
+ * Accepts:
+ *   state - Lifecycle state
+ *
+ * Returns: Upper-case name of the state.
+ */
+static const char *child_state_name(child_state_t state) {
+    switch (state) {
+        case CHILD_STATE_STARTING: return "STARTING";
+        case CHILD_STATE_RUNNING:  return "RUNNING";
+        case CHILD_STATE_DESCENDANT: return "DESCENDANT";
+        case CHILD_STATE_SIGNALED: return "SIGNALED";
+        case CHILD_STATE_EXITED:   return "EXITED";
+        case CHILD_STATE_REAPED:   return "REAPED";
+        default:                   return "UNKNOWN";
+    }
+}
+
+/*
+ * build_poll_set
+ *
+ * Fills g_pollfds with the SIGCHLD self-pipe, stdin (ignored by poll() when
+ * not interactive), the PSI trigger fds (if any), the worker pipe (-T), the exec-status pipes of STARTING children, the
+ * stderr pipes of all children and the pidfds of running descendants (-O,
+ * readable once they exit). g_poll_owners records the registry index
+ * of each child fd. Exits on allocation failure.
+ *
+ * Accepts: None
+ * Returns: Number of entries in g_pollfds.
+ */
+static size_t build_poll_set(void) {
+    size_t needed = POLL_FIXED_FDS + g_state_counts[CHILD_STATE_STARTING] + g_child_count;
+
+    if (needed > g_pollfd_capacity) {
+        size_t new_capacity = (g_pollfd_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_pollfd_capacity;
+        while (new_capacity < needed) {
+            new_capacity *= 2;
+        }
+        struct pollfd *new_pollfds = realloc(g_pollfds, new_capacity * sizeof(struct pollfd));
+        if (new_pollfds == NULL) {
+            perror("Error: Failed to allocate poll set");
+            exit(EXIT_FAILURE); // This will trigger atexit
+        }
+        g_pollfds = new_pollfds;
+        size_t *new_owners = realloc(g_poll_owners, new_capacity * sizeof(size_t));
+        if (new_owners == NULL) {
+            perror("Error: Failed to allocate poll set");
+            exit(EXIT_FAILURE); // This will trigger atexit
+        }
+        g_poll_owners = new_owners;
+        g_pollfd_capacity = new_capacity;
+    }
+
+    g_pollfds[POLL_SIGCHLD].fd = g_sigchld_pipe[0];
+    g_pollfds[POLL_STDIN].fd = g_stdin_interactive ? STDIN_FILENO : -1; // Negative fds are ignored
+    g_pollfds[POLL_PSI_CPU].fd = g_psi[0].fd;
+    g_pollfds[POLL_PSI_MEMORY].fd = g_psi[1].fd;
+    g_pollfds[POLL_WORKERS].fd = g_worker_pipe[0];
+    size_t count = POLL_FIXED_FDS;
+    for (size_t i = 0; i < g_child_count; ++i) {
+        if (g_children[i].exec_fd != -1) {
+            g_poll_owners[count] = i;
+            g_pollfds[count++].fd = g_children[i].exec_fd;
+        }
+        if (g_children[i].err_fd != -1) {
+            g_poll_owners[count] = i;
+            g_pollfds[count++].fd = g_children[i].err_fd;
+        } else if (g_children[i].state == CHILD_STATE_DESCENDANT && g_children[i].pidfd != -1) {
+            g_poll_owners[count] = i; // Descendants have no stderr pipe, so the count above holds
+            g_pollfds[count++].fd = g_children[i].pidfd;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        g_pollfds[i].events = POLLIN;
+        g_pollfds[i].revents = 0;
+    }
+    g_pollfds[POLL_PSI_CPU].events = POLLPRI; // PSI triggers signal with POLLPRI
+    g_pollfds[POLL_PSI_MEMORY].events = POLLPRI;
+    return count;
+}
+
+/*
+ * service_child_fds
+ *
+ * Handles the child fds that poll() reported ready in g_pollfds: exec-status
+ * pipes, stderr pipes and descendant pidfds. Must run before reap_children(), which removes
+ * registry entries and so invalidates g_poll_owners.
+ *
+ * Accepts:
+ *   nfds - Number of entries returned by build_poll_set()
+ *
+ * Returns: None
+ */
+static void service_child_fds(size_t nfds) {
+    for (size_t i = POLL_FIXED_FDS; i < nfds; ++i) {
+        if (g_pollfds[i].revents == 0) {
+            continue;
+        }
+        child_entry_t *child = &g_children[g_poll_owners[i]];
+        if (g_pollfds[i].fd == child->exec_fd) {
+            handle_exec_status(child);
+        } else if (g_pollfds[i].fd == child->err_fd) {
+            read_child_stderr(child);
+        } else if (g_pollfds[i].fd == child->pidfd) {
+            handle_descendant_exit(child);
+        }
+    }
+}
+
+/*
+ * handle_exec_status
+ *
+ * Reads a STARTING child's exec-status pipe. EOF means execv() succeeded
+ * (the close-on-exec write end was closed), so the child becomes RUNNING.
+ * An errno value means execv() failed; the child stays STARTING until its
+ * exit is reaped.
+ *
+ * Accepts:
+ *   child - The child whose pipe is readable.
+ *
+ * Returns: None
+ */
+static void handle_exec_status(child_entry_t *child) {
+    int exec_errno = 0;
+    ssize_t result = read(child->exec_fd, &exec_errno, sizeof(exec_errno));
+
+    if (result == -1 && (errno == EAGAIN || errno == EINTR)) {
+        return; // Spurious wake-up, try again on the next poll
+    }
+    close(child->exec_fd);
+    child->exec_fd = -1;
+
+    if (result == 0) {
+        child->ready_ns = monotonic_ns();
+        TRACE_PROBE2(exec_ready, child->pid, child->ready_ns - child->spawn_ns);
+        if (child->state == CHILD_STATE_STARTING) {
+            set_child_state(child, CHILD_STATE_RUNNING);
+        }
+    } else if (result == (ssize_t)sizeof(exec_errno)) {
+        if (fprintf(stderr, "PARENT [%d]: Child PID %d failed to exec (errno %d: %s).\r\n",
+            getpid(), child->pid, exec_errno, strerror(exec_errno)) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * raise_fd_limit
+ *
+ * Raises the soft RLIMIT_NOFILE to the hard limit, since the parent keeps
+ * one stderr pipe per child open. Children inherit the raised limit, which
+ * is harmless since they only use the three standard descriptors.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void raise_fd_limit(void) {
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1 || limit.rlim_cur == limit.rlim_max) {
+        return;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        if (fprintf(stderr, "Warning: Failed to raise the open file limit (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * open_child_log
+ *
+ * Selects the destination for captured child stderr: the terminal (the
+ * parent's stderr) or, if a path is given, a log file opened for appending.
+ *
+ * Accepts:
+ *   path - Log file path, or NULL for the terminal
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int open_child_log(const char *path) {
+    g_log_tokens = g_log_rate;
+    g_log_refill_ns = monotonic_ns();
+    if (path == NULL) {
+        g_log_fd = STDERR_FILENO;
+        return 0;
+    }
+    g_log_fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (g_log_fd == -1) {
+        if (fprintf(stderr, "Error: Cannot open child log '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * read_child_stderr
+ *
+ * Reads everything currently available from a child's stderr pipe and
+ * hands complete lines to capture_child_line(). A partial line is kept in
+ * the entry until its newline arrives; lines longer than ERR_LINE_LEN are
+ * split. On EOF the partial line is emitted and the pipe is closed.
+ *
+ * Accepts:
+ *   child - Registry entry with an open err_fd
+ *
+ * Returns: None
+ */
+static void read_child_stderr(child_entry_t *child) {
+    char buf[4096];
+    ssize_t result;
+
+    if (child->err_fd == -1) {
+        return;
+    }
+    while ((result = read(child->err_fd, buf, sizeof(buf))) > 0) {
+        g_log_metrics.bytes += (unsigned long long)result;
+        for (ssize_t i = 0; i < result; ++i) {
+            if (buf[i] == '\n') {
+                capture_child_line(child->err_line, child->err_len);
+                child->err_len = 0;
+                continue;
+            }
+            if (child->err_len == sizeof(child->err_line)) {
+                capture_child_line(child->err_line, child->err_len);
+                child->err_len = 0;
+            }
+            child->err_line[child->err_len++] = buf[i];
+        }
+    }
+    if (result == 0 || (errno != EAGAIN && errno != EINTR)) { // EOF or a broken pipe
+        if (child->err_len > 0) {
+            capture_child_line(child->err_line, child->err_len);
+            child->err_len = 0;
+        }
+        close(child->err_fd);
+        child->err_fd = -1;
+    }
+}
+
+/*
+ * capture_child_line
+ *
+ * Appends one captured child line to the output batch, prefixed with the
+ * seconds since the parent started. Lines beyond the rate limit are
+ * dropped and counted; the count is reported in the log before the next
+ * line that gets through. Trailing carriage returns are stripped and the
+ * line ending matching the destination is added.
+ *
+ * Accepts:
+ *   text - Line contents without the newline
+ *   len - Length of text
+ *
+ * Returns: None
+ */
+static void capture_child_line(const char *text, size_t len) {
+    long long now_ns = monotonic_ns();
+    const char *eol = (g_log_path == NULL) ? "\r\n" : "\n"; // The terminal may be in raw mode
+    char prefix[96];
+    int prefix_len;
+
+    g_log_metrics.lines++;
+    if (g_log_rate > 0.0) {
+        g_log_tokens += g_log_rate * (double)(now_ns - g_log_refill_ns) / 1e9;
+        if (g_log_tokens > g_log_rate) {
+            g_log_tokens = g_log_rate; // Burst of at most one second's worth of lines
+        }
+        g_log_refill_ns = now_ns;
+        if (g_log_tokens < 1.0) {
+            g_log_metrics.dropped++;
+            g_log_dropped_pending++;
+            return;
+        }
+        g_log_tokens -= 1.0;
+    }
+
+    while (len > 0 && text[len - 1] == '\r') {
+        len--;
+    }
+    char *recent = g_log_recent[g_log_recent_count++ % LOG_RECENT_LINES];
+    size_t recent_len = (len < ERR_LINE_LEN - 1) ? len : ERR_LINE_LEN - 1;
+    memcpy(recent, text, recent_len);
+    recent[recent_len] = '\0';
+    if (g_dashboard_active && g_log_fd == STDERR_FILENO) {
+        return; // Shown in the dashboard instead of scrolling the screen
+    }
+
+    double offset_s = (double)(now_ns - g_start_ns) / 1e9;
+    if (g_log_dropped_pending > 0) {
+        prefix_len = snprintf(prefix, sizeof(prefix), "[+%.3f] (%llu child lines dropped by rate limit)%s[+%.3f] ",
+                              offset_s, g_log_dropped_pending, eol, offset_s);
+    } else {
+        prefix_len = snprintf(prefix, sizeof(prefix), "[+%.3f] ", offset_s);
+    }
+    if (prefix_len < 0 || (size_t)prefix_len >= sizeof(prefix)) {
+        prefix_len = 0;
+    }
+    g_log_dropped_pending = 0;
+
+    size_t needed = (size_t)prefix_len + len + strlen(eol);
+    if (g_log_batch_len + needed > sizeof(g_log_batch)) {
+        flush_child_log(1);
+    }
+    if (g_log_batch_len == 0) {
+        g_log_batch_ns = now_ns;
+    }
+    memcpy(g_log_batch + g_log_batch_len, prefix, (size_t)prefix_len);
+    g_log_batch_len += (size_t)prefix_len;
+    memcpy(g_log_batch + g_log_batch_len, text, len);
+    g_log_batch_len += len;
+    memcpy(g_log_batch + g_log_batch_len, eol, strlen(eol));
+    g_log_batch_len += strlen(eol);
+}
+
+/*
+ * flush_child_log
+ *
+ * Writes the batch of captured child lines with a single write once the
+ * oldest line has waited LOG_FLUSH_NS, or immediately when forced.
+ *
+ * Accepts:
+ *   force - Non-zero to write regardless of the batch age
+ *
+ * Returns: None
+ */
+static void flush_child_log(int force) {
+    if (g_log_batch_len == 0 || g_log_fd == -1) {
+        return;
+    }
+    if (!force && monotonic_ns() - g_log_batch_ns < LOG_FLUSH_NS) {
+        return;
+    }
+    if (g_log_fd == STDERR_FILENO && fflush(stderr) == EOF) { /* Handle error? */ }
+    if (safe_write(g_log_fd, g_log_batch, g_log_batch_len) == -1) {
+        if (fprintf(stderr, "Warning: Failed to write captured child output (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+    }
+    g_log_metrics.writes++;
+    g_log_batch_len = 0;
+}
+
+/*
+ * log_timeout_ms
+ *
+ * Shortens a poll() timeout so that a pending batch of captured child
+ * lines is flushed on time.
+ *
+ * Accepts:
+ *   timeout_ms - Timeout the caller would use otherwise (-1 = infinite)
+ *
+ * Returns: Timeout in milliseconds for poll().
+ */
+static int log_timeout_ms(int timeout_ms) {
+    if (g_log_batch_len == 0) {
+        return timeout_ms;
+    }
+    long long remaining_ns = g_log_batch_ns + LOG_FLUSH_NS - monotonic_ns();
+    int flush_ms = (remaining_ns <= 0) ? 0 : (int)((remaining_ns + 999999LL) / 1000000LL);
+    return (timeout_ms < 0 || flush_ms < timeout_ms) ? flush_ms : timeout_ms;
+}
+
+/*
+ * create_stats_region
+ *
+ * Creates the shared statistics region: an unlinked POSIX shared memory
+ * object with STATS_SLOT_COUNT slots, mapped into the parent. Its
+ * descriptor is close-on-exec; spawn_child() hands each child a duplicate.
+ * With -H the region is first tried as a hugetlbfs memfd (whole huge pages,
+ * needs reserved huge pages), then as shared memory with a transparent
+ * huge page hint; either way it is prefaulted and locked in the parent.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int create_stats_region(void) {
+    char name[64];
+    void *region = MAP_FAILED;
+
+    if (g_huge_pages) {
+        size_t len = (STATS_REGION_SIZE + STATS_HUGE_PAGE_SIZE - 1) & ~(STATS_HUGE_PAGE_SIZE - 1);
+        g_stats_fd = memfd_create("lab03-stats", MFD_CLOEXEC | MFD_HUGETLB);
+        if (g_stats_fd != -1 && ftruncate(g_stats_fd, (off_t)len) == 0) {
+            region = map_stats_region(g_stats_fd, len, "huge pages (hugetlbfs)");
+        }
+        if (region == MAP_FAILED) {
+            if (fprintf(stderr, "Warning: Huge pages unavailable for the stats region (errno %d: %s); trying transparent huge pages.\r\n",
+                errno, strerror(errno)) < 0) { /* Handle error? */ }
+            if (g_stats_fd != -1) {
+                close(g_stats_fd);
+                g_stats_fd = -1;
+            }
+        }
+    }
+
+    if (region == MAP_FAILED) {
+        snprintf(name, sizeof(name), "/lab03-stats-%d", getpid());
+        g_stats_fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (g_stats_fd == -1) {
+            if (fprintf(stderr, "Error: shm_open('%s') failed (errno %d: %s).\r\n", name, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            return -1;
+        }
+        shm_unlink(name); // Only the descriptor is needed from now on
+        if (ftruncate(g_stats_fd, (off_t)STATS_REGION_SIZE) == -1) {
+            if (fprintf(stderr, "Error: Failed to size the stats region (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+            close(g_stats_fd);
+            g_stats_fd = -1;
+            return -1;
+        }
+        region = map_stats_region(g_stats_fd, STATS_REGION_SIZE, g_huge_pages ? "transparent huge pages if shmem allows" : NULL);
+        if (region == MAP_FAILED) {
+            if (fprintf(stderr, "Error: Failed to map the stats region (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+            close(g_stats_fd);
+            g_stats_fd = -1;
+            return -1;
+        }
+    }
+    g_stats_slots = region;
+
+    // Lowest indices on top of the stack, so a small fleet stays in a few pages
+    g_free_slot_count = 0;
+    for (int slot = STATS_SLOT_COUNT - 1; slot >= 0; --slot) {
+        g_free_slots[g_free_slot_count++] = slot;
+    }
+    return 0;
+}
+
+/*
+ * map_stats_region
+ *
+ * Maps the region and records its length. With -H the mapping is
+ * prefaulted (MAP_POPULATE), hinted for transparent huge pages and locked;
+ * failing to lock only costs the guarantee, so it is a warning.
+ *
+ * Accepts:
+ *   fd - Region descriptor (already sized)
+ *   len - Length to map
+ *   backing - Description for the startup message, NULL for normal pages
+ *
+ * Returns: The mapping, or MAP_FAILED (errno set).
+ */
+static void *map_stats_region(int fd, size_t len, const char *backing) {
+    void *region = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | (g_huge_pages ? MAP_POPULATE : 0), fd, 0);
+
+    if (region == MAP_FAILED) {
+        return region;
+    }
+    g_stats_region_len = len;
+    if (!g_huge_pages) {
+        return region;
+    }
+    madvise(region, len, MADV_HUGEPAGE); // Ignored on hugetlbfs, or if shmem THP is disabled
+    if (mlock(region, len) == -1) {
+        if (fprintf(stderr, "Warning: Cannot lock the stats region (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+    }
+    if (fprintf(stderr, "PARENT [%d]: Stats region: %zu KiB on %s, prefaulted.\r\n", getpid(), len / 1024, backing) < 0) { /* Handle error? */ }
+    return region;
+}
+
+/*
+ * acquire_stats_slot
+ *
+ * Takes an unused slot and clears it for a new child.
+ *
+ * Accepts: None
+ * Returns: Slot index, or -1 if the region is unavailable or full.
+ */
+static int acquire_stats_slot(void) {
+    if (g_stats_slots == NULL || g_free_slot_count == 0) {
+        return -1;
+    }
+    int slot = g_free_slots[--g_free_slot_count];
+    memset((void *)&g_stats_slots[slot], 0, sizeof(stats_slot_t));
+    return slot;
+}
+
+/*
+ * release_stats_slot
+ *
+ * Returns a slot to the free stack. Only called for reaped (or never
+ * started) children, so nobody writes to it any more.
+ *
+ * Accepts:
+ *   slot - Slot index, or -1 (ignored)
+ *
+ * Returns: None
+ */
+static void release_stats_slot(int slot) {
+    if (slot >= 0 && g_free_slot_count < STATS_SLOT_COUNT) {
+        g_free_slots[g_free_slot_count++] = slot;
+    }
+}
+
+/*
+ * start_sampler
+ *
+ * Forks the external sampler process. It shares the stats region with the
+ * parent and dies with it (PR_SET_PDEATHSIG). The scheduler is free to
+ * run it on another core than the children it observes.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int start_sampler(void) {
+    pid_t parent_pid = getpid();
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        if (fprintf(stderr, "Error: Failed to fork the sampler (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (pid == 0) {
+        // The parent's handlers (cleanup, SIGCHLD self-pipe) must not run here
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sigemptyset(&sa.sa_mask);
+        sa.sa_handler = SIG_DFL;
+        sigaction(SIGTERM, &sa, NULL);
+        sigaction(SIGCHLD, &sa, NULL);
+        sa.sa_handler = SIG_IGN;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGQUIT, &sa, NULL);
+        prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+        if (getppid() != parent_pid) {
+            _exit(EXIT_FAILURE); // The parent died before PR_SET_PDEATHSIG took effect
+        }
+        run_sampler();
+        _exit(EXIT_SUCCESS);
+    }
+    g_sampler_pid = pid;
+    if (fprintf(stderr, "PARENT [%d]: External sampler PID %d reads each child's pair %.0f times per second.\r\n",
+        parent_pid, (int)pid, g_sample_rate) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * run_sampler
+ *
+ * Body of the sampler process. Every SAMPLER_RESCAN_NS it collects the
+ * slots of children that published a pair address and are not done yet. On every tick it reads each pair with
+ * process_vm_readv(), classifies it and updates the slot's counters, as
+ * the child's SIGALRM handler would. It is the only writer of those slots:
+ * checkpoints every CHECKPOINT_INTERVAL samples, and the final checkpoint
+ * (after the last repetition, or the first sample past the deadline of a
+ * time-boxed run) before setting done, which is what the child waits for.
+ * Slots of paused children are skipped. Ticks missed while the sampler was
+ * not running are skipped.
+ *
+ * Accepts: None
+ * Returns: None (runs until killed)
+ */
+static void run_sampler(void) {
+    static int targets[STATS_SLOT_COUNT];
+    static pid_t target_pids[STATS_SLOT_COUNT];
+    int target_count = 0;
+    long long period_ns = (long long)(1e9 / g_sample_rate);
+    long long next_ns = monotonic_ns();
+    long long rescan_ns = 0;
+
+    for (;;) {
+        long long now = monotonic_ns();
+        if (now >= rescan_ns) {
+            target_count = 0;
+            for (int slot = 0; slot < STATS_SLOT_COUNT; ++slot) {
+                stats_slot_t *entry = &g_stats_slots[slot];
+                pid_t pid = entry->pid;
+                if (pid != 0 && entry->pair_addr != 0 && !entry->done) {
+                    targets[target_count] = slot;
+                    target_pids[target_count] = pid;
+                    target_count++;
+                }
+            }
+            rescan_ns = now + SAMPLER_RESCAN_NS;
+        }
+
+        for (int i = 0; i < target_count; ++i) {
+            stats_slot_t *entry = &g_stats_slots[targets[i]];
+            volatile int pair[2];
+            struct iovec local = { (void *)pair, sizeof(pair) };
+            struct iovec remote = { (void *)(uintptr_t)entry->pair_addr, sizeof(pair) };
+
+            if (target_pids[i] == 0 || entry->pid != target_pids[i]) {
+                target_pids[i] = 0; // Slot released or reused since the scan
+                continue;
+            }
+            if (entry->paused) {
+                continue; // Stopped by 'p'; the child clears the mark after moving its deadline
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if (process_vm_readv(target_pids[i], &local, 1, &remote, 1, 0) != (ssize_t)sizeof(pair)) {
+                target_pids[i] = 0; // Exited, or not readable; dropped until the next scan
+                continue;
+            }
+
+            int state = (pair[0] != 0) * 2 + (pair[1] != 0);
+            int64_t repetitions = entry->repetitions + 1;
+            int finished = (entry->deadline_ns != 0) ? monotonic_ns() >= entry->deadline_ns : repetitions >= entry->total_reps;
+            entry->counts[state]++;
+            if (finished || repetitions % CHECKPOINT_INTERVAL == 0) {
+                checkpoint_data_t data;
+                data.reason = finished ? CHECKPOINT_FINAL : CHECKPOINT_PERIODIC;
+                data.repetitions = repetitions;
+                for (int c = 0; c < 4; ++c) {
+                    data.counts[c] = entry->counts[c];
+                }
+                stats_checkpoint_write(entry, &data);
+            }
+            entry->repetitions = repetitions;
+            if (finished) {
+                atomic_thread_fence(memory_order_release); // Counters and checkpoint before the flag the child polls
+                entry->done = 1;
+                target_pids[i] = 0;
+            }
+        }
+
+        next_ns += period_ns;
+        now = monotonic_ns();
+        if (next_ns < now) {
+            next_ns = now; // Overrun: skip the missed ticks
+        }
+        struct timespec deadline = { (time_t)(next_ns / 1000000000LL), (long)(next_ns % 1000000000LL) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {
+        }
+    }
+}
+
+/*
+ * stop_sampler
+ *
+ * Kills and reaps the sampler process, if it is running.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void stop_sampler(void) {
+    if (g_sampler_pid > 0) {
+        kill(g_sampler_pid, SIGKILL);
+        while (waitpid(g_sampler_pid, NULL, 0) == -1 && errno == EINTR) {
+        }
+        g_sampler_pid = -1;
+    }
+}
+
+/*
+ * parse_psi_thresholds
+ *
+ * Parses CPU%[:MEM%] for -P. The memory threshold defaults to the CPU one.
+ *
+ * Accepts:
+ *   text - Option argument
+ *
+ * Returns:
+ *   0 on success, -1 if malformed.
+ */
+static int parse_psi_thresholds(const char *text) {
+    char *end = NULL;
+    double cpu = strtod(text, &end);
+    double memory = cpu;
+
+    if (end == text || !(cpu > 0.0) || cpu > 100.0) {
+        return -1;
+    }
+    if (*end == ':') {
+        const char *mem_text = end + 1;
+        memory = strtod(mem_text, &end);
+        if (end == mem_text || !(memory > 0.0) || memory > 100.0) {
+            return -1;
+        }
+    }
+    if (*end != '\0') {
+        return -1;
+    }
+    g_psi[0].threshold_pct = cpu;
+    g_psi[1].threshold_pct = memory;
+    g_psi_enabled = 1;
+    return 0;
+}
+
+/*
+ * open_psi_watches
+ *
+ * Registers a PSI trigger ("some" stall over the threshold share of a
+ * PSI_WINDOW_US window) on each pressure file; the fds join the main
+ * loop's poll set. If a trigger cannot be registered (old kernel, no
+ * permission) the files are sampled every PSI_POLL_NS instead.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 if PSI is not available at all (prints error message).
+ */
+static int open_psi_watches(void) {
+    pid_t parent_pid = getpid();
+
+    for (int r = 0; r < PSI_RESOURCES; ++r) {
+        psi_watch_t *watch = &g_psi[r];
+        char trigger[64];
+        long long stall_us = (long long)(watch->threshold_pct / 100.0 * (double)PSI_WINDOW_US);
+        int len = snprintf(trigger, sizeof(trigger), "some %lld %lld", stall_us, PSI_WINDOW_US);
+
+        if (read_psi_some_total(watch->path, &watch->last_total_us) != 0) {
+            if (fprintf(stderr, "Error: Cannot read %s (errno %d: %s); pressure stall information is unavailable.\r\n",
+                watch->path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            return -1;
+        }
+        watch->fd = open(watch->path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        // The trigger string is written including its terminating NUL, as the kernel expects
+        if (watch->fd == -1 || write(watch->fd, trigger, (size_t)len + 1) == -1) {
+            if (fprintf(stderr, "PARENT [%d]: Warning: Cannot register a %s pressure trigger (errno %d: %s); sampling instead.\r\n",
+                parent_pid, watch->name, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            if (watch->fd != -1) {
+                close(watch->fd);
+                watch->fd = -1;
+            }
+            g_psi_polling = 1;
+        }
+    }
+    if (g_psi_polling) { // One mechanism for both resources keeps the accounting comparable
+        for (int r = 0; r < PSI_RESOURCES; ++r) {
+            if (g_psi[r].fd != -1) {
+                close(g_psi[r].fd);
+                g_psi[r].fd = -1;
+            }
+        }
+        g_psi_last_poll_ns = monotonic_ns();
+        g_psi_next_poll_ns = g_psi_last_poll_ns + PSI_POLL_NS;
+    }
+    if (fprintf(stderr, "PARENT [%d]: Spawns are deferred while cpu stalls exceed %.1f%% or memory stalls %.1f%% (%s).\r\n",
+        parent_pid, g_psi[0].threshold_pct, g_psi[1].threshold_pct, g_psi_polling ? "sampled" : "PSI triggers") < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * read_psi_some_total
+ *
+ * Accepts:
+ *   path - Pressure file
+ *   total_us - Output: cumulative "some" stall time in microseconds
+ *
+ * Returns:
+ *   0 on success, -1 on failure (errno set).
+ */
+static int read_psi_some_total(const char *path, long long *total_us) {
+    char buf[256];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        return -1;
+    }
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        errno = (n == 0) ? EIO : errno;
+        return -1;
+    }
+    buf[n] = '\0';
+    const char *total = strstr(buf, "total="); // The first line is "some"
+    if (strncmp(buf, "some", 4) != 0 || total == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+    *total_us = strtoll(total + 6, NULL, 10);
+    return 0;
+}
+
+/*
+ * note_pressure
+ *
+ * Records a pressure event and keeps spawns deferred for PSI_HOLD_NS.
+ *
+ * Accepts:
+ *   watch - Resource that reported pressure
+ *   now_ns - Current monotonic time
+ *
+ * Returns: None
+ */
+static void note_pressure(psi_watch_t *watch, long long now_ns) {
+    watch->events++;
+    if (g_throttle_start_ns == 0) {
+        g_throttle_start_ns = now_ns;
+        if (!g_quiet_ops) {
+            if (fprintf(stderr, "PARENT [%d]: %s pressure above threshold; deferring spawns.\r\n", getpid(), watch->name) < 0) { /* Handle error? */ }
+        }
+    }
+    g_throttle_until_ns = now_ns + PSI_HOLD_NS;
+}
+
+/*
+ * service_psi
+ *
+ * Handles fired PSI triggers (or samples the pressure files when due),
+ * ends a throttled period once no pressure was seen for PSI_HOLD_NS, and
+ * then releases deferred spawns in order, one per PSI_RELEASE_NS, so the
+ * backlog does not recreate the pressure at once. The trigger fds are in
+ * the fixed slots of g_pollfds, which build_poll_set() always fills.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void service_psi(void) {
+    long long now_ns = monotonic_ns();
+
+    if (!g_psi_enabled) {
+        return;
+    }
+    for (int r = 0; r < PSI_RESOURCES; ++r) {
+        short revents = g_pollfds[(r == 0) ? POLL_PSI_CPU : POLL_PSI_MEMORY].revents;
+        if (g_psi[r].fd != -1 && (revents & POLLPRI)) {
+            note_pressure(&g_psi[r], now_ns);
+        } else if (g_psi[r].fd != -1 && (revents & (POLLERR | POLLNVAL))) {
+            close(g_psi[r].fd); // The trigger is gone (e.g. the cgroup was removed)
+            g_psi[r].fd = -1;
+        }
+    }
+    if (g_psi_polling && now_ns >= g_psi_next_poll_ns) {
+        long long elapsed_us = (now_ns - g_psi_last_poll_ns) / 1000;
+        for (int r = 0; r < PSI_RESOURCES; ++r) {
+            long long total_us;
+            if (elapsed_us > 0 && read_psi_some_total(g_psi[r].path, &total_us) == 0) {
+                if ((double)(total_us - g_psi[r].last_total_us) > g_psi[r].threshold_pct / 100.0 * (double)elapsed_us) {
+                    note_pressure(&g_psi[r], now_ns);
+                }
+                g_psi[r].last_total_us = total_us;
+            }
+        }
+        g_psi_last_poll_ns = now_ns;
+        g_psi_next_poll_ns = now_ns + PSI_POLL_NS;
+    }
+
+    if (g_throttle_start_ns != 0 && now_ns >= g_throttle_until_ns) {
+        g_throttled_total_ns += now_ns - g_throttle_start_ns;
+        g_throttle_start_ns = 0;
+        g_next_release_ns = now_ns;
+        if (!g_quiet_ops) {
+            if (fprintf(stderr, "PARENT [%d]: Pressure subsided; spawning again (%zu deferred spawns queued).\r\n", getpid(), g_deferred_count) < 0) { /* Handle error? */ }
+        }
+    }
+    while (g_throttle_start_ns == 0 && g_deferred_count > 0 && now_ns >= g_next_release_ns) {
+        deferred_spawn_t entry = g_deferred[g_deferred_head];
+        g_deferred_head = (g_deferred_head + 1) % g_deferred_capacity;
+        g_deferred_count--;
+
+        long long waited_ns = now_ns - entry.requested_ns;
+        g_deferred_wait_total_ns += waited_ns;
+        if (waited_ns > g_deferred_wait_max_ns) {
+            g_deferred_wait_max_ns = waited_ns;
+        }
+        if (spawn_child_with(&entry.sched, entry.has_resume ? &entry.resume : NULL) == 0 && !g_quiet_ops) {
+            if (printf("PARENT [%d]: Deferred spawn released after %.2f s (%zu still queued).\r\n",
+                getpid(), (double)waited_ns / 1e9, g_deferred_count) < 0) { /* Handle error? */ }
+        }
+        g_next_release_ns = now_ns + PSI_RELEASE_NS;
+    }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+}
+
+/*
+ * psi_timeout_ms
+ *
+ * Shortens the main loop's poll timeout so the throttle ends, deferred
+ * spawns are released and pressure files are sampled on time.
+ *
+ * Accepts:
+ *   timeout_ms - Timeout computed so far (-1 = infinite)
+ *
+ * Returns: The possibly shortened timeout.
+ */
+static int psi_timeout_ms(int timeout_ms) {
+    long long due_ns = -1;
+    long long now_ns = monotonic_ns();
+
+    if (!g_psi_enabled) {
+        return timeout_ms;
+    }
+    if (g_throttle_start_ns != 0) {
+        due_ns = g_throttle_until_ns;
+    } else if (g_deferred_count > 0) {
+        due_ns = g_next_release_ns;
+    }
+    if (g_psi_polling && (due_ns == -1 || g_psi_next_poll_ns < due_ns)) {
+        due_ns = g_psi_next_poll_ns;
+    }
+    if (due_ns == -1) {
+        return timeout_ms;
+    }
+    long long wait_ms = (due_ns > now_ns) ? (due_ns - now_ns + 999999LL) / 1000000LL : 0;
+    return (timeout_ms < 0 || wait_ms < timeout_ms) ? (int)wait_ms : timeout_ms;
+}
+
+/*
+ * request_spawn
+ *
+ * Spawns a child now, or queues the request if spawns are throttled (or
+ * earlier requests are still queued, to keep them in order).
+ *
+ * Accepts:
+ *   sched - Scheduling policy for the child
+ *   resume - Checkpoint to resume from, or NULL
+ *
+ * Returns:
+ *   0 if the child was spawned or queued, -1 on failure.
+ */
+static int request_spawn(const sched_spec_t *sched, const checkpoint_data_t *resume) {
+    if (!g_psi_enabled || (g_throttle_start_ns == 0 && g_deferred_count == 0)) {
+        return spawn_child_with(sched, resume);
+    }
+    if (g_deferred_count == g_deferred_capacity) {
+        size_t new_capacity = (g_deferred_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_deferred_capacity * 2;
+        deferred_spawn_t *grown = malloc(new_capacity * sizeof(*grown));
+        if (grown == NULL) {
+            perror("PARENT: Error allocating deferred spawn queue");
+            return -1;
+        }
+        for (size_t i = 0; i < g_deferred_count; ++i) { // Unwrap the ring
+            grown[i] = g_deferred[(g_deferred_head + i) % g_deferred_capacity];
+        }
+        free(g_deferred);
+        g_deferred = grown;
+        g_deferred_head = 0;
+        g_deferred_capacity = new_capacity;
+    }
+
+    deferred_spawn_t *entry = &g_deferred[(g_deferred_head + g_deferred_count) % g_deferred_capacity];
+    entry->sched = *sched;
+    entry->has_resume = (resume != NULL);
+    if (resume != NULL) {
+        entry->resume = *resume;
+    }
+    entry->requested_ns = monotonic_ns();
+    g_deferred_count++;
+    g_deferred_total++;
+    if (!g_quiet_ops) {
+        if (printf("PARENT [%d]: Spawn deferred under host pressure (%zu queued).\r\n", getpid(), g_deferred_count) < 0) { /* Handle error? */ }
+    }
+    return 0;
+}
+
+/*
+ * requeue_deferred_resumes
+ *
+ * Puts resumes that were still queued at exit back into the partial
+ * results, so -K saves them.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void requeue_deferred_resumes(void) {
+    while (g_deferred_count > 0) {
+        deferred_spawn_t *entry = &g_deferred[g_deferred_head];
+        if (entry->has_resume) {
+            add_partial_result(0, &entry->sched, &entry->resume);
+        }
+        g_deferred_head = (g_deferred_head + 1) % g_deferred_capacity;
+        g_deferred_count--;
+    }
+}
+
+/*
+ * toggle_dashboard
+ *
+ * Shows or hides the full-screen dashboard. The dashboard uses the
+ * terminal's alternate screen, so the scrolling output is restored when it
+ * is hidden. While it is shown, per-operation messages are suppressed and
+ * captured child stderr destined for the terminal appears in the dashboard.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void toggle_dashboard(void) {
+    static const char enter_seq[] = "\x1b[?1049h\x1b[?25l\x1b[2J"; // Alternate screen, hide cursor, clear
+    static const char leave_seq[] = "\x1b[?25h\x1b[?1049l";        // Show cursor, normal screen
+
+    if (!isatty(STDOUT_FILENO)) {
+        if (fprintf(stderr, "PARENT [%d]: Dashboard needs a terminal on stdout.\r\n", getpid()) < 0) { /* Handle error? */ }
+        return;
+    }
+    if (fflush(stdout) == EOF || fflush(stderr) == EOF) { /* Handle error? */ }
+
+    g_dashboard_active = !g_dashboard_active;
+    g_quiet_ops = g_dashboard_active;
+    if (g_dashboard_active) {
+        safe_write(STDOUT_FILENO, enter_seq, sizeof(enter_seq) - 1);
+        g_dashboard_valid = 0;
+        g_dashboard_last_ns = 0; // Rates restart from the first frame
+        render_dashboard(1);
+    } else {
+        safe_write(STDOUT_FILENO, leave_seq, sizeof(leave_seq) - 1);
+        flush_child_log(1);
+    }
+}
+
+/*
+ * dashboard_timeout_ms
+ *
+ * Shortens a poll() timeout so that the next dashboard frame is drawn on
+ * time.
+ *
+ * Accepts:
+ *   timeout_ms - Timeout the caller would use otherwise (-1 = infinite)
+ *
+ * Returns: Timeout in milliseconds for poll().
+ */
+static int dashboard_timeout_ms(int timeout_ms) {
+    if (!g_dashboard_active) {
+        return timeout_ms;
+    }
+    long long remaining_ns = g_dashboard_next_ns - monotonic_ns();
+    int frame_ms = (remaining_ns <= 0) ? 0 : (int)((remaining_ns + 999999LL) / 1000000LL);
+    return (timeout_ms < 0 || frame_ms < timeout_ms) ? frame_ms : timeout_ms;
+}
+
+/*
+ * format_dashboard_child
+ *
+ * Formats one row of the dashboard's child table: PID, state, policy,
+ * progress bar, repetitions, torn rate ({0,1} and {1,0} samples over all
+ * samples) and age. Progress and torn rate come from the child's shared
+ * slot and are shown as '-' when it has none or has not attached yet.
+ *
+ * Accepts:
+ *   child - Registry entry
+ *   now_ns - Current monotonic time
+ *   buf - Output buffer
+ *   buf_size - Size of buf
+ *
+ * Returns: Result of snprintf.
+ */
+static int format_dashboard_child(const child_entry_t *child, long long now_ns, char *buf, size_t buf_size) {
+    char sched_name[SCHED_NAME_LEN];
+    char bar[DASH_BAR_WIDTH + 1];
+    double age_s = (double)(now_ns - child->spawn_ns) / 1e9;
+
+    format_sched_spec(&child->sched, sched_name, sizeof(sched_name));
+    if (child->slot < 0 || g_stats_slots[child->slot].pid != child->pid) {
+        return snprintf(buf, buf_size, "%7d %-8s %-9s %-*s %12s %7s %7.1f",
+                        child->pid, child_state_name(child->state), sched_name,
+                        DASH_BAR_WIDTH + 2, "-", "-", "-", age_s);
+    }
+
+    const stats_slot_t *slot = &g_stats_slots[child->slot];
+    long long reps = slot->repetitions;
+    long long total = slot->total_reps;
+    long long torn = slot->counts[1] + slot->counts[2];
+    long long samples = torn + slot->counts[0] + slot->counts[3];
+    char total_text[16];
+    int filled;
+
+    if (total > 0) {
+        filled = (int)(reps * DASH_BAR_WIDTH / total);
+        snprintf(total_text, sizeof(total_text), "%lld", total);
+    } else { // Time-boxed: progress is running (not paused) time over the duration
+        long long paused_ns = child->paused_total_ns + ((child->paused_ns != 0) ? now_ns - child->paused_ns : 0);
+        double run_s = age_s - (double)paused_ns / 1e9;
+        filled = (child->duration_s > 0.0) ? (int)(run_s * DASH_BAR_WIDTH / child->duration_s) : 0;
+        snprintf(total_text, sizeof(total_text), "%.0fs", child->duration_s);
+    }
+
+    if (filled > DASH_BAR_WIDTH) {
+        filled = DASH_BAR_WIDTH;
+    }
+    memset(bar, '#', (size_t)filled);
+    memset(bar + filled, '.', (size_t)(DASH_BAR_WIDTH - filled));
+    bar[DASH_BAR_WIDTH] = '\0';
+    return snprintf(buf, buf_size, "%7d %-8s %-9s [%s] %5lld/%-6s %6.2f%% %7.1f",
+                    child->pid, child_state_name(child->state), sched_name, bar, reps, total_text,
+                    (samples > 0) ? 100.0 * (double)torn / (double)samples : 0.0, age_s);
+}
+
+/*
+ * render_dashboard
+ *
+ * Draws a dashboard frame when one is due (or when forced): child counts
+ * per state, spawn and reap rates, aggregate torn rate, one row per child
+ * that fits the terminal, and the newest captured child stderr lines.
+ * Only rows that differ from the previous frame are rewritten (cursor
+ * positioning plus erase-to-end-of-line), and the whole frame goes out in
+ * a single write. A full repaint happens after a resize or after other
+ * output may have overwritten the screen (g_dashboard_valid cleared).
+ *
+ * Accepts:
+ *   force - Non-zero to draw even if the next frame is not yet due
+ *
+ * Returns: None
+ */
+static void render_dashboard(int force) {
+    long long now_ns = monotonic_ns();
+    struct winsize ws;
+
+    if (!g_dashboard_active || (!force && now_ns < g_dashboard_next_ns)) {
+        return;
+    }
+    g_dashboard_next_ns = now_ns + (long long)(1e9 / g_dashboard_hz);
+
+    int rows = 24;
+    int cols = 80;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0 && ws.ws_col > 0) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    cols = (cols - 1 < DASH_MAX_COLS) ? cols - 1 : DASH_MAX_COLS; // Never touch the last column: no auto-wrap
+    if (rows < DASH_HEADER_ROWS + 2 || cols < 20) {
+        return; // Too small to draw anything useful
+    }
+
+    if (rows != g_dashboard_rows || cols != g_dashboard_cols || g_dashboard_prev == NULL) {
+        size_t prev_size = (size_t)rows * (DASH_MAX_COLS + 1);
+        size_t out_size = (size_t)rows * (DASH_MAX_COLS + 16) + 16; // Row text plus cursor and erase sequences
+        char *new_prev = realloc(g_dashboard_prev, prev_size);
+        char *new_out = realloc(g_dashboard_out, out_size);
+        if (new_prev != NULL) {
+            g_dashboard_prev = new_prev;
+        }
+        if (new_out != NULL) {
+            g_dashboard_out = new_out;
+            g_dashboard_out_size = out_size;
+        }
+        if (new_prev == NULL || new_out == NULL) {
+            g_dashboard_rows = 0; // Retry on the next frame
+            return;
+        }
+        g_dashboard_rows = rows;
+        g_dashboard_cols = cols;
+        g_dashboard_valid = 0;
+    }
+
+    // Rates since the previous frame, smoothed so a single busy frame does not dominate
+    unsigned long long spawned = g_spawned_total;
+    unsigned long long reaped = g_reap_metrics.reaped;
+    if (g_dashboard_last_ns != 0 && now_ns > g_dashboard_last_ns) {
+        double dt = (double)(now_ns - g_dashboard_last_ns) / 1e9;
+        double spawn_rate = (double)(spawned - g_dashboard_last_spawned) / dt;
+        double reap_rate = (double)(reaped - g_dashboard_last_reaped) / dt;
+        g_dashboard_spawn_rate += DASH_RATE_SMOOTHING * (spawn_rate - g_dashboard_spawn_rate);
+        g_dashboard_reap_rate += DASH_RATE_SMOOTHING * (reap_rate - g_dashboard_reap_rate);
+    }
+    g_dashboard_last_ns = now_ns;
+    g_dashboard_last_spawned = spawned;
+    g_dashboard_last_reaped = reaped;
+
+    long long torn_total = 0;
+    long long samples_total = 0;
+    if (g_stats_slots != NULL) {
+        for (size_t i = 0; i < g_child_count; ++i) {
+            const child_entry_t *child = &g_children[i];
+            if (child->slot >= 0 && g_stats_slots[child->slot].pid == child->pid) {
+                const stats_slot_t *slot = &g_stats_slots[child->slot];
+                long long torn = slot->counts[1] + slot->counts[2];
+                torn_total += torn;
+                samples_total += torn + slot->counts[0] + slot->counts[3];
+            }
+        }
+    }
+
+    int recent_rows = (int)((g_log_recent_count < LOG_RECENT_LINES) ? g_log_recent_count : LOG_RECENT_LINES);
+    int table_rows = rows - DASH_HEADER_ROWS - 1 - ((recent_rows > 0) ? recent_rows + 1 : 0);
+    if (table_rows < 1) {
+        recent_rows = 0;
+        table_rows = rows - DASH_HEADER_ROWS - 1;
+    }
+
+    size_t out_len = 0;
+    char line[DASH_MAX_COLS + 64];
+    for (int row = 0; row < rows; ++row) {
+        int len;
+        int table_row = row - DASH_HEADER_ROWS;
+        int recent_row = row - (DASH_HEADER_ROWS + table_rows + 1);
+
+        line[0] = '\0';
+        if (row == 0) {
+            len = snprintf(line, sizeof(line), "lab03 parent %d   up %.1f s   live children %zu   %.1f Hz   'd' leaves, 'q' quits",
+                           getpid(), (double)(now_ns - g_start_ns) / 1e9, live_child_count(), g_dashboard_hz);
+        } else if (row == 1) {
+            len = snprintf(line, sizeof(line), "States: starting %zu  running %zu  signaled %zu  exited %zu  reaped %zu",
+                           g_state_counts[CHILD_STATE_STARTING], g_state_counts[CHILD_STATE_RUNNING],
+                           g_state_counts[CHILD_STATE_SIGNALED], g_state_counts[CHILD_STATE_EXITED],
+                           g_state_counts[CHILD_STATE_REAPED]);
+        } else if (row == 2) {
+            len = snprintf(line, sizeof(line), "Rates:  spawn %.1f/s  reap %.1f/s   exits: %llu normal, %llu failed, %llu by signal",
+                           g_dashboard_spawn_rate, g_dashboard_reap_rate, g_exit_normal, g_exit_failed, g_exit_signaled);
+        } else if (row == 3) {
+            len = snprintf(line, sizeof(line), "Torn:   %lld of %lld samples (%.3f%%)   child stderr dropped %llu",
+                           torn_total, samples_total, (samples_total > 0) ? 100.0 * (double)torn_total / (double)samples_total : 0.0,
+                           g_log_metrics.dropped);
+        } else if (row == 5) {
+            len = snprintf(line, sizeof(line), "%7s %-8s %-9s %-*s %12s %7s %7s", "PID", "STATE", "POLICY",
+                           DASH_BAR_WIDTH + 2, "PROGRESS", "REPS", "TORN", "AGE s");
+        } else if (table_row >= 0 && table_row < table_rows) {
+            size_t index = (size_t)table_row;
+            if (table_row == table_rows - 1 && g_child_count > (size_t)table_rows) {
+                len = snprintf(line, sizeof(line), "  ... and %zu more", g_child_count - (size_t)table_rows + 1);
+            } else if (index < g_child_count) {
+                len = format_dashboard_child(&g_children[index], now_ns, line, sizeof(line));
+            } else {
+                len = 0;
+            }
+        } else if (recent_row == -1 && recent_rows > 0) {
+            len = snprintf(line, sizeof(line), "Recent child stderr:");
+        } else if (recent_row >= 0 && recent_row < recent_rows) {
+            unsigned long n = g_log_recent_count - (unsigned long)recent_rows + (unsigned long)recent_row;
+            len = snprintf(line, sizeof(line), "  %s", g_log_recent[n % LOG_RECENT_LINES]);
+        } else {
+            len = 0;
+        }
+        if (len < 0) {
+            len = 0;
+        }
+        if (len > cols) {
+            len = cols;
+        }
+        line[len] = '\0';
+
+        char *prev = g_dashboard_prev + (size_t)row * (DASH_MAX_COLS + 1);
+        if (g_dashboard_valid && strcmp(prev, line) == 0) {
+            continue; // Row unchanged: nothing to send
+        }
+        memcpy(prev, line, (size_t)len + 1);
+        int seq = snprintf(g_dashboard_out + out_len, g_dashboard_out_size - out_len, "\x1b[%d;1H%s\x1b[K", row + 1, line);
+        if (seq > 0 && (size_t)seq < g_dashboard_out_size - out_len) {
+            out_len += (size_t)seq;
+        }
+    }
+    g_dashboard_valid = 1;
+
+    if (out_len > 0 && safe_write(STDOUT_FILENO, g_dashboard_out, out_len) == -1) {
+        g_dashboard_valid = 0; // Unknown screen contents, repaint next time
+    }
+}
+
+/*
+ * read_child_checkpoint
+ *
+ * Reads the latest checkpoint a child wrote to its shared slot.
+ *
+ * Accepts:
+ *   child - Registry entry
+ *   data - Output: checkpoint contents
+ *
+ * Returns:
+ *   0 if the child has a checkpoint, -1 if it has no slot, never attached
+ *   to it, wrote no checkpoint yet, or no consistent copy could be read.
+ */
+static int read_child_checkpoint(const child_entry_t *child, checkpoint_data_t *data) {
+    if (child->slot < 0 || g_stats_slots == NULL || g_stats_slots[child->slot].pid != child->pid) {
+        return -1;
+    }
+    if (stats_checkpoint_read(&g_stats_slots[child->slot], data) != 0 || data->reason == CHECKPOINT_NONE) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * collect_child_checkpoint
+ *
+ * Called when a child has exited: adds its final counters to the completed
+ * totals, or keeps its last checkpoint as a partial result if it did not
+ * finish. Children that never checkpointed are only counted as lost. The
+ * checkpoint of a persistent child's round that service_rounds() already
+ * collected is not counted again.
+ *
+ * Accepts:
+ *   child - Registry entry of the exited child
+ *
+ * Returns: None
+ */
+static void collect_child_checkpoint(const child_entry_t *child) {
+    checkpoint_data_t data;
+
+    if (read_child_checkpoint(child, &data) != 0) {
+        g_checkpoints_lost++;
+        return;
+    }
+    if (child->rounds_collected > 0 &&
+        (g_stats_slots[child->slot].round <= child->rounds_collected || data.repetitions == 0)) {
+        return; // Exited between rounds, or before the next round took its first sample
+    }
+    if (data.reason == CHECKPOINT_FINAL) {
+        if (g_stats_slots[child->slot].round > 0) {
+            g_rounds_collected++; // The last round of a persistent child
+        }
+        g_completed.children++;
+        g_completed.repetitions += data.repetitions;
+        for (int i = 0; i < 4; ++i) {
+            g_completed.counts[i] += data.counts[i];
+        }
+    } else {
+        add_partial_result(child->pid, &child->sched, &data);
+    }
+}
+
+/*
+ * handle_round_done
+ *
+ * SA_SIGINFO handler for CHILD_ROUND_SIGNAL, queued by a persistent child
+ * that completed a round. Only flags the main loop and wakes it through
+ * the SIGCHLD self-pipe; service_rounds() finds the children from their
+ * slots, so notifications may coalesce. Async-signal-safe.
+ *
+ * Accepts:
+ *   sig - The signal number (expected: CHILD_ROUND_SIGNAL)
+ *   info - Sender
+ *   context - Unused
+ *
+ * Returns: None
+ */
+static void handle_round_done(int sig, siginfo_t *info, void *context) {
+    int saved_errno = errno;
+    (void)context;
+
+    TRACE_PROBE3(signal_receive, sig, info->si_pid, info->si_value.sival_int);
+    if (info->si_code != SI_QUEUE) {
+        return;
+    }
+    g_rounds_pending = 1;
+    if (g_sigchld_pipe[1] != -1) {
+        const char wake = 'r';
+        if (write(g_sigchld_pipe[1], &wake, 1) == -1) {
+            // EAGAIN: the pipe is full, so the main loop is already due to wake up
+        }
+    }
+    errno = saved_errno;
+}
+
+/*
+ * service_rounds
+ *
+ * Collects the rounds persistent children have completed: a child whose
+ * slot holds the final checkpoint of a round not collected yet has its
+ * counters added to the completed totals, then gets
+ * CHILD_COMMAND_NEXT_ROUND to start the next one.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void service_rounds(void) {
+    g_rounds_pending = 0;
+    for (size_t i = 0; i < g_child_count; ++i) {
+        child_entry_t *child = &g_children[i];
+        checkpoint_data_t data;
+
+        if (!is_child_live(child) || child->slot < 0) {
+            continue;
+        }
+        int round = g_stats_slots[child->slot].round;
+        atomic_thread_fence(memory_order_acquire);
+        if (round <= child->rounds_collected || read_child_checkpoint(child, &data) != 0 ||
+            data.reason != CHECKPOINT_FINAL) {
+            continue; // No new round, or still running
+        }
+        g_completed.children++;
+        g_completed.repetitions += data.repetitions;
+        for (int j = 0; j < 4; ++j) {
+            g_completed.counts[j] += data.counts[j];
+        }
+        child->rounds_collected = round;
+        g_rounds_collected++;
+
+        union sigval value;
+        value.sival_int = child_command_encode(CHILD_COMMAND_NEXT_ROUND, round + 1);
+        if (signal_child(child, CHILD_COMMAND_SIGNAL, &value) == 0) {
+            child->last_signal = CHILD_COMMAND_SIGNAL;
+        } else if (errno != ESRCH) {
+            g_round_release_failed++;
+            if (fprintf(stderr, "Warning: Failed to start round %d of PID %d (errno %d: %s).\r\n",
+                round + 1, child->pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        }
+    }
+}
+
+/*
+ * add_partial_result
+ *
+ * Appends a partial result, growing the list as needed.
+ *
+ * Accepts:
+ *   pid - Child that wrote the checkpoint (0 if unknown)
+ *   sched - Policy it ran under
+ *   data - Checkpoint contents
+ *
+ * Returns:
+ *   0 on success, -1 on allocation failure (prints error message).
+ */
+static int add_partial_result(pid_t pid, const sched_spec_t *sched, const checkpoint_data_t *data) {
+    if (g_partial_count >= g_partial_capacity) {
+        size_t new_capacity = (g_partial_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_partial_capacity * 2;
+        partial_result_t *new_partials = realloc(g_partials, new_capacity * sizeof(partial_result_t));
+        if (new_partials == NULL) {
+            if (fprintf(stderr, "PARENT [%d]: Error: Out of memory, partial result of PID %d dropped.\r\n", getpid(), pid) < 0) { /* Handle error? */ }
+            return -1;
+        }
+        g_partials = new_partials;
+        g_partial_capacity = new_capacity;
+    }
+    g_partials[g_partial_count].pid = pid;
+    g_partials[g_partial_count].sched = *sched;
+    g_partials[g_partial_count].data = *data;
+    g_partial_count++;
+    return 0;
+}
+
+/*
+ * print_aggregate
+ *
+ * Prints aggregated statistics: children that completed, partial results
+ * (children that were killed or terminated after at least one checkpoint)
+ * and both combined, each with its torn rate ({0,1} and {1,0} samples over
+ * all samples). The first partial results are also listed individually.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void print_aggregate(void) {
+    static const char *const reason_names[] = { "none", "periodic", "sigterm", "final" };
+    long long partial_reps = 0;
+    long long partial_counts[4] = { 0, 0, 0, 0 };
+    pid_t parent_pid = getpid();
+
+    for (size_t i = 0; i < g_partial_count; ++i) {
+        partial_reps += g_partials[i].data.repetitions;
+        for (int j = 0; j < 4; ++j) {
+            partial_counts[j] += g_partials[i].data.counts[j];
+        }
+    }
+
+    const char *labels[3] = { "Completed", "Partial", "Combined" };
+    unsigned long long groups[3] = { g_completed.children, g_partial_count, g_completed.children + g_partial_count };
+    long long reps[3] = { g_completed.repetitions, partial_reps, g_completed.repetitions + partial_reps };
+    long long counts[3][4];
+    for (int j = 0; j < 4; ++j) {
+        counts[0][j] = g_completed.counts[j];
+        counts[1][j] = partial_counts[j];
+        counts[2][j] = g_completed.counts[j] + partial_counts[j];
+    }
+
+    if (printf("PARENT [%d]: Aggregate statistics (%llu reaped children had no checkpoint):\r\n", parent_pid, g_checkpoints_lost) < 0) { /* Handle error? */ }
+    for (int g = 0; g < 3; ++g) {
+        long long torn = counts[g][1] + counts[g][2];
+        if (printf("  %-9s %6llu runs, %10lld reps, STATS={00:%lld, 01:%lld, 10:%lld, 11:%lld}, torn %.3f%%\r\n",
+            labels[g], groups[g], reps[g], counts[g][0], counts[g][1], counts[g][2], counts[g][3],
+            (reps[g] > 0) ? 100.0 * (double)torn / (double)reps[g] : 0.0) < 0) { /* Handle error? */ }
+    }
+    for (size_t i = 0; i < g_partial_count && i < AGGREGATE_LIST_MAX; ++i) {
+        char sched_name[SCHED_NAME_LEN];
+        int reason = g_partials[i].data.reason;
+        format_sched_spec(&g_partials[i].sched, sched_name, sizeof(sched_name));
+        if (printf("    - PID %d %s at %lld reps (checkpoint: %s)\r\n", g_partials[i].pid, sched_name,
+            (long long)g_partials[i].data.repetitions,
+            (reason >= 0 && reason <= CHECKPOINT_FINAL) ? reason_names[reason] : "unknown") < 0) { /* Handle error? */ }
+    }
+    if (g_partial_count > AGGREGATE_LIST_MAX) {
+        if (printf("    ... and %zu more partial results\r\n", g_partial_count - AGGREGATE_LIST_MAX) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * resume_partials
+ *
+ * Spawns one child per partial result, starting from its checkpointed
+ * counters under the policy it originally ran with (deferred like '+'
+ * while spawns are throttled). With -T, '+' starts thread workers, and so
+ * does this: each partial result continues in a worker, which runs under
+ * the parent's policy. Resumed results leave the partial list; when the
+ * new child or worker ends, its own checkpoint counts.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void resume_partials(void) {
+    size_t resumed = 0;
+    pid_t parent_pid = getpid();
+
+    if (g_partial_count == 0) {
+        if (printf("PARENT [%d]: No partial results to resume.\r\n", parent_pid) < 0) { /* Handle error? */ }
+        return;
+    }
+    while (g_partial_count > 0) {
+        partial_result_t partial = g_partials[g_partial_count - 1];
+        if ((g_thread_workers ? start_worker(&partial.data) : request_spawn(&partial.sched, &partial.data)) != 0) {
+            break; // Keep the rest for a later attempt
+        }
+        g_partial_count--;
+        resumed++;
+    }
+    if (printf("PARENT [%d]: Resumed %zu partial results (%zu left).\r\n", parent_pid, resumed, g_partial_count) < 0) { /* Handle error? */ }
+}
+
+/*
+ * load_checkpoint_file
+ *
+ * Loads partial results saved by a previous run. A missing file is not an
+ * error (the first run creates it on exit).
+ *
+ * Accepts:
+ *   path - Checkpoint file path
+ *
+ * Returns:
+ *   0 on success, -1 if the file cannot be read or is malformed (prints
+ *   error message).
+ */
+static int load_checkpoint_file(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[CHECKPOINT_LINE_LEN];
+    size_t line_number = 0;
+
+    if (file == NULL) {
+        if (errno == ENOENT) {
+            return 0;
+        }
+        if (fprintf(stderr, "Error: Cannot open checkpoint file '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        checkpoint_data_t data;
+        sched_spec_t sched;
+        long long reps, c00, c01, c10, c11;
+        char policy[SCHED_NAME_LEN];
+
+        line_number++;
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%lld %lld %lld %lld %lld %31s", &reps, &c00, &c01, &c10, &c11, policy) != 6 ||
+            reps <= 0 || c00 < 0 || c01 < 0 || c10 < 0 || c11 < 0 || c00 + c01 + c10 + c11 != reps ||
+            parse_sched_spec(policy, &sched) != 0) {
+            if (fprintf(stderr, "Error: %s:%zu: malformed checkpoint line.\r\n", path, line_number) < 0) { /* Handle error? */ }
+            fclose(file);
+            return -1;
+        }
+        data.reason = CHECKPOINT_PERIODIC;
+        data.repetitions = reps;
+        data.counts[0] = c00;
+        data.counts[1] = c01;
+        data.counts[2] = c10;
+        data.counts[3] = c11;
+        if (add_partial_result(0, &sched, &data) != 0) {
+            fclose(file);
+            return -1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/*
+ * save_checkpoint_file
+ *
+ * Saves every unfinished result: the partial result list plus the latest
+ * checkpoint of each tracked child that has not completed. The file is
+ * written under a temporary name and renamed, so an interrupted save never
+ * leaves a truncated file behind.
+ *
+ * Accepts:
+ *   path - Checkpoint file path
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int save_checkpoint_file(const char *path) {
+    char tmp_path[MAX_PATH_LEN];
+    size_t saved = 0;
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        if (fprintf(stderr, "Error: Checkpoint file path is too long.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    FILE *file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        if (fprintf(stderr, "Error: Cannot create checkpoint file '%s' (errno %d: %s).\r\n", tmp_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    int write_failed = (fputs(CHECKPOINT_HEADER, file) == EOF);
+    for (size_t i = 0; i < g_partial_count + g_child_count && !write_failed; ++i) {
+        checkpoint_data_t data;
+        const sched_spec_t *sched;
+        char sched_name[SCHED_NAME_LEN];
+
+        if (i < g_partial_count) {
+            data = g_partials[i].data;
+            sched = &g_partials[i].sched;
+        } else {
+            const child_entry_t *child = &g_children[i - g_partial_count];
+            if (read_child_checkpoint(child, &data) != 0 || data.reason == CHECKPOINT_FINAL) {
+                continue;
+            }
+            sched = &child->sched;
+        }
+        format_sched_spec(sched, sched_name, sizeof(sched_name));
+        if (fprintf(file, "%lld %lld %lld %lld %lld %s\n", (long long)data.repetitions,
+            (long long)data.counts[0], (long long)data.counts[1], (long long)data.counts[2],
+            (long long)data.counts[3], sched_name) < 0) {
+            write_failed = 1;
+        }
+        saved++;
+    }
+    if (fclose(file) == EOF || write_failed || rename(tmp_path, path) == -1) {
+        if (fprintf(stderr, "Error: Cannot write checkpoint file '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        unlink(tmp_path);
+        return -1;
+    }
+    if (fprintf(stderr, "PARENT [%d]: Saved %zu partial results to %s.\r\n", getpid(), saved, path) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * open_results_store
+ *
+ * Opens (or creates) the append-only results file and its index
+ * (path + ".idx"). Recovers from an interrupted writer: a trailing partial
+ * record is truncated away, index entries for blocks that no longer exist
+ * are dropped, and missing entries for complete blocks are rebuilt from the
+ * records. The summary of the block being filled is rebuilt as well.
+ *
+ * Accepts:
+ *   path - Results file path
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int open_results_store(const char *path) {
+    char index_path[MAX_PATH_LEN];
+    results_header_t header;
+    struct stat st;
+
+    if (snprintf(index_path, sizeof(index_path), "%s%s", path, RESULTS_INDEX_SUFFIX) >= (int)sizeof(index_path)) {
+        if (fprintf(stderr, "Error: Results file path is too long.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    int fds[2] = { -1, -1 };
+    const char *paths[2] = { path, index_path };
+    const char *magics[2] = { RESULTS_MAGIC, RESULTS_INDEX_MAGIC };
+    uint32_t sizes[2] = { (uint32_t)sizeof(result_record_t), (uint32_t)sizeof(results_block_t) };
+    uint64_t counts[2];
+
+    for (int i = 0; i < 2; ++i) {
+        // O_APPEND: every write (header, repaired index entries, records) goes to the end
+        fds[i] = open(paths[i], O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fds[i] == -1 || fstat(fds[i], &st) == -1) {
+            if (fprintf(stderr, "Error: Cannot open '%s' (errno %d: %s).\r\n", paths[i], errno, strerror(errno)) < 0) { /* Handle error? */ }
+            goto fail;
+        }
+        if (st.st_size == 0) {
+            memset(&header, 0, sizeof(header));
+            memcpy(header.magic, magics[i], sizeof(header.magic));
+            header.version = RESULTS_VERSION;
+            header.record_size = sizes[i];
+            header.block_records = RESULTS_BLOCK_RECORDS;
+            header.byte_order = RESULTS_BYTE_ORDER;
+            if (write(fds[i], &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+                if (fprintf(stderr, "Error: Cannot write header of '%s' (errno %d: %s).\r\n", paths[i], errno, strerror(errno)) < 0) { /* Handle error? */ }
+                goto fail;
+            }
+            st.st_size = (off_t)sizeof(header);
+        } else if (read_results_header(fds[i], paths[i], magics[i], sizes[i]) != 0) {
+            goto fail;
+        }
+        counts[i] = (uint64_t)(st.st_size - (off_t)sizeof(header)) / sizes[i];
+        off_t whole = (off_t)sizeof(header) + (off_t)(counts[i] * sizes[i]);
+        if (whole != st.st_size && ftruncate(fds[i], whole) == -1) { // Drop a torn trailing entry
+            if (fprintf(stderr, "Error: Cannot repair '%s' (errno %d: %s).\r\n", paths[i], errno, strerror(errno)) < 0) { /* Handle error? */ }
+            goto fail;
+        }
+    }
+
+    g_results_fd = fds[0];
+    g_results_index_fd = fds[1];
+    g_results_records = counts[0];
+
+    uint64_t full_blocks = g_results_records / RESULTS_BLOCK_RECORDS;
+    if (counts[1] > full_blocks) { // Index claims blocks the results file no longer has
+        counts[1] = full_blocks;
+        if (ftruncate(g_results_index_fd, (off_t)sizeof(header) + (off_t)(counts[1] * sizeof(results_block_t))) == -1) { /* Handle error? */ }
+    }
+
+    // Rebuild missing index entries, then the summary of the block being filled
+    result_record_t record;
+    for (uint64_t block = counts[1]; block <= full_blocks; ++block) {
+        uint64_t first = block * RESULTS_BLOCK_RECORDS;
+        uint64_t end = (block < full_blocks) ? first + RESULTS_BLOCK_RECORDS : g_results_records;
+        reset_results_block(first);
+        for (uint64_t n = first; n < end; ++n) {
+            off_t offset = (off_t)sizeof(header) + (off_t)(n * sizeof(result_record_t));
+            if (pread(g_results_fd, &record, sizeof(record), offset) != (ssize_t)sizeof(record)) {
+                if (fprintf(stderr, "Error: Cannot read '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+                return -1; // Descriptors are closed by cleanup_resources
+            }
+            add_record_to_block(&g_results_block, &record);
+        }
+        if (block < full_blocks) {
+            if (write(g_results_index_fd, &g_results_block, sizeof(g_results_block)) != (ssize_t)sizeof(g_results_block)) {
+                if (fprintf(stderr, "Error: Cannot write '%s' (errno %d: %s).\r\n", index_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+                return -1;
+            }
+        }
+    }
+    return 0;
+
+    fail:
+    for (int i = 0; i < 2; ++i) {
+        if (fds[i] != -1) {
+            close(fds[i]);
+        }
+    }
+    return -1;
+}
+
+/*
+ * read_results_header
+ *
+ * Reads and validates the header of a results or index file. Each kind
+ * has its own magic, so an index passed as the results file (or the other
+ * way round) is refused.
+ *
+ * Accepts:
+ *   fd - Open file
+ *   path - File name for messages
+ *   magic - RESULTS_MAGIC or RESULTS_INDEX_MAGIC
+ *   record_size - Expected entry size
+ *
+ * Returns:
+ *   0 if the header matches this build, -1 otherwise (prints error message).
+ */
+static int read_results_header(int fd, const char *path, const char *magic, uint32_t record_size) {
+    results_header_t header;
+
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+        if (fprintf(stderr, "Error: '%s' is too short to be a results file.\r\n", path) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.version != RESULTS_VERSION || header.record_size != record_size ||
+        header.block_records != RESULTS_BLOCK_RECORDS || header.byte_order != RESULTS_BYTE_ORDER) {
+        if (fprintf(stderr, "Error: '%s' has an unknown format or was written by an incompatible build.\r\n", path) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * reset_results_block
+ *
+ * Starts a new, empty summary in g_results_block.
+ *
+ * Accepts:
+ *   first_record - Number of the block's first record
+ *
+ * Returns: None
+ */
+static void reset_results_block(uint64_t first_record) {
+    memset(&g_results_block, 0, sizeof(g_results_block));
+    g_results_block.first_record = first_record;
+    g_results_block.value_min = INT32_MAX;
+    g_results_block.value_max = INT32_MIN;
+    g_results_block.finished_min_ns = INT64_MAX;
+    g_results_block.finished_max_ns = INT64_MIN;
+}
+
+/*
+ * add_record_to_block
+ *
+ * Extends a block summary with one record.
+ *
+ * Accepts:
+ *   block - Summary to update
+ *   record - Record to add
+ *
+ * Returns: None
+ */
+static void add_record_to_block(results_block_t *block, const result_record_t *record) {
+    if (record->policy >= 0 && record->policy < 32) {
+        block->policy_mask |= 1U << record->policy;
+    }
+    if (record->policy_value < block->value_min) {
+        block->value_min = record->policy_value;
+    }
+    if (record->policy_value > block->value_max) {
+        block->value_max = record->policy_value;
+    }
+    if (record->finished_ns < block->finished_min_ns) {
+        block->finished_min_ns = record->finished_ns;
+    }
+    if (record->finished_ns > block->finished_max_ns) {
+        block->finished_max_ns = record->finished_ns;
+    }
+    add_record_to_totals(&block->totals, record);
+}
+
+/*
+ * add_record_to_totals
+ *
+ * Accepts:
+ *   totals - Sums to update
+ *   record - Record to add
+ *
+ * Returns: None
+ */
+static void add_record_to_totals(results_totals_t *totals, const result_record_t *record) {
+    totals->records++;
+    if (record->flags & RESULT_COMPLETE) {
+        totals->complete++;
+    }
+    totals->repetitions += record->repetitions;
+    for (int i = 0; i < 4; ++i) {
+        totals->counts[i] += record->counts[i];
+    }
+    totals->lifetime_ns += record->lifetime_ns;
+    totals->startup_ns += record->startup_ns;
+    totals->cpu_us += record->utime_us + record->stime_us;
+    if (record->maxrss_kb > totals->maxrss_kb_max) {
+        totals->maxrss_kb_max = record->maxrss_kb;
+    }
+}
+
+/*
+ * merge_totals
+ *
+ * Accepts:
+ *   into - Sums to update
+ *   from - Sums to add
+ *
+ * Returns: None
+ */
+static void merge_totals(results_totals_t *into, const results_totals_t *from) {
+    into->records += from->records;
+    into->complete += from->complete;
+    into->repetitions += from->repetitions;
+    for (int i = 0; i < 4; ++i) {
+        into->counts[i] += from->counts[i];
+    }
+    into->lifetime_ns += from->lifetime_ns;
+    into->startup_ns += from->startup_ns;
+    into->cpu_us += from->cpu_us;
+    if (from->maxrss_kb_max > into->maxrss_kb_max) {
+        into->maxrss_kb_max = from->maxrss_kb_max;
+    }
+}
+
+/*
+ * append_child_result
+ *
+ * Appends the record of a reaped child to the results store (if enabled):
+ * parameters, counters from its last checkpoint, timings and resource
+ * usage. The record goes out in one write() on an O_APPEND descriptor.
+ * Completing a block appends its summary to the index.
+ *
+ * Accepts:
+ *   child - Registry entry (exit_ns already set)
+ *   status - Wait status
+ *   usage - Resource usage reported by wait4()
+ *
+ * Returns: None
+ */
+static void append_child_result(const child_entry_t *child, int status, const struct rusage *usage) {
+    result_record_t record;
+    checkpoint_data_t data;
+    struct timespec now;
+
+    if (g_results_fd == -1) {
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    clock_gettime(CLOCK_REALTIME, &now);
+    record.finished_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    record.lifetime_ns = child->exit_ns - child->spawn_ns;
+    record.startup_ns = (child->ready_ns != 0) ? child->ready_ns - child->spawn_ns : 0;
+    if (read_child_checkpoint(child, &data) == 0) {
+        record.repetitions = data.repetitions;
+        for (int i = 0; i < 4; ++i) {
+            record.counts[i] = data.counts[i];
+        }
+        if (data.reason == CHECKPOINT_FINAL) {
+            record.flags |= RESULT_COMPLETE;
+        }
+    }
+    record.resumed_reps = child->resumed_reps;
+    record.duration_ms = (uint32_t)(child->duration_s * 1000.0 + 0.5);
+    if (child->resumed_reps > 0) {
+        record.flags |= RESULT_RESUMED;
+    }
+    record.utime_us = (int64_t)usage->ru_utime.tv_sec * 1000000LL + usage->ru_utime.tv_usec;
+    record.stime_us = (int64_t)usage->ru_stime.tv_sec * 1000000LL + usage->ru_stime.tv_usec;
+    record.maxrss_kb = usage->ru_maxrss;
+    record.nvcsw = usage->ru_nvcsw;
+    record.nivcsw = usage->ru_nivcsw;
+    record.pid = child->pid;
+    record.policy = child->sched.policy;
+    record.policy_value = child->sched.value;
+    record.exit_status = status;
+    write_result_record(&record);
+}
+
+/*
+ * append_worker_result
+ *
+ * Appends the record of a joined thread worker (-T) to the results store
+ * (if enabled), as append_child_result() does for a child: its TID stands
+ * for the PID, the resource usage is the thread's own and the exit status
+ * is that of a child killed by SIGTERM if the worker was stopped early.
+ *
+ * Accepts:
+ *   worker - Joined worker
+ *   data - Its last checkpoint
+ *
+ * Returns: None
+ */
+static void append_worker_result(const worker_t *worker, const checkpoint_data_t *data) {
+    result_record_t record;
+    struct timespec now;
+
+    if (g_results_fd == -1) {
+        return;
+    }
+    memset(&record, 0, sizeof(record));
+    clock_gettime(CLOCK_REALTIME, &now);
+    record.finished_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    record.lifetime_ns = worker->end_ns - worker->spawn_ns;
+    record.startup_ns = worker->start_ns - worker->spawn_ns;
+    record.repetitions = data->repetitions;
+    for (int i = 0; i < 4; ++i) {
+        record.counts[i] = data->counts[i];
+    }
+    record.flags = RESULT_THREAD;
+    if (data->reason == CHECKPOINT_FINAL) {
+        record.flags |= RESULT_COMPLETE;
+    }
+    record.resumed_reps = worker->resumed_reps;
+    if (worker->resumed_reps > 0) {
+        record.flags |= RESULT_RESUMED;
+    }
+    record.duration_ms = (uint32_t)(g_run_duration_s * 1000.0 + 0.5);
+    record.utime_us = (int64_t)worker->usage.ru_utime.tv_sec * 1000000LL + worker->usage.ru_utime.tv_usec;
+    record.stime_us = (int64_t)worker->usage.ru_stime.tv_sec * 1000000LL + worker->usage.ru_stime.tv_usec;
+    record.maxrss_kb = worker->usage.ru_maxrss; // The whole parent's
+    record.nvcsw = worker->usage.ru_nvcsw;
+    record.nivcsw = worker->usage.ru_nivcsw;
+    record.pid = atomic_load_explicit(&worker->tid, memory_order_relaxed);
+    record.policy = SCHED_OTHER; // Workers run under the parent's policy
+    record.exit_status = (data->reason == CHECKPOINT_FINAL) ? 0 : SIGTERM;
+    write_result_record(&record);
+}
+
+/*
+ * write_result_record
+ *
+ * Appends one record to the results store in a single write() on the
+ * O_APPEND descriptor and adds it to the summary of the block being
+ * filled. Completing a block appends its summary to the index.
+ *
+ * Accepts:
+ *   record - Record to append
+ *
+ * Returns: None
+ */
+static void write_result_record(const result_record_t *record) {
+    if (write(g_results_fd, record, sizeof(*record)) != (ssize_t)sizeof(*record)) {
+        if (fprintf(stderr, "PARENT [%d]: Error: Failed to append result of PID %d (errno %d: %s).\r\n",
+            getpid(), (int)record->pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return;
+    }
+    g_results_records++;
+    add_record_to_block(&g_results_block, record);
+
+    if (g_results_block.totals.records == RESULTS_BLOCK_RECORDS) {
+        if (g_results_index_fd != -1 &&
+            write(g_results_index_fd, &g_results_block, sizeof(g_results_block)) != (ssize_t)sizeof(g_results_block)) {
+            // Stop indexing so later entries cannot land at the wrong position;
+            // the missing entries are rebuilt the next time the store is opened
+            if (fprintf(stderr, "PARENT [%d]: Warning: Failed to write results index (errno %d: %s).\r\n",
+                getpid(), errno, strerror(errno)) < 0) { /* Handle error? */ }
+            close(g_results_index_fd);
+            g_results_index_fd = -1;
+        }
+        reset_results_block(g_results_records);
+    }
+}
+
+/*
+ * parse_results_query
+ *
+ * Parses a comma-separated query: policy=NAME[:VALUE], pid=PID,
+ * from=UNIX_SECONDS, to=UNIX_SECONDS, status=complete|partial,
+ * group=policy. "all" (or an empty query) matches every record.
+ *
+ * Accepts:
+ *   text - Query text
+ *   query - Output
+ *
+ * Returns:
+ *   0 on success, -1 on a malformed query (prints error message).
+ */
+static int parse_results_query(const char *text, results_query_t *query) {
+    char buf[256];
+
+    memset(query, 0, sizeof(*query));
+    query->from_ns = INT64_MIN;
+    query->to_ns = INT64_MAX;
+    if (strlen(text) >= sizeof(buf)) {
+        if (fprintf(stderr, "Error: Query is too long.\r\n") < 0) { /* Handle error? */ }
+        return -1;
+    }
+    strcpy(buf, text);
+
+    char *saveptr = NULL;
+    for (char *term = strtok_r(buf, ",", &saveptr); term != NULL; term = strtok_r(NULL, ",", &saveptr)) {
+        char *value = strchr(term, '=');
+        if (strcmp(term, "all") == 0) {
+            continue;
+        }
+        if (value == NULL) {
+            goto bad_term;
+        }
+        *value++ = '\0';
+        if (strcmp(term, "policy") == 0) {
+            if (parse_sched_spec(value, &query->policy) != 0) {
+                goto bad_term;
+            }
+            query->has_policy = 1;
+            query->match_value = (strchr(value, ':') != NULL);
+        } else if (strcmp(term, "pid") == 0) {
+            char *end = NULL;
+            errno = 0;
+            long pid = strtol(value, &end, 10);
+            if (errno != 0 || end == value || *end != '\0' || pid <= 0 || pid > INT_MAX) {
+                goto bad_term;
+            }
+            query->pid = (pid_t)pid;
+        } else if (strcmp(term, "from") == 0 || strcmp(term, "to") == 0) {
+            char *end = NULL;
+            errno = 0;
+            double seconds = strtod(value, &end);
+            // Rejects NaN too; the bound keeps seconds * 1e9 within int64_t
+            if (errno != 0 || end == value || *end != '\0' || !(seconds >= 0.0 && seconds < (double)INT64_MAX / 1e9)) {
+                goto bad_term;
+            }
+            if (term[0] == 'f') {
+                query->from_ns = (int64_t)(seconds * 1e9);
+            } else {
+                query->to_ns = (int64_t)(seconds * 1e9);
+            }
+        } else if (strcmp(term, "status") == 0) {
+            if (strcmp(value, "complete") == 0) {
+                query->status = 1;
+            } else if (strcmp(value, "partial") == 0) {
+                query->status = 2;
+            } else {
+                goto bad_term;
+            }
+        } else if (strcmp(term, "group") == 0 && strcmp(value, "policy") == 0) {
+            query->group_by_policy = 1;
+        } else {
+            goto bad_term;
+        }
+        continue;
+
+        bad_term:
+        if (fprintf(stderr, "Error: Invalid query term '%s'.\r\n", term) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * record_matches_query
+ *
+ * Accepts:
+ *   record - Record to test
+ *   query - Parsed query
+ *
+ * Returns: 1 if the record passes every filter, 0 otherwise.
+ */
+static int record_matches_query(const result_record_t *record, const results_query_t *query) {
+    if (query->has_policy && (record->policy != query->policy.policy ||
+        (query->match_value && record->policy_value != query->policy.value))) {
+        return 0;
+    }
+    if (query->pid != 0 && record->pid != query->pid) {
+        return 0;
+    }
+    if (record->finished_ns < query->from_ns || record->finished_ns > query->to_ns) {
+        return 0;
+    }
+    if ((query->status == 1 && !(record->flags & RESULT_COMPLETE)) ||
+        (query->status == 2 && (record->flags & RESULT_COMPLETE))) {
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * block_query_overlap
+ *
+ * Decides from an index entry alone how a block relates to a query.
+ * Grouping by policy needs a single policy and value per block to use the
+ * summary.
+ *
+ * Accepts:
+ *   block - Index entry
+ *   query - Parsed query
+ *
+ * Returns:
+ *   0 if no record can match, 1 if every record matches (the summary can
+ *   be used), 2 if the records must be scanned.
+ */
+static int block_query_overlap(const results_block_t *block, const results_query_t *query) {
+    int all = 1;
+
+    if (block->finished_max_ns < query->from_ns || block->finished_min_ns > query->to_ns) {
+        return 0;
+    }
+    if (block->finished_min_ns < query->from_ns || block->finished_max_ns > query->to_ns) {
+        all = 0;
+    }
+    if (query->has_policy) {
+        uint32_t bit = 1U << query->policy.policy;
+        if (!(block->policy_mask & bit) ||
+            (query->match_value && (query->policy.value < block->value_min || query->policy.value > block->value_max))) {
+            return 0;
+        }
+        if (block->policy_mask != bit || (query->match_value && block->value_min != block->value_max)) {
+            all = 0;
+        }
+    }
+    if (query->status == 1 && block->totals.complete == 0) {
+        return 0;
+    }
+    if (query->status == 2 && block->totals.complete == block->totals.records) {
+        return 0;
+    }
+    if (query->status != 0 && block->totals.complete != 0 && block->totals.complete != block->totals.records) {
+        all = 0;
+    }
+    if (query->pid != 0) {
+        all = 0; // PIDs are not summarized
+    }
+    if (query->group_by_policy && ((block->policy_mask & (block->policy_mask - 1)) != 0 || block->value_min != block->value_max)) {
+        all = 0;
+    }
+    return all ? 1 : 2;
+}
+
+/*
+ * run_results_query
+ *
+ * Query mode: filters and aggregates the results store. Index entries
+ * decide per block whether it can be skipped, taken from its summary, or
+ * must be read (one pread per block); records after the last indexed block
+ * are always read. Prints per-group and overall runs, repetitions, torn
+ * rate, mean lifetime, startup latency and CPU time, and peak RSS.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int run_results_query(void) {
+    results_query_t query;
+    char index_path[MAX_PATH_LEN];
+    struct stat st;
+    sched_spec_t group_keys[QUERY_MAX_GROUPS];
+    results_totals_t group_totals[QUERY_MAX_GROUPS];
+    size_t group_count = 0;
+    results_totals_t overall;
+    unsigned long long blocks_skipped = 0, blocks_summarized = 0, blocks_scanned = 0, records_read = 0;
+    result_record_t *records = NULL;
+    results_block_t *index = NULL;
+    uint64_t index_count = 0;
+    int result = -1;
+    int fd = -1;
+
+    if (parse_results_query(g_query_text, &query) != 0) {
+        return -1;
+    }
+    memset(&overall, 0, sizeof(overall));
+    memset(group_totals, 0, sizeof(group_totals));
+
+    fd = open(g_results_path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        if (fprintf(stderr, "Error: Cannot open '%s' (errno %d: %s).\r\n", g_results_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        goto done;
+    }
+    if (read_results_header(fd, g_results_path, RESULTS_MAGIC, sizeof(result_record_t)) != 0) {
+        goto done;
+    }
+    uint64_t record_count = (uint64_t)(st.st_size - (off_t)sizeof(results_header_t)) / sizeof(result_record_t);
+
+    // A missing or unreadable index only makes the query slower
+    snprintf(index_path, sizeof(index_path), "%s%s", g_results_path, RESULTS_INDEX_SUFFIX);
+    int index_fd = open(index_path, O_RDONLY | O_CLOEXEC);
+    if (index_fd != -1) {
+        struct stat index_st;
+        if (fstat(index_fd, &index_st) == 0 && read_results_header(index_fd, index_path, RESULTS_INDEX_MAGIC, sizeof(results_block_t)) == 0) {
+            index_count = (uint64_t)(index_st.st_size - (off_t)sizeof(results_header_t)) / sizeof(results_block_t);
+            if (index_count > record_count / RESULTS_BLOCK_RECORDS) {
+                index_count = record_count / RESULTS_BLOCK_RECORDS;
+            }
+            index = malloc((index_count > 0 ? index_count : 1) * sizeof(results_block_t));
+            if (index == NULL || pread(index_fd, index, index_count * sizeof(results_block_t), sizeof(results_header_t)) !=
+                (ssize_t)(index_count * sizeof(results_block_t))) {
+                index_count = 0;
+            }
+        }
+        close(index_fd);
+    }
+
+    records = malloc(RESULTS_BLOCK_RECORDS * sizeof(result_record_t));
+    if (records == NULL) {
+        perror("Error: Failed to allocate query buffer");
+        goto done;
+    }
+
+    for (uint64_t first = 0; first < record_count; first += RESULTS_BLOCK_RECORDS) {
+        uint64_t block = first / RESULTS_BLOCK_RECORDS;
+        uint64_t count = (record_count - first < RESULTS_BLOCK_RECORDS) ? record_count - first : RESULTS_BLOCK_RECORDS;
+        int overlap = (block < index_count) ? block_query_overlap(&index[block], &query) : 2;
+
+        if (overlap == 0) {
+            blocks_skipped++;
+            continue;
+        }
+        if (overlap == 1) {
+            blocks_summarized++;
+            merge_totals(&overall, &index[block].totals);
+            if (query.group_by_policy) {
+                sched_spec_t key;
+                key.policy = 31 - __builtin_clz(index[block].policy_mask);
+                key.value = index[block].value_min;
+                size_t g = 0;
+                while (g < group_count && (group_keys[g].policy != key.policy || group_keys[g].value != key.value)) {
+                    g++;
+                }
+                if (g == group_count && group_count < QUERY_MAX_GROUPS) {
+                    group_keys[group_count++] = key;
+                }
+                if (g < group_count) {
+                    merge_totals(&group_totals[g], &index[block].totals);
+                }
+            }
+            continue;
+        }
+
+        blocks_scanned++;
+        off_t offset = (off_t)sizeof(results_header_t) + (off_t)(first * sizeof(result_record_t));
+        if (pread(fd, records, count * sizeof(result_record_t), offset) != (ssize_t)(count * sizeof(result_record_t))) {
+            if (fprintf(stderr, "Error: Cannot read '%s' (errno %d: %s).\r\n", g_results_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            goto done;
+        }
+        records_read += count;
+        for (uint64_t i = 0; i < count; ++i) {
+            if (!record_matches_query(&records[i], &query)) {
+                continue;
+            }
+            add_record_to_totals(&overall, &records[i]);
+            if (query.group_by_policy) {
+                size_t g = 0;
+                while (g < group_count && (group_keys[g].policy != records[i].policy || group_keys[g].value != records[i].policy_value)) {
+                    g++;
+                }
+                if (g == group_count && group_count < QUERY_MAX_GROUPS) {
+                    group_keys[group_count].policy = records[i].policy;
+                    group_keys[group_count].value = records[i].policy_value;
+                    group_count++;
+                }
+                if (g < group_count) {
+                    add_record_to_totals(&group_totals[g], &records[i]);
+                }
+            }
+        }
+    }
+
+    if (printf("Query '%s' over %llu records: %llu blocks from the index, %llu skipped, %llu scanned (%llu records read).\n",
+        g_query_text, (unsigned long long)record_count, blocks_summarized, blocks_skipped, blocks_scanned, records_read) < 0) { /* Handle error? */ }
+    if (printf("%-12s %10s %9s %14s %9s %12s %12s %10s %10s\n", "GROUP", "RUNS", "COMPLETE", "REPS", "TORN%",
+        "LIFETIME_MS", "STARTUP_US", "CPU_MS", "MAXRSS_KB") < 0) { /* Handle error? */ }
+    for (size_t g = 0; g <= group_count; ++g) {
+        const results_totals_t *totals = (g < group_count) ? &group_totals[g] : &overall;
+        char label[SCHED_NAME_LEN];
+        double runs = (totals->records > 0) ? (double)totals->records : 1.0;
+
+        if (g < group_count) {
+            format_sched_spec(&group_keys[g], label, sizeof(label));
+        } else {
+            snprintf(label, sizeof(label), "all");
+        }
+        if (printf("%-12s %10llu %9llu %14lld %9.3f %12.2f %12.1f %10.2f %10lld\n", label,
+            (unsigned long long)totals->records, (unsigned long long)totals->complete, (long long)totals->repetitions,
+            (totals->repetitions > 0) ? 100.0 * (double)(totals->counts[1] + totals->counts[2]) / (double)totals->repetitions : 0.0,
+            (double)totals->lifetime_ns / runs / 1e6, (double)totals->startup_ns / runs / 1e3,
+            (double)totals->cpu_us / runs / 1e3, (long long)totals->maxrss_kb_max) < 0) { /* Handle error? */ }
+    }
+    if (group_count == QUERY_MAX_GROUPS) {
+        if (printf("(only the first %d groups are listed)\n", QUERY_MAX_GROUPS) < 0) { /* Handle error? */ }
+    }
+    result = 0;
+
+    done:
+    free(records);
+    free(index);
+    if (fd != -1) {
+        close(fd);
+    }
+    return result;
+}
+
+/*
+ * add_ab_value
+ *
+ * Adds one observation to a running mean and variance (Welford's method,
+ * numerically stable over millions of runs).
+ *
+ * Accepts:
+ *   metric - Accumulator
+ *   value - Observation
+ *
+ * Returns: None
+ */
+static void add_ab_value(ab_metric_t *metric, double value) {
+    metric->n++;
+    double delta = value - metric->mean;
+    metric->mean += delta / (double)metric->n;
+    metric->m2 += delta * (value - metric->mean);
+}
+
+/*
+ * collect_ab_sample
+ *
+ * Reads a whole results store in chunks and accumulates the per-run
+ * metrics of the records matching the query: torn rate (runs with at
+ * least one repetition), throughput in repetitions per second of lifetime,
+ * and spawn latency (runs whose execv() was confirmed).
+ *
+ * Accepts:
+ *   path - Results file
+ *   query - Filter applied to every record
+ *   metrics - Output, AB_METRIC_COUNT accumulators in g_ab_metrics order
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int collect_ab_sample(const char *path, const results_query_t *query, ab_metric_t *metrics) {
+    struct stat st;
+    int result = -1;
+
+    memset(metrics, 0, AB_METRIC_COUNT * sizeof(*metrics));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        if (fprintf(stderr, "Error: Cannot open '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    result_record_t *records = malloc(QUERY_CHUNK_RECORDS * sizeof(result_record_t));
+    if (records == NULL) {
+        perror("Error: Failed to allocate comparison buffer");
+        close(fd);
+        return -1;
+    }
+    if (read_results_header(fd, path, RESULTS_MAGIC, sizeof(result_record_t)) != 0) {
+        goto done;
+    }
+
+    uint64_t record_count = (uint64_t)(st.st_size - (off_t)sizeof(results_header_t)) / sizeof(result_record_t);
+    for (uint64_t first = 0; first < record_count; first += QUERY_CHUNK_RECORDS) {
+        uint64_t count = (record_count - first < QUERY_CHUNK_RECORDS) ? record_count - first : QUERY_CHUNK_RECORDS;
+        off_t offset = (off_t)sizeof(results_header_t) + (off_t)(first * sizeof(result_record_t));
+        if (pread(fd, records, count * sizeof(result_record_t), offset) != (ssize_t)(count * sizeof(result_record_t))) {
+            if (fprintf(stderr, "Error: Cannot read '%s' (errno %d: %s).\r\n", path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            goto done;
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            const result_record_t *record = &records[i];
+            if (!record_matches_query(record, query)) {
+                continue;
+            }
+            // Resumed runs only did part of their repetitions in this lifetime
+            int64_t reps_here = record->repetitions - record->resumed_reps;
+            if (record->repetitions > 0) {
+                add_ab_value(&metrics[0], 100.0 * (double)(record->counts[1] + record->counts[2]) / (double)record->repetitions);
+            }
+            if (reps_here > 0 && record->lifetime_ns > 0) {
+                add_ab_value(&metrics[1], (double)reps_here * 1e9 / (double)record->lifetime_ns);
+            }
+            if (record->startup_ns > 0) {
+                add_ab_value(&metrics[2], (double)record->startup_ns / 1e3);
+            }
+        }
+    }
+    result = 0;
+
+    done:
+    free(records);
+    close(fd);
+    return result;
+}
+
+/*
+ * incomplete_beta
+ *
+ * Regularized incomplete beta function I_x(a, b), evaluated with the
+ * continued fraction (modified Lentz) on whichever side converges.
+ *
+ * Accepts:
+ *   a, b - Shape parameters (> 0)
+ *   x - Point in [0, 1]
+ *
+ * Returns: I_x(a, b).
+ */
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    if (x >= 1.0) {
+        return 1.0;
+    }
+    if (x > (a + 1.0) / (a + b + 2.0)) {
+        return 1.0 - incomplete_beta(b, a, 1.0 - x);
+    }
+
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x)) / a;
+    double f = 1.0, c = 1.0, d = 0.0;
+    for (int i = 0; i <= 400; ++i) {
+        int m = i / 2;
+        double numerator;
+        if (i == 0) {
+            numerator = 1.0;
+        } else if (i % 2 == 0) {
+            numerator = (m * (b - m) * x) / ((a + 2.0 * m - 1.0) * (a + 2.0 * m));
+        } else {
+            numerator = -((a + m) * (a + b + m) * x) / ((a + 2.0 * m) * (a + 2.0 * m + 1.0));
+        }
+        d = 1.0 + numerator * d;
+        d = (fabs(d) < 1e-30) ? 1e-30 : d;
+        d = 1.0 / d;
+        c = 1.0 + numerator / c;
+        c = (fabs(c) < 1e-30) ? 1e-30 : c;
+        double step = c * d;
+        f *= step;
+        if (fabs(1.0 - step) < 1e-12) {
+            break;
+        }
+    }
+    return front * (f - 1.0);
+}
+
+/*
+ * student_t_two_sided_p
+ *
+ * Accepts:
+ *   t - Test statistic
+ *   df - Degrees of freedom (may be fractional)
+ *
+ * Returns: P(|T| >= |t|) for Student's t with df degrees of freedom.
+ */
+static double student_t_two_sided_p(double t, double df) {
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+/*
+ * student_t_critical
+ *
+ * Finds the two-sided critical value for AB_ALPHA by bisection.
+ *
+ * Accepts:
+ *   df - Degrees of freedom
+ *
+ * Returns: t such that P(|T| >= t) = AB_ALPHA.
+ */
+static double student_t_critical(double df) {
+    double low = 0.0, high = 1000.0;
+    for (int i = 0; i < 100; ++i) {
+        double mid = (low + high) / 2.0;
+        if (student_t_two_sided_p(mid, df) > AB_ALPHA) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+/*
+ * run_ab_comparison
+ *
+ * Comparison mode (-A BASE -B CANDIDATE): treats every matching run in each
+ * store as one observation and, per metric, reports both means, the
+ * difference with its 95% confidence interval (Welch), Hedges' g and the
+ * two-sided p-value of Welch's t-test. A difference is a regression when it
+ * is significant at AB_ALPHA and points in the metric's worse direction.
+ *
+ * Accepts: None
+ * Returns:
+ *   EXIT_SUCCESS if no metric regressed significantly, AB_EXIT_REGRESSION
+ *   if one did, EXIT_FAILURE if the stores could not be read.
+ */
+static int run_ab_comparison(void) {
+    results_query_t query;
+    ab_metric_t base[AB_METRIC_COUNT];
+    ab_metric_t candidate[AB_METRIC_COUNT];
+    int regressions = 0;
+
+    if (parse_results_query((g_query_text != NULL) ? g_query_text : "all", &query) != 0) {
+        return EXIT_FAILURE;
+    }
+    if (query.group_by_policy) {
+        if (fprintf(stderr, "Error: group=policy is not supported in comparisons; filter with policy= instead.\r\n") < 0) { /* Handle error? */ }
+        return EXIT_FAILURE;
+    }
+    if (collect_ab_sample(g_compare_base, &query, base) != 0 ||
+        collect_ab_sample(g_compare_candidate, &query, candidate) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    if (printf("A/B comparison: A = %s, B = %s%s%s\n", g_compare_base, g_compare_candidate,
+        (g_query_text != NULL) ? ", query " : "", (g_query_text != NULL) ? g_query_text : "") < 0) { /* Handle error? */ }
+    if (printf("%-14s %-7s %8s %12s %8s %12s %12s %25s %8s %10s\n", "METRIC", "UNIT", "N(A)", "MEAN(A)", "N(B)", "MEAN(B)",
+        "B-A", "95% CI", "HEDGES_G", "P") < 0) { /* Handle error? */ }
+
+    for (int m = 0; m < AB_METRIC_COUNT; ++m) {
+        const ab_metric_t *a = &base[m];
+        const ab_metric_t *b = &candidate[m];
+        if (a->n < 2 || b->n < 2) {
+            if (printf("%-14s %-7s %8llu %12s %8llu %12s   (need at least 2 runs on each side)\n", g_ab_metrics[m].name,
+                g_ab_metrics[m].unit, (unsigned long long)a->n, "-", (unsigned long long)b->n, "-") < 0) { /* Handle error? */ }
+            continue;
+        }
+
+        double var_a = a->m2 / (double)(a->n - 1);
+        double var_b = b->m2 / (double)(b->n - 1);
+        double se_a = var_a / (double)a->n;
+        double se_b = var_b / (double)b->n;
+        double se = sqrt(se_a + se_b);
+        double diff = b->mean - a->mean;
+        double pooled = sqrt(((double)(a->n - 1) * var_a + (double)(b->n - 1) * var_b) / (double)(a->n + b->n - 2));
+        double correction = 1.0 - 3.0 / (4.0 * (double)(a->n + b->n) - 9.0);
+        double g = (pooled > 0.0) ? diff / pooled * correction : 0.0;
+        double p, half_width;
+
+        if (se > 0.0) {
+            double df = (se_a + se_b) * (se_a + se_b) /
+                (se_a * se_a / (double)(a->n - 1) + se_b * se_b / (double)(b->n - 1));
+            p = student_t_two_sided_p(diff / se, df);
+            half_width = student_t_critical(df) * se;
+        } else {
+            p = (diff == 0.0) ? 1.0 : 0.0; // No spread at all: any difference is exact
+            half_width = 0.0;
+        }
+
+        int significant = (p < AB_ALPHA);
+        int regressed = significant && diff * g_ab_metrics[m].worse_sign > 0.0;
+        char interval[64];
+        snprintf(interval, sizeof(interval), "[%.4g, %.4g]", diff - half_width, diff + half_width);
+        if (printf("%-14s %-7s %8llu %12.4g %8llu %12.4g %+12.4g %25s %+8.3f %10.3g%s\n", g_ab_metrics[m].name,
+            g_ab_metrics[m].unit, (unsigned long long)a->n, a->mean, (unsigned long long)b->n, b->mean, diff, interval, g, p,
+            regressed ? "  REGRESSION" : (significant ? "  improved" : "")) < 0) { /* Handle error? */ }
+        regressions += regressed;
+    }
+
+    if (printf("%d significant regression%s at the %.0f%% level.\n", regressions, (regressions == 1) ? "" : "s",
+        100.0 * (1.0 - AB_ALPHA)) < 0) { /* Handle error? */ }
+    return (regressions > 0) ? AB_EXIT_REGRESSION : EXIT_SUCCESS;
+}
+
+/*
+ * kill_all_children
+ *
+ * Kills all live (STARTING or RUNNING) child processes as '-' does (SIGTERM,
+ * then SIGKILL after KILL_GRACE_NS), and sends SIGKILL to tracked
+ * descendants (-O), which must not outlive the fleet either. Killed
+ * children move to SIGNALED and stay tracked until reaped.
+ * Prints actions to stderr.
+ *
+ * Accepts:
+ *   reason - A string indicating why children are being killed (for logging).
+ *
+ * Returns: None
+ */
+static void kill_all_children(const char *reason) {
+    pid_t parent_pid = getpid();
+    size_t live_count = live_child_count();
+
+    if (g_state_counts[CHILD_STATE_DESCENDANT] > 0) {
+        size_t descendants_killed = 0;
+        for (size_t i = 0; i < g_child_count; ++i) {
+            child_entry_t *child = &g_children[i];
+            if (child->state == CHILD_STATE_DESCENDANT && signal_child(child, SIGKILL, NULL) == 0) {
+                child->last_signal = SIGKILL;
+                set_child_state(child, CHILD_STATE_SIGNALED);
+                descendants_killed++;
+            }
+        }
+        if (fprintf(stderr, "PARENT [%d]: Killed %zu descendants of the children (%s).\r\n", parent_pid, descendants_killed, reason) < 0) { /* Handle error? */ }
+    }
+    if (live_count == 0) {
+        // Only print "No children to kill" if not part of the standard exit cleanup.
+        if (strcmp(reason, "Parent exiting.") != 0) {
+            if (printf("PARENT [%d]: No children to kill.\r\n", parent_pid) < 0) { /* Handle error? */ }
+        }
+        return;
+    }
+
+    // Use stderr for operational messages like killing children
+    if (fprintf(stderr, "PARENT [%d]: Killing all %zu children (%s).\r\n", parent_pid, live_count, reason) < 0) { /* Handle error? */ }
+    if (fflush(stderr) == EOF) { /* Handle error? */ }
+
+    // Iterate backwards because kill_child_at_index may remove entries
+    size_t failed_count = 0;
+    for (size_t i = g_child_count; i > 0; --i) {
+        if (is_child_live(&g_children[i - 1]) && kill_child_at_index(i - 1) < 0) {
+            failed_count++;
+        }
+        // No explicit waitpid here; reap_children() is responsible for reaping.
+        // If we waitpid here, it could block or skew the reap latency metrics.
+    }
+
+    if (failed_count == 0) {
+        if (fprintf(stderr, "PARENT [%d]: All tracked children processed for killing.\r\n", parent_pid) < 0) { /* Handle error? */ }
+    } else {
+        if (fprintf(stderr, "PARENT [%d]: Processed children for killing. %zu children could not be signaled (should be rare).\r\n", parent_pid, failed_count) < 0) { /* Handle error? */ }
+    }
+    if (fflush(stderr) == EOF) { /* Handle error? */ }
+}
+
+/*
+ * reap_killed_children
+ *
+ * Waits (up to EXIT_REAP_TIMEOUT_NS) for the children killed on exit,
+ * escalating to SIGKILL for those that outlive their SIGTERM, and reaps them, so their results and checkpoints are collected from their
+ * final counters, not from slots they may still be writing. Descendants
+ * (-O) not adopted by the parent are reaped by their own parents and are
+ * not waited for.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void reap_killed_children(void) {
+    long long deadline_ns = monotonic_ns() + EXIT_REAP_TIMEOUT_NS;
+
+    for (;;) {
+        reap_children();
+        size_t waiting = 0;
+        for (size_t i = 0; i < g_child_count; ++i) {
+            if (!g_children[i].descendant || g_children[i].adopted) {
+                waiting++;
+            }
+        }
+        long long now_ns = monotonic_ns();
+        if (waiting == 0 || now_ns >= deadline_ns) {
+            if (waiting > 0) {
+                if (fprintf(stderr, "PARENT [%d]: Warning: %zu killed children were not reaped in time; their checkpoints may be stale.\r\n",
+                    getpid(), waiting) < 0) { /* Handle error? */ }
+            }
+            return;
+        }
+        escalate_kills();
+        struct pollfd pfd = { .fd = g_sigchld_pipe[0], .events = POLLIN, .revents = 0 };
+        if (poll(&pfd, 1, kill_timeout_ms((int)((deadline_ns - now_ns + 999999LL) / 1000000LL))) == -1 && errno != EINTR) {
+            return;
+        }
+    }
+}
+
+/*
+ * signal_all_children
+ *
+ * Sends the specified signal (SIGUSR1 or SIGUSR2) to all live children and
+ * records it as their last signal. Reports actions to stdout/stderr.
+ * Does NOT remove children on ESRCH here, as reap_children() removes
+ * exited children from the registry.
+ *
+ * Accepts:
+ *   sig - The signal number to send (SIGUSR1 or SIGUSR2).
+ *
+ * Returns:
+ *   Number of children the signal could not be sent to for reasons other
+ *   than ESRCH (0 if all sends succeeded or there were no children).
+ */
+static int signal_all_children(int sig) {
+    pid_t parent_pid = getpid();
+    const char *sig_name = (sig == SIGUSR1) ? "SIGUSR1 (enable output)" : "SIGUSR2 (disable output)";
+
+    size_t live_count = live_child_count();
+
+    if (live_count == 0) {
+        if (!g_quiet_ops && printf("PARENT [%d]: No children to send %s to.\r\n", parent_pid, sig_name) < 0) { /* Handle error? */ }
+        return 0;
+    }
+
+    // Use stderr for operational messages
+    if (!g_quiet_ops) {
+        if (fprintf(stderr, "PARENT [%d]: Sending %s to all %zu children.\r\n", parent_pid, sig_name, live_count) < 0) { /* Handle error? */ }
+        if (fflush(stderr) == EOF) { /* Handle error? */ }
+    }
+
+    size_t signaled_count = 0;
+    size_t esrch_count = 0; // Count children that were already gone
+    int failed_count = 0;
+    for (size_t i = 0; i < g_child_count; ++i) {
+        if (!is_child_live(&g_children[i])) {
+            continue;
+        }
+        pid_t child_pid = g_children[i].pid;
+        if (signal_child(&g_children[i], sig, NULL) == 0) {
+            g_children[i].last_signal = sig;
+            signaled_count++;
+        } else {
+            if (errno == ESRCH) { // Process does not exist
+                esrch_count++;
+                // Don't remove from g_children here; reap_children() will handle it
+                // once the exit has been reaped.
+                if (!g_quiet_ops && fprintf(stderr, "PARENT [%d]: Child PID %d for %s already exited (ESRCH).\r\n", parent_pid, child_pid, sig_name) < 0) { /* Handle error? */ }
+
+            } else { // Other error
+                failed_count++;
+                if (fprintf(stderr, "Warning: Failed to send %s to PID %d (errno %d: %s).\r\n",
+                    sig_name, child_pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            }
+        }
+    }
+
+    // Use printf for user-facing summary
+    if (!g_quiet_ops && printf("PARENT [%d]: Attempted to send %s to %zu children. Success: %zu, Already Exited (ESRCH): %zu.\r\n",
+        parent_pid, sig_name, live_count, signaled_count, esrch_count) < 0) { /* Handle error? */ }
+    return failed_count;
+}
+
+/*
+ * queue_command_to_children
+ *
+ * Queues a command (see child_command.h) to all live children with
+ * sigqueue(). Unlike the SIGUSR1/SIGUSR2 broadcasts, repeated commands are
+ * not merged by the kernel; a child whose signal queue is full (EAGAIN)
+ * misses this one command. Children still starting get it once they have
+ * installed their handler.
+ *
+ * Accepts:
+ *   command - child_command_t value
+ *   arg - Command argument
+ *   description - What the command does, for messages
+ *
+ * Returns:
+ *   Number of children the command could not be queued to for reasons
+ *   other than ESRCH.
+ */
+static int queue_command_to_children(int command, int arg, const char *description) {
+    pid_t parent_pid = getpid();
+    size_t live_count = live_child_count();
+    union sigval value;
+
+    if (live_count == 0) {
+        if (!g_quiet_ops && printf("PARENT [%d]: No children to send a %s to.\r\n", parent_pid, description) < 0) { /* Handle error? */ }
+        return 0;
+    }
+
+    value.sival_int = child_command_encode(command, arg);
+    size_t queued_count = 0;
+    size_t esrch_count = 0;
+    size_t full_count = 0; // Signal queue of the child exhausted
+    int failed_count = 0;
+    for (size_t i = 0; i < g_child_count; ++i) {
+        if (!is_child_live(&g_children[i])) {
+            continue;
+        }
+        pid_t child_pid = g_children[i].pid;
+        if (signal_child(&g_children[i], CHILD_COMMAND_SIGNAL, &value) == 0) {
+            g_children[i].last_signal = CHILD_COMMAND_SIGNAL;
+            queued_count++;
+        } else if (errno == ESRCH) { // reap_children() removes it once reaped
+            esrch_count++;
+        } else if (errno == EAGAIN) {
+            full_count++;
+            failed_count++;
+        } else {
+            failed_count++;
+            if (fprintf(stderr, "Warning: Failed to queue a %s to PID %d (errno %d: %s).\r\n",
+                description, child_pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        }
+    }
+
+    if (!g_quiet_ops && printf("PARENT [%d]: Queued a %s (signal RTMIN+%d, payload 0x%08x) to %zu of %zu children. Already exited: %zu, queue full: %zu.\r\n",
+        parent_pid, description, CHILD_COMMAND_SIGNAL - SIGRTMIN, (unsigned)value.sival_int,
+        queued_count, live_count, esrch_count, full_count) < 0) { /* Handle error? */ }
+    return failed_count;
+}
+
+/*
+ * pause_all_children
+ *
+ * Stops every live child that is not paused yet with SIGSTOP. Each child's
+ * stats slot is marked paused first, so the external sampler (-e) does not
+ * count the frozen pair. Children spawned while the fleet is paused run
+ * until the next 'p'.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void pause_all_children(void) {
+    pid_t parent_pid = getpid();
+    long long now_ns = monotonic_ns();
+    size_t paused_count = 0;
+    size_t already_paused = 0;
+
+    for (size_t i = 0; i < g_child_count; ++i) {
+        child_entry_t *child = &g_children[i];
+        if (!is_child_live(child)) {
+            continue;
+        }
+        if (child->paused_ns != 0) {
+            already_paused++;
+            continue;
+        }
+        if (child->slot >= 0) {
+            g_stats_slots[child->slot].paused = 1;
+        }
+        if (signal_child(child, SIGSTOP, NULL) == -1) {
+            if (child->slot >= 0) {
+                g_stats_slots[child->slot].paused = 0;
+            }
+            if (errno != ESRCH && fprintf(stderr, "Warning: Failed to send SIGSTOP to PID %d (errno %d: %s).\r\n",
+                child->pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+            continue;
+        }
+        child->paused_ns = now_ns;
+        child->last_signal = SIGSTOP;
+        paused_count++;
+    }
+    if (paused_count > 0) {
+        g_pause_count++;
+        if (g_fleet_paused_ns == 0) {
+            g_fleet_paused_ns = now_ns;
+        }
+        g_dashboard_valid = 0;
+    }
+    if (!g_quiet_ops && printf("PARENT [%d]: Paused %zu children (SIGSTOP); %zu were already paused. 'c' continues them.\r\n",
+        parent_pid, paused_count, already_paused) < 0) { /* Handle error? */ }
+}
+
+/*
+ * resume_all_children
+ *
+ * Continues every paused child. Before its SIGCONT, each child is queued a
+ * CHILD_COMMAND_PAUSED report with the time it was stopped, delivered as
+ * soon as it runs again: the child leaves that time out of its interval
+ * statistics, extends a time-boxed run by it and clears its slot's paused
+ * mark. If the report cannot be queued, the parent clears the mark itself.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void resume_all_children(void) {
+    pid_t parent_pid = getpid();
+    long long now_ns = monotonic_ns();
+    size_t resumed_count = 0;
+    size_t unreported = 0; // Children whose pause report could not be queued
+
+    for (size_t i = 0; i < g_child_count; ++i) {
+        child_entry_t *child = &g_children[i];
+        if (child->paused_ns == 0) {
+            continue;
+        }
+        long long paused_ns = now_ns - child->paused_ns;
+        long long paused_ms = paused_ns / 1000000LL;
+        int reported = 1;
+        do { // Pauses longer than the 24-bit argument take several reports
+            long long chunk_ms = (paused_ms > CHILD_COMMAND_ARG_MASK) ? CHILD_COMMAND_ARG_MASK : paused_ms;
+            union sigval value;
+            value.sival_int = child_command_encode(CHILD_COMMAND_PAUSED, (int)chunk_ms);
+            if (signal_child(child, CHILD_COMMAND_SIGNAL, &value) == -1) {
+                reported = 0;
+                break;
+            }
+            paused_ms -= chunk_ms;
+        } while (paused_ms > 0);
+        if (!reported) {
+            unreported++;
+            if (child->slot >= 0) {
+                g_stats_slots[child->slot].paused = 0;
+            }
+        }
+        // A killed child was paused until it died; SIGCONT is harmless for it
+        if (signal_child(child, SIGCONT, NULL) == -1 && errno != ESRCH) {
+            if (fprintf(stderr, "Warning: Failed to send SIGCONT to PID %d (errno %d: %s).\r\n",
+                child->pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        }
+        child->paused_total_ns += paused_ns;
+        child->paused_ns = 0;
+        if (is_child_live(child)) {
+            child->last_signal = SIGCONT;
+        }
+        resumed_count++;
+    }
+    if (g_fleet_paused_ns != 0) {
+        g_fleet_paused_total_ns += now_ns - g_fleet_paused_ns;
+        g_fleet_paused_ns = 0;
+        g_dashboard_valid = 0;
+    }
+    if (!g_quiet_ops) {
+        if (printf("PARENT [%d]: Continued %zu children (SIGCONT).\r\n", parent_pid, resumed_count) < 0) { /* Handle error? */ }
+        if (unreported > 0 && fprintf(stderr, "PARENT [%d]: Warning: %zu children could not be told their paused time; it stays in their statistics.\r\n",
+            parent_pid, unreported) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * open_spawn_cgroup
+ *
+ * Opens the cgroup v2 directory given with -C for CLONE_INTO_CGROUP, and
+ * its cgroup.procs for children that have to be forked instead. Opening
+ * cgroup.procs for writing also checks that we may move processes there.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int open_spawn_cgroup(void) {
+    struct statfs fs;
+    char procs_path[MAX_PATH_LEN];
+
+    g_cgroup_fd = open(g_cgroup_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (g_cgroup_fd == -1) {
+        if (fprintf(stderr, "Error: Cannot open cgroup directory '%s' (errno %d: %s).\r\n", g_cgroup_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (fstatfs(g_cgroup_fd, &fs) == -1 || fs.f_type != CGROUP2_SUPER_MAGIC) {
+        if (fprintf(stderr, "Error: '%s' is not a cgroup v2 directory.\r\n", g_cgroup_path) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    int len = snprintf(procs_path, sizeof(procs_path), "%s/cgroup.procs", g_cgroup_path);
+    if (len < 0 || (size_t)len >= sizeof(procs_path)) {
+        if (fprintf(stderr, "Error: cgroup path '%s' is too long.\r\n", g_cgroup_path) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    g_cgroup_procs_fd = open(procs_path, O_WRONLY | O_CLOEXEC);
+    if (g_cgroup_procs_fd == -1) {
+        if (fprintf(stderr, "Error: Cannot open '%s' for writing (errno %d: %s).\r\n", procs_path, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (printf("Children start in cgroup %s\r\n", g_cgroup_path) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * clone_child
+ *
+ * Creates the child process with clone3(), which also returns a pidfd for
+ * it and, with -C, starts it in the spawn cgroup, both atomically with its
+ * creation. If the kernel lacks clone3() (or the CLONE_INTO_CGROUP
+ * extension), falls back to fork() for this and all later spawns; the
+ * child then joins the cgroup itself before execv(). Like fork(), the
+ * raw clone3() call returns 0 in the child, which only prepares execv()
+ * (glibc's fork handlers do not run).
+ *
+ * Accepts:
+ *   pidfd - Output: pidfd of the child, -1 if it was forked
+ *
+ * Returns:
+ *   Child PID in the parent, 0 in the child, -1 on failure (errno set).
+ */
+static pid_t clone_child(int *pidfd) {
+    *pidfd = -1;
+    if (g_clone3_available) {
+        struct clone_args args;
+        memset(&args, 0, sizeof(args));
+        args.flags = CLONE_PIDFD;
+        args.pidfd = (uint64_t)(uintptr_t)pidfd; // pidfds are close-on-exec
+        args.exit_signal = SIGCHLD;
+        if (g_cgroup_fd != -1) {
+            args.flags |= CLONE_INTO_CGROUP;
+            args.cgroup = (uint64_t)g_cgroup_fd;
+        }
+        long pid = syscall(SYS_clone3, &args, sizeof(args));
+        if (pid != -1 || (errno != ENOSYS && errno != E2BIG)) {
+            return (pid_t)pid;
+        }
+        g_clone3_available = 0;
+        *pidfd = -1;
+        if (fprintf(stderr, "PARENT [%d]: Warning: clone3() is not available (errno %d: %s); spawning with fork().\r\n",
+            getpid(), errno, strerror(errno)) < 0) { /* Handle error? */ }
+    }
+    return fork();
+}
+
+/*
+ * signal_child
+ *
+ * Sends a signal to a tracked child, through its pidfd if it has one (a
+ * pidfd always refers to this child, whatever happens to its PID).
+ *
+ * Accepts:
+ *   child - Registry entry
+ *   sig - Signal number
+ *   value - Payload to queue with the signal (as sigqueue()), or NULL
+ *
+ * Returns:
+ *   0 on success, -1 on failure (errno set, ESRCH if the child has exited).
+ */
+static int signal_child(const child_entry_t *child, int sig, const union sigval *value) {
+    TRACE_PROBE3(signal_send, child->pid, sig, (value != NULL) ? value->sival_int : 0);
+    if (child->pidfd == -1) {
+        return (value != NULL) ? sigqueue(child->pid, sig, *value) : kill(child->pid, sig);
+    }
+    if (value == NULL) {
+        return (int)syscall(SYS_pidfd_send_signal, child->pidfd, sig, NULL, 0);
+    }
+    siginfo_t info; // What sigqueue() would fill in
+    memset(&info, 0, sizeof(info));
+    info.si_signo = sig;
+    info.si_code = SI_QUEUE;
+    info.si_pid = getpid();
+    info.si_uid = getuid();
+    info.si_value = *value;
+    return (int)syscall(SYS_pidfd_send_signal, child->pidfd, sig, &info, 0);
+}
+
+/*
+ * open_worker_pipe
+ *
+ * Creates the pipe on which finished thread workers post their pointer.
+ * The read end is polled by the main loop; the write end blocks, so a
+ * worker waits rather than getting lost if the main loop falls behind.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int open_worker_pipe(void) {
+    if (pipe(g_worker_pipe) == -1 ||
+        fcntl(g_worker_pipe[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(g_worker_pipe[1], F_SETFD, FD_CLOEXEC) == -1 ||
+        fcntl(g_worker_pipe[0], F_SETFL, O_NONBLOCK) == -1) {
+        if (fprintf(stderr, "Error: Failed to create the worker pipe (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = handle_worker_timer;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    if (sigaction(WORKER_TIMER_SIGNAL, &sa, NULL) == -1) {
+        if (fprintf(stderr, "Error: Failed to set the worker timer handler (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (printf("'+' starts thread workers (stack %d KiB, %d us timer, %d reps)\r\n",
+        WORKER_STACK_SIZE / 1024, WORKER_INTERVAL_US, WORKER_REPETITIONS) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * start_worker
+ *
+ * Starts a thread worker. All signals are blocked while the thread is
+ * created, so it inherits a full mask: process-directed signals (SIGCHLD,
+ * SIGINT, ...) keep going to the main thread, and the worker unblocks only
+ * its own timer signal.
+ *
+ * Accepts:
+ *   resume - Partial result whose counters the worker continues from
+ *     ('r'), or NULL for a fresh run
+ *
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int start_worker(const checkpoint_data_t *resume) {
+    if (g_worker_count == g_worker_capacity) {
+        size_t new_capacity = (g_worker_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_worker_capacity * 2;
+        worker_t **grown = realloc(g_workers, new_capacity * sizeof(*grown));
+        if (grown == NULL) {
+            perror("PARENT: Error growing the worker registry");
+            return -1;
+        }
+        g_workers = grown;
+        g_worker_capacity = new_capacity;
+    }
+
+    worker_t *worker = aligned_alloc(STATS_SLOT_ALIGN, sizeof(worker_t)); // sizeof is a multiple of the alignment
+    if (worker == NULL) {
+        perror("PARENT: Error allocating a thread worker");
+        return -1;
+    }
+    memset(worker, 0, sizeof(*worker));
+    worker->stats.total_reps = (g_run_duration_s > 0.0) ? 0 : WORKER_REPETITIONS;
+    if (resume != NULL) {
+        worker->stats.repetitions = resume->repetitions;
+        for (int i = 0; i < 4; ++i) {
+            worker->stats.counts[i] = resume->counts[i];
+        }
+        worker->resumed_reps = resume->repetitions;
+    }
+    atomic_init(&worker->stop, 0);
+    atomic_init(&worker->interval_us, WORKER_INTERVAL_US);
+    atomic_init(&worker->output_enabled, 1);
+    atomic_init(&worker->tid, 0);
+    worker->id = ++g_worker_next_id;
+    worker->spawn_ns = monotonic_ns();
+    if (g_run_duration_s > 0.0) {
+        worker->deadline_ns = worker->spawn_ns + (long long)(g_run_duration_s * 1e9);
+        worker->stats.deadline_ns = worker->deadline_ns;
+    }
 
-    // Configure local flags:
-    // Disable ECHO (characters not echoed back)
-    // Disable ICANON (canonical mode, no line buffering)
-    // Disable IEXTEN (implementation-defined input processing)
-    // **KEEP ISIG ENABLED** so Ctrl+C, Ctrl+\, etc., generate signals.
-    raw.c_lflag &= ~(unsigned long)(ECHO | ICANON | IEXTEN);
-    // If you wanted to disable ISIG, it would be:
-    // raw.c_lflag &= ~(unsigned long)(ECHO | ICANON | IEXTEN | ISIG);
+    pthread_attr_t attr;
+    sigset_t all_signals, saved_mask;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WORKER_STACK_SIZE);
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &saved_mask);
+    int error = pthread_create(&worker->thread, &attr, run_worker, worker);
+    pthread_sigmask(SIG_SETMASK, &saved_mask, NULL);
+    pthread_attr_destroy(&attr);
+    if (error != 0) {
+        if (fprintf(stderr, "Error: Failed to start a thread worker (errno %d: %s).\r\n", error, strerror(error)) < 0) { /* Handle error? */ }
+        free(worker);
+        return -1;
+    }
 
-    // Control characters for non-canonical mode
-    raw.c_cc[VMIN] = 1;  // read() blocks until at least 1 byte is available
-    raw.c_cc[VTIME] = 0; // No timeout for read()
+    worker->index = g_worker_count;
+    g_workers[g_worker_count++] = worker;
+    g_workers_started++;
+    g_worker_start_total_ns += monotonic_ns() - worker->spawn_ns;
+    if (!g_quiet_ops) {
+        if (printf("PARENT [%d]: Started thread worker %d. Live workers: %zu\r\n", getpid(), worker->id, g_worker_count) < 0) { /* Handle error? */ }
+    }
+    return 0;
+}
 
-    if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == -1) {
-        perror("Error: tcsetattr failed to enable raw mode");
-        // Attempt to restore original settings if possible, though unlikely to succeed if setattr failed.
-        // tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_orig_termios); // This might also fail.
-        // atexit handler will attempt to restore, but it's best effort.
-        exit(EXIT_FAILURE);
+/*
+ * run_worker
+ *
+ * Body of a thread worker: the child's workload. It alternates its pair
+ * between {0,0} and {1,1} until the timer handler flags a sample, re-arms
+ * its one-shot per-thread timer (SIGEV_THREAD_ID, so the signal interrupts
+ * this thread and no other) and repeats until the run is complete or it
+ * is stopped. Then it writes its final checkpoint and posts itself on the
+ * worker pipe for the main loop to join.
+ *
+ * Accepts:
+ *   arg - The worker_t
+ *
+ * Returns: NULL
+ */
+static void *run_worker(void *arg) {
+    worker_t *worker = arg;
+    struct sigevent event;
+    timer_t timer;
+    sigset_t timer_mask;
+    int current_state = 0;
+
+    atomic_store_explicit(&worker->tid, (int)gettid(), memory_order_relaxed);
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = WORKER_TIMER_SIGNAL;
+    event.sigev_value.sival_ptr = worker;
+    event.sigev_notify_thread_id = gettid();
+    sigemptyset(&timer_mask);
+    sigaddset(&timer_mask, WORKER_TIMER_SIGNAL);
+
+    worker->start_ns = monotonic_ns();
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer) == -1) {
+        worker->error = errno;
+    } else {
+        pthread_sigmask(SIG_UNBLOCK, &timer_mask, NULL);
+        while (!worker_finished(worker)) {
+            struct itimerspec arm;
+            memset(&arm, 0, sizeof(arm));
+            arm.it_value.tv_nsec = (long)atomic_load_explicit(&worker->interval_us, memory_order_relaxed) * 1000L;
+            worker->alarm_flag = 0;
+            if (timer_settime(timer, 0, &arm, NULL) == -1) {
+                worker->error = errno;
+                break;
+            }
+            while (!worker->alarm_flag) {
+                if (current_state == 0) {
+                    worker->pair[0] = 0;
+                    worker->pair[1] = 0;
+                    current_state = 1;
+                } else {
+                    worker->pair[0] = 1;
+                    worker->pair[1] = 1;
+                    current_state = 0;
+                }
+            }
+        }
+        pthread_sigmask(SIG_BLOCK, &timer_mask, NULL); // A signal still pending dies with the thread
+        timer_delete(timer);
+    }
+    worker->end_ns = monotonic_ns();
+    getrusage(RUSAGE_THREAD, &worker->usage);
+
+    checkpoint_data_t data;
+    data.reason = atomic_load_explicit(&worker->stop, memory_order_relaxed) ? CHECKPOINT_SIGTERM : CHECKPOINT_FINAL;
+    data.repetitions = worker->stats.repetitions;
+    for (int i = 0; i < 4; ++i) {
+        data.counts[i] = worker->stats.counts[i];
     }
+    stats_checkpoint_write(&worker->stats, &data);
+
+    while (write(g_worker_pipe[1], &worker, sizeof(worker)) == -1 && errno == EINTR) {
+        // A pointer is written atomically (less than PIPE_BUF)
+    }
+    return NULL;
 }
 
 /*
- * disable_raw_mode
+ * handle_worker_timer
  *
- * Restores the terminal settings for stdin to their original state.
- * Ensures cursor is on a new line. Uses safe_write for output.
+ * Handler for WORKER_TIMER_SIGNAL, run on the worker thread whose timer
+ * expired (the worker comes with the signal). Classifies the pair and
+ * updates the worker's counters and checkpoints exactly as the child's
+ * SIGALRM handler does. Async-signal-safe.
+ *
+ * Accepts:
+ *   sig - The signal number (expected: WORKER_TIMER_SIGNAL)
+ *   info - Carries the worker_t in si_value
+ *   context - Unused
  *
- * Accepts: None
  * Returns: None
  */
-static void disable_raw_mode(void) {
-    // Only attempt to restore if stdin is a TTY and g_orig_termios has been populated
-    if (!isatty(STDIN_FILENO)) {
+static void handle_worker_timer(int sig, siginfo_t *info, void *context) {
+    worker_t *worker = info->si_value.sival_ptr;
+
+    (void)sig;
+    (void)context;
+    if (info->si_code != SI_TIMER || worker == NULL) {
         return;
     }
+    int state = (worker->pair[0] != 0) * 2 + (worker->pair[1] != 0);
+    worker->stats.counts[state]++;
+    worker->stats.repetitions++;
+    if (worker->stats.repetitions % CHECKPOINT_INTERVAL == 0) {
+        checkpoint_data_t data;
+        data.reason = CHECKPOINT_PERIODIC;
+        data.repetitions = worker->stats.repetitions;
+        for (int i = 0; i < 4; ++i) {
+            data.counts[i] = worker->stats.counts[i];
+        }
+        stats_checkpoint_write(&worker->stats, &data);
+    }
+    worker->alarm_flag = 1;
+}
 
-    // Check if g_orig_termios seems initialized (not all zeros, which is its state after memset)
-    // This is a basic check; a more robust way would be a flag set after successful tcgetattr.
-    int is_orig_termios_set = 0;
-    for (size_t i = 0; i < sizeof(g_orig_termios.c_cc); ++i) {
-        if (g_orig_termios.c_cc[i] != 0) { is_orig_termios_set = 1; break; }
+/*
+ * worker_finished
+ *
+ * Accepts:
+ *   worker - Worker to check (called on its own thread)
+ *
+ * Returns: 1 once the worker was stopped, its deadline passed (-t) or it
+ *          completed WORKER_REPETITIONS, 0 otherwise.
+ */
+static int worker_finished(worker_t *worker) {
+    if (atomic_load_explicit(&worker->stop, memory_order_relaxed)) {
+        return 1;
     }
-    if (!is_orig_termios_set && g_orig_termios.c_iflag == 0 &&
-        g_orig_termios.c_oflag == 0 && g_orig_termios.c_cflag == 0 &&
-        g_orig_termios.c_lflag == 0) {
-        // g_orig_termios appears to be uninitialized or all zeros, possibly tcgetattr failed
-        // or was never called. Avoid restoring with potentially invalid settings.
-        const char msg[] = "Warning: Original terminal attributes not available for restoration or were all zero.\r\n";
-    safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
-        } else {
-            if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &g_orig_termios) == -1) {
-                // Use a simple message for async-signal safety if this were called from a signal handler
-                // (though atexit is not a signal handler context).
-                const char msg[] = "Warning: Failed to restore terminal attributes.\r\n";
-                safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
+    if (worker->deadline_ns != 0) {
+        return monotonic_ns() >= worker->deadline_ns;
+    }
+    return worker->stats.repetitions >= WORKER_REPETITIONS;
+}
+
+/*
+ * stop_worker
+ *
+ * Asks a worker to stop; it does so at its next sample and is joined by
+ * service_workers() like a worker that completed.
+ *
+ * Accepts:
+ *   worker - Worker to stop
+ *
+ * Returns: None
+ */
+static void stop_worker(worker_t *worker) {
+    atomic_store_explicit(&worker->stop, 1, memory_order_relaxed);
+}
+
+/*
+ * stop_last_worker
+ *
+ * Stops the most recently started worker that is not stopping yet ('-').
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void stop_last_worker(void) {
+    for (size_t i = g_worker_count; i > 0; --i) {
+        worker_t *worker = g_workers[i - 1];
+        if (!atomic_load_explicit(&worker->stop, memory_order_relaxed)) {
+            stop_worker(worker);
+            if (!g_quiet_ops) {
+                if (fprintf(stderr, "PARENT [%d]: Stopping thread worker %d.\r\n", getpid(), worker->id) < 0) { /* Handle error? */ }
             }
+            return;
         }
+    }
+    if (printf("PARENT [%d]: No thread workers to stop.\r\n", getpid()) < 0) { /* Handle error? */ }
+}
 
-        // Ensure the cursor is at the beginning of a new line after exiting raw mode.
-        // This is important because the application might have left the cursor anywhere.
-        safe_write(STDOUT_FILENO, "\r\n", 2);
-        fflush(stdout); // Try to flush any buffered output
+/*
+ * stop_all_workers
+ *
+ * Stops every worker. At exit (reason NULL) it also waits for them and
+ * collects their results, so partial results can still be saved. Workers
+ * are collected through the pipe as they finish: joining them in another
+ * order could wait on a worker blocked on a full pipe.
+ *
+ * Accepts:
+ *   reason - Message prefix, or NULL when the parent exits
+ *
+ * Returns: None
+ */
+static void stop_all_workers(const char *reason) {
+    if (g_worker_count == 0) {
+        return;
+    }
+    for (size_t i = 0; i < g_worker_count; ++i) {
+        stop_worker(g_workers[i]);
+    }
+    if (reason != NULL) {
+        if (fprintf(stderr, "PARENT [%d]: %s Stopping all %zu thread workers.\r\n", getpid(), reason, g_worker_count) < 0) { /* Handle error? */ }
+        return;
+    }
+    int flags = fcntl(g_worker_pipe[0], F_GETFL);
+    if (flags != -1) {
+        fcntl(g_worker_pipe[0], F_SETFL, flags & ~O_NONBLOCK);
+    }
+    for (size_t remaining = g_worker_count; remaining > 0; ) {
+        worker_t *worker;
+        ssize_t n = read(g_worker_pipe[0], &worker, sizeof(worker));
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n != (ssize_t)sizeof(worker)) {
+            perror("PARENT: Error collecting thread workers");
+            break;
+        }
+        pthread_join(worker->thread, NULL);
+        finish_worker(worker);
+        remaining--;
+    }
+    compact_workers();
 }
 
 /*
- * cleanup_resources
+ * service_workers
  *
- * Frees allocated memory, kills remaining children, and restores terminal mode.
- * Intended to be registered with atexit(). Uses stderr for messages via safe_write.
+ * Joins the workers posted on the worker pipe and collects their results,
+ * then compacts the registry once for the whole batch.
  *
  * Accepts: None
  * Returns: None
  */
-static void cleanup_resources(void) {
-    // disable_raw_mode must be called first to ensure subsequent messages are seen correctly.
-    disable_raw_mode();
-
-    pid_t pid = getpid(); // Safe to call getpid()
-    char msg_buf[128];
-    int len;
+static void service_workers(void) {
+    worker_t *posted[64];
+    ssize_t n;
 
-    // Using snprintf and safe_write for messages from atexit handler
-    len = snprintf(msg_buf, sizeof(msg_buf), "PARENT [%d]: Cleaning up...\r\n", pid);
-    if (len > 0 && (size_t)len < sizeof(msg_buf)) {
-        safe_write(STDERR_FILENO, msg_buf, (size_t)len);
+    while ((n = read(g_worker_pipe[0], posted, sizeof(posted))) > 0) {
+        for (size_t i = 0; i < (size_t)n / sizeof(posted[0]); ++i) {
+            pthread_join(posted[i]->thread, NULL);
+            finish_worker(posted[i]);
+        }
     }
+    compact_workers();
+}
 
-    kill_all_children("Parent exiting.");
+/*
+ * finish_worker
+ *
+ * Handles a joined worker: prints its statistics line (the child's format,
+ * with the thread ID for the PID) if output is enabled, adds its final
+ * counters to the completed totals or keeps a stopped worker's counters as
+ * a partial result, appends its record to the results store (-o) and
+ * clears its registry entry (compact_workers() closes the gap).
+ *
+ * Accepts:
+ *   worker - Joined worker
+ *
+ * Returns: None
+ */
+static void finish_worker(worker_t *worker) {
+    checkpoint_data_t data;
+    long long elapsed_us = (worker->end_ns - worker->start_ns) / 1000;
+    int tid = atomic_load_explicit(&worker->tid, memory_order_relaxed);
 
-    if (g_child_pids != NULL) {
-        free(g_child_pids);
-        g_child_pids = NULL; // Important to prevent double-free if cleanup is somehow called again
-        g_child_count = 0;
-        g_child_capacity = 0;
+    if (worker->error != 0) {
+        if (fprintf(stderr, "PARENT [%d]: Thread worker %d failed to run its timer (errno %d: %s).\r\n",
+            getpid(), worker->id, worker->error, strerror(worker->error)) < 0) { /* Handle error? */ }
+    }
+    if (stats_checkpoint_read(&worker->stats, &data) == 0 && data.repetitions > 0) {
+        if (atomic_load_explicit(&worker->output_enabled, memory_order_relaxed)) {
+            if (printf("PPID=%d, TID=%d, STATS={00:%lld, 01:%lld, 10:%lld, 11:%lld}, SCHED=thread, ELAPSED_US=%lld, MEAN_INTERVAL_US=%.1f\r\n",
+                getpid(), tid, (long long)data.counts[0], (long long)data.counts[1], (long long)data.counts[2], (long long)data.counts[3],
+                elapsed_us, (double)elapsed_us / (double)data.repetitions) < 0) { /* Handle error? */ }
+        }
+        if (data.reason == CHECKPOINT_FINAL) {
+            g_completed.children++;
+            g_completed.repetitions += data.repetitions;
+            for (int i = 0; i < 4; ++i) {
+                g_completed.counts[i] += data.counts[i];
+            }
+        } else {
+            sched_spec_t sched = { SCHED_OTHER, 0 };
+            add_partial_result((pid_t)tid, &sched, &data);
+        }
+        append_worker_result(worker, &data);
+    } else {
+        g_checkpoints_lost++;
     }
 
-    len = snprintf(msg_buf, sizeof(msg_buf), "PARENT [%d]: Cleanup complete.\r\n", pid);
-    if (len > 0 && (size_t)len < sizeof(msg_buf)) {
-        safe_write(STDERR_FILENO, msg_buf, (size_t)len);
+    g_workers[worker->index] = NULL;
+    free(worker);
+}
+
+/*
+ * compact_workers
+ *
+ * Removes the entries cleared by finish_worker() from g_workers, keeping
+ * the remaining workers in start order. One pass for any number of
+ * finished workers, so stopping a large fleet stays linear.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void compact_workers(void) {
+    size_t kept = 0;
+
+    for (size_t i = 0; i < g_worker_count; ++i) {
+        if (g_workers[i] != NULL) {
+            g_workers[i]->index = kept;
+            g_workers[kept++] = g_workers[i];
+        }
     }
-    fflush(stderr); // Try to flush stderr
+    g_worker_count = kept;
 }
 
 /*
- * handle_signal
+ * set_workers_output
  *
- * Signal handler for SIGINT, SIGTERM, SIGQUIT (sets termination flag)
- * and SIGCHLD (reaps zombies). Async-signal-safe.
- * IMPORTANT: This handler only reaps zombies; it does NOT update g_child_pids list here
- * as modifying complex data structures in signal handlers is unsafe.
+ * Enables or disables the statistics line of every live worker ('1'/'2').
  *
  * Accepts:
- *   sig - The signal number received.
+ *   enabled - 1 to enable, 0 to disable
  *
  * Returns: None
  */
-static void handle_signal(int sig) {
-    int saved_errno = errno; // Preserve errno
+static void set_workers_output(int enabled) {
+    for (size_t i = 0; i < g_worker_count; ++i) {
+        atomic_store_explicit(&g_workers[i]->output_enabled, enabled, memory_order_relaxed);
+    }
+    if (g_worker_count > 0 && !g_quiet_ops) {
+        if (printf("PARENT [%d]: Output %s for %zu thread workers.\r\n", getpid(), enabled ? "enabled" : "disabled", g_worker_count) < 0) { /* Handle error? */ }
+    }
+}
+
+/*
+ * spawn_initial_fleet
+ *
+ * Starts g_initial_spawns children, or thread workers with -T, before the
+ * main loop reads any command (-N), and reports how long that took.
+ * Per-spawn messages are suppressed.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void spawn_initial_fleet(void) {
+    long long started_ns = monotonic_ns();
+    size_t spawned = 0;
+    int saved_quiet = g_quiet_ops;
+
+    g_quiet_ops = 1;
+    for (size_t i = 0; i < g_initial_spawns; ++i) {
+        if ((g_thread_workers ? start_worker(NULL) : spawn_child()) != 0) {
+            break;
+        }
+        spawned++;
+    }
+    g_quiet_ops = saved_quiet;
+
+    double elapsed_ms = (double)(monotonic_ns() - started_ns) / 1e6;
+    struct rusage usage;
+    long max_rss_kb = (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss : 0;
+    if (printf("PARENT [%d]: Started %zu of %zu %s in %.1f ms (%.1f us each); parent max RSS %.1f MiB.\r\n",
+        getpid(), spawned, g_initial_spawns, g_thread_workers ? "thread workers" : "children", elapsed_ms,
+        (spawned > 0) ? elapsed_ms * 1e3 / (double)spawned : 0.0, (double)max_rss_kb / 1024.0) < 0) { /* Handle error? */ }
+    if (fflush(stdout) == EOF) { /* Handle error? */ }
+}
 
-    if (sig == SIGCHLD) {
-        pid_t child_pid;
-        // Reap all available zombie children non-blockingly
-        while ((child_pid = waitpid(-1, NULL, WNOHANG)) > 0) {
-            // Optionally, log that a child was reaped.
-            // For this lab, the main purpose is to prevent zombies.
-            // The g_child_pids list is not updated here for signal safety.
-            // It will be updated during operations like kill_last_child or kill_all_children
-            // when they encounter ESRCH.
-        }
-        // ECHILD means no more children to wait for, which is not an error in this loop.
-        // Other errors from waitpid in a SIGCHLD handler are unusual but could be logged.
-        if (child_pid == -1 && errno != ECHILD) {
-            const char msg[] = "PARENT: Error in waitpid (SIGCHLD handler).\r\n";
+/*
+ * exec_child
+ *
+ * Runs in a newly created child (forked or cloned by the parent, or by the
+ * spawn helper): makes the stderr pipe its stderr, restores the default
+ * signal dispositions, applies the scheduling policy and execs the child
+ * program with the arguments for its slot, run length and resume point.
+ * Its creator blocks SIGTERM (and the other signals reset here) across the
+ * creation; the mask set here releases them to the default actions, so a
+ * kill that arrives before execv() ends the child instead of running the
+ * creator's handler.
+ * If execv() fails, the errno goes to the exec-status pipe. Never returns.
+ *
+ * Accepts:
+ *   spec - What the child runs with
+ *   cgroup_procs_fd - cgroup.procs to join first (a child forked without
+ *                     clone3() under -C), -1 otherwise
+ *
+ * Returns: Does not return
+ */
+static void exec_child(const child_exec_t *spec, int cgroup_procs_fd) {
+    if (dup2(spec->err_fd, STDERR_FILENO) == -1) {
+        _exit(EXIT_FAILURE); // Nowhere to report it
+    }
+    close(spec->err_fd);
+    if (cgroup_procs_fd != -1) {
+        if (write(cgroup_procs_fd, "0", 1) == -1) {
+            const char msg[] = "CHILD: Warning: Cannot join the spawn cgroup.\r\n";
             safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
         }
-    } else if (sig == SIGINT || sig == SIGTERM || sig == SIGQUIT) {
-        // Set the flag that the main loop will check.
-        g_terminate_flag = 1;
+    }
 
-        // Output a message. This must be async-signal-safe.
-        // Using safe_write directly.
-        const char msg[] = "\r\nPARENT: Termination signal received, initiating shutdown...\r\n";
-        safe_write(STDERR_FILENO, msg, sizeof(msg) - 1);
-        // Note: The main loop will detect g_terminate_flag and exit,
-        // then atexit handler (cleanup_resources) will run.
+    // Child-specific setup:
+    // 1. Restore default signal handlers for signals parent might ignore or handle differently.
+    //    The parent's raw mode setup (termios) is NOT inherited across execv.
+    //    The child will have default terminal settings unless it changes them.
+    struct sigaction sa_dfl;
+    memset(&sa_dfl, 0, sizeof(sa_dfl));
+    sa_dfl.sa_handler = SIG_DFL; // Default action
+    sigaction(SIGINT, &sa_dfl, NULL);  // Child should terminate on SIGINT by default
+    sigaction(SIGTERM, &sa_dfl, NULL); // Child should terminate on SIGTERM by default
+    sigaction(SIGQUIT, &sa_dfl, NULL); // Child should terminate and dump core on SIGQUIT
+    // SIGCHLD is irrelevant for the child itself to handle this way.
+    // SIGUSR1, SIGUSR2 will be set up by the child_main.
+    // Commands stay queued (the mask survives execv()) until the child has its handler;
+    // the default action of a real-time signal would terminate it.
+    // The mask is set outright: whatever its creator had blocked must not outlive execv().
+    sigset_t command_mask;
+    sigemptyset(&command_mask);
+    sigaddset(&command_mask, CHILD_COMMAND_SIGNAL);
+    sigprocmask(SIG_SETMASK, &command_mask, NULL);
+
+    // Apply the configured scheduling policy; it survives execv().
+    apply_sched_spec(&spec->sched);
+
+    // 2. The child does not need to (and should not) try to restore parent's g_orig_termios.
+    //    The terminal settings are per-process (more accurately, per controlling terminal session,
+    //    but execv resets many process attributes).
+
+    // The stats region is close-on-exec; F_DUPFD gives the child a copy that survives execv()
+    char fd_arg[16];
+    char slot_arg[16];
+    char resume_arg[128];
+    char sampler_arg[16];
+    char duration_arg[32];
+    char rounds_arg[16];
+    char *child_argv[16];
+    int child_argc = 0;
+    int slot_fd = (spec->stats_fd != -1) ? fcntl(spec->stats_fd, F_DUPFD, STDERR_FILENO + 1) : -1;
+
+    child_argv[child_argc++] = g_child_exec_path;
+    if (slot_fd != -1) {
+        snprintf(fd_arg, sizeof(fd_arg), "%d", slot_fd);
+        snprintf(slot_arg, sizeof(slot_arg), "%d", spec->slot);
+        child_argv[child_argc++] = "-F";
+        child_argv[child_argc++] = fd_arg;
+        child_argv[child_argc++] = "-n";
+        child_argv[child_argc++] = slot_arg;
+        if (spec->huge_pages) {
+            child_argv[child_argc++] = "-H";
+        }
+        if (spec->sampler_pid > 0) {
+            snprintf(sampler_arg, sizeof(sampler_arg), "%d", (int)spec->sampler_pid);
+            child_argv[child_argc++] = "-e";
+            child_argv[child_argc++] = sampler_arg;
+        }
+    }
+    if (spec->duration_s > 0.0) {
+        snprintf(duration_arg, sizeof(duration_arg), "%.3f", spec->duration_s);
+        child_argv[child_argc++] = "-d";
+        child_argv[child_argc++] = duration_arg;
+    }
+    if (spec->rounds >= 0 && slot_fd != -1 && spec->sampler_pid == 0) {
+        snprintf(rounds_arg, sizeof(rounds_arg), "%d", spec->rounds);
+        child_argv[child_argc++] = "-M";
+        child_argv[child_argc++] = rounds_arg;
+    }
+    if (spec->resumed) {
+        snprintf(resume_arg, sizeof(resume_arg), "%lld:%lld:%lld:%lld:%lld", (long long)spec->resume.repetitions,
+                 (long long)spec->resume.counts[0], (long long)spec->resume.counts[1],
+                 (long long)spec->resume.counts[2], (long long)spec->resume.counts[3]);
+        child_argv[child_argc++] = "-c";
+        child_argv[child_argc++] = resume_arg;
+    }
+    child_argv[child_argc] = NULL;
+    execv(g_child_exec_path, child_argv);
+
+    // execv only returns on error
+    int exec_errno = errno;
+    // Use safe_write for this critical error message from child before exit
+    char err_buf[256];
+    int len = snprintf(err_buf, sizeof(err_buf), "CHILD_EXEC_FAIL: Failed to execute '%s' (errno %d: %s)\r\n",
+                       g_child_exec_path, exec_errno, strerror(exec_errno));
+    if (len > 0 && (size_t)len < sizeof(err_buf)) {
+        safe_write(STDERR_FILENO, err_buf, (size_t)len);
+    }
+    safe_write(spec->exec_fd, &exec_errno, sizeof(exec_errno)); // Tell the parent why
+    _exit(EXIT_FAILURE); // Use _exit in child after fork to avoid flushing parent's stdio buffers
+}
+
+/*
+ * start_spawn_helper
+ *
+ * Forks the spawn helper while the parent is still small. The helper
+ * creates every child on request (run_spawn_helper()), so creating a child
+ * copies the helper's page tables, not those of the parent with its
+ * registries, buffers and thread workers. The children are created with
+ * CLONE_PARENT: they are still the parent's children (SIGCHLD, wait4(),
+ * getppid()). Like the sampler, the helper dies with the parent.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 on success, -1 on failure (prints error message).
+ */
+static int start_spawn_helper(void) {
+    pid_t parent_pid = getpid();
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+        if (fprintf(stderr, "Error: Failed to create the spawn helper socket (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
+    }
+    if (fflush(stdout) == EOF) { /* Handle error? */ } // Nothing buffered may be written twice
+    pid_t pid = fork();
+    if (pid == -1) {
+        if (fprintf(stderr, "Error: Failed to fork the spawn helper (errno %d: %s).\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(sv[0]);
+        close(sv[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sigemptyset(&sa.sa_mask);
+        sa.sa_handler = SIG_IGN;
+        sigaction(SIGINT, &sa, NULL);
+        sigaction(SIGQUIT, &sa, NULL);
+        // A parent started by 'H' still holds its handled signals back until finish_hot_restart()
+        sigset_t empty_mask;
+        sigemptyset(&empty_mask);
+        sigprocmask(SIG_SETMASK, &empty_mask, NULL);
+        prctl(PR_SET_PDEATHSIG, SIGKILL, 0, 0, 0);
+        if (getppid() != parent_pid) {
+            _exit(EXIT_FAILURE); // The parent died before PR_SET_PDEATHSIG took effect
+        }
+        close(sv[0]);
+        close_restart_fds(); // The helper must not keep the re-adopted children's pipes and pidfds
+        run_spawn_helper(sv[1]);
+        _exit(EXIT_SUCCESS);
+    }
+    close(sv[1]);
+    g_spawn_helper_pid = pid;
+    g_spawn_helper_fd = sv[0];
+    if (printf("Children are created by spawn helper PID %d\r\n", (int)pid) < 0) { /* Handle error? */ }
+    return 0;
+}
+
+/*
+ * run_spawn_helper
+ *
+ * Body of the spawn helper. For each request it receives the child's
+ * descriptors, creates the child with clone3(CLONE_PARENT | CLONE_PIDFD),
+ * plus CLONE_INTO_CGROUP with -C, and answers with the PID and the pidfd.
+ * The new child runs exec_child(). Returns when the parent closes its end.
+ * Without clone3() it answers ENOSYS and the parent spawns by itself.
+ *
+ * Accepts:
+ *   sock - Helper's end of the socket
+ *
+ * Returns: None
+ */
+static void run_spawn_helper(int sock) {
+    for (;;) {
+        child_exec_t spec;
+        int fds[4];
+        size_t nfds = 0;
+        ssize_t n = recv_with_fds(sock, &spec, sizeof(spec), fds, 4, &nfds);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n != (ssize_t)sizeof(spec)) {
+            for (size_t i = 0; i < nfds; ++i) {
+                close(fds[i]);
+            }
+            return; // The parent closed its end (0) or sent garbage
+        }
+
+        // Descriptors arrive in this order, the optional ones only if the parent has them
+        size_t expected = 2 + (spec.stats_fd != -1) + (spec.cgroup_fd != -1);
+        spawn_reply_t reply = { -1, EPROTO };
+        int pidfd = -1;
+        if (nfds == expected) {
+            size_t next = 0;
+            spec.exec_fd = fds[next++];
+            spec.err_fd = fds[next++];
+            spec.stats_fd = (spec.stats_fd != -1) ? fds[next++] : -1;
+            spec.cgroup_fd = (spec.cgroup_fd != -1) ? fds[next++] : -1;
+
+            struct clone_args args;
+            memset(&args, 0, sizeof(args));
+            args.flags = CLONE_PARENT | CLONE_PIDFD;
+            args.pidfd = (uint64_t)(uintptr_t)&pidfd;
+            if (spec.cgroup_fd != -1) {
+                args.flags |= CLONE_INTO_CGROUP;
+                args.cgroup = (uint64_t)spec.cgroup_fd;
+            }
+            // As in spawn_child_with(): the new child takes SIGTERM only after exec_child() reset it
+            sigset_t kill_mask, saved_mask;
+            sigemptyset(&kill_mask);
+            sigaddset(&kill_mask, SIGTERM);
+            sigprocmask(SIG_BLOCK, &kill_mask, &saved_mask);
+            long pid = syscall(SYS_clone3, &args, sizeof(args));
+            if (pid == 0) {
+                close(sock);
+                exec_child(&spec, -1);
+            }
+            sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+            reply.pid = (pid_t)pid;
+            reply.error = (pid == -1) ? errno : 0;
+        }
+        for (size_t i = 0; i < nfds; ++i) {
+            close(fds[i]);
+        }
+        send_with_fds(sock, &reply, sizeof(reply), &pidfd, (pidfd != -1) ? 1 : 0);
+        if (pidfd != -1) {
+            close(pidfd);
+        }
     }
-
-    errno = saved_errno; // Restore errno
 }
 
-
 /*
- * register_signal_handlers
+ * spawn_via_helper
  *
- * Sets up signal handlers for SIGINT, SIGTERM, SIGQUIT, and SIGCHLD.
- * Exits on failure.
+ * Asks the spawn helper to create a child and waits for its answer. If the
+ * helper is gone or cannot use clone3(), it is stopped and the caller
+ * spawns by itself (g_spawn_helper_fd is then -1).
  *
- * Accepts: None
- * Returns: None
+ * Accepts:
+ *   spec - What the child runs with (its descriptors are passed along)
+ *   pidfd - Output: pidfd of the child
+ *
+ * Returns:
+ *   Child PID, or -1 on failure (errno set).
  */
-static void register_signal_handlers(void) {
-    struct sigaction sa;
-    memset(&sa, 0, sizeof(sa));
-    sa.sa_handler = handle_signal;
+static pid_t spawn_via_helper(const child_exec_t *spec, int *pidfd) {
+    int fds[4];
+    size_t nfds = 0;
+    spawn_reply_t reply;
+    int received = -1;
+    size_t nreceived = 0;
+    ssize_t n = -1;
 
-    // Block common signals within the handler to prevent reentrancy issues
-    // for these specific signals, though handle_signal is designed to be safe.
-    if (sigfillset(&sa.sa_mask) == -1) { // Block all signals during handler execution
-        // disable_raw_mode(); // Handled by atexit if main exits
-        perror("Error: sigfillset failed");
-        exit(EXIT_FAILURE);
+    fds[nfds++] = spec->exec_fd;
+    fds[nfds++] = spec->err_fd;
+    if (spec->stats_fd != -1) {
+        fds[nfds++] = spec->stats_fd;
     }
-    // Alternatively, more targeted:
-    // if (sigemptyset(&sa.sa_mask) == -1) { perror("Error: sigemptyset failed"); exit(EXIT_FAILURE); }
-    // if (sigaddset(&sa.sa_mask, SIGINT) == -1) { /* ... */ }
-    // if (sigaddset(&sa.sa_mask, SIGTERM) == -1) { /* ... */ }
-    // if (sigaddset(&sa.sa_mask, SIGQUIT) == -1) { /* ... */ }
-    // if (sigaddset(&sa.sa_mask, SIGCHLD) == -1) { /* ... */ }
-
-
-    // For SIGINT, SIGTERM, SIGQUIT:
-    // sa.sa_flags = 0; // Default: signal handler is not re-entered, syscalls not restarted
-    // If syscalls (like read) should be interrupted and return EINTR:
-    sa.sa_flags = 0; // Let them be interrupted. The main loop handles EINTR from read.
-
-    if (sigaction(SIGINT, &sa, NULL) == -1 ||
-        sigaction(SIGTERM, &sa, NULL) == -1 ||
-        sigaction(SIGQUIT, &sa, NULL) == -1) {
-        // disable_raw_mode(); // Handled by atexit
-        perror("Error: Failed to register termination signal handlers");
-    exit(EXIT_FAILURE);
+    if (spec->cgroup_fd != -1) {
+        fds[nfds++] = spec->cgroup_fd;
+    }
+    *pidfd = -1;
+    if (send_with_fds(g_spawn_helper_fd, spec, sizeof(*spec), fds, nfds) == 0) {
+        do {
+            n = recv_with_fds(g_spawn_helper_fd, &reply, sizeof(reply), &received, 1, &nreceived);
+        } while (n == -1 && errno == EINTR);
+    }
+    if (n != (ssize_t)sizeof(reply)) {
+        if (fprintf(stderr, "PARENT [%d]: Warning: The spawn helper does not answer; spawning from the parent.\r\n", getpid()) < 0) { /* Handle error? */ }
+        if (nreceived > 0) {
+            close(received);
         }
-
-        // For SIGCHLD:
-        // SA_RESTART can be useful for SIGCHLD if you want interrupted syscalls to restart.
-        // SA_NOCLDSTOP prevents SIGCHLD when a child is stopped (e.g., by SIGSTOP/SIGTSTP).
-        sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
-        if (sigaction(SIGCHLD, &sa, NULL) == -1) {
-            // disable_raw_mode(); // Handled by atexit
-            perror("Error: Failed to register SIGCHLD handler");
-            exit(EXIT_FAILURE);
+        stop_spawn_helper();
+        errno = EPIPE;
+        return -1;
+    }
+    if (reply.pid == -1) {
+        if (reply.error == ENOSYS || reply.error == E2BIG) {
+            if (fprintf(stderr, "PARENT [%d]: Warning: The spawn helper cannot use clone3(); spawning from the parent.\r\n", getpid()) < 0) { /* Handle error? */ }
+            stop_spawn_helper();
         }
+        errno = reply.error;
+        return -1;
+    }
+    *pidfd = (nreceived > 0) ? received : -1;
+    return reply.pid;
+}
 
-        // Parent should ignore SIGUSR1 and SIGUSR2 if it's not meant to act on them.
-        // This prevents accidental termination if a child (or other process) sends them to the parent.
-        memset(&sa, 0, sizeof(sa));
-        sa.sa_handler = SIG_IGN; // Ignore the signal
-        sa.sa_flags = 0;
-        if (sigaction(SIGUSR1, &sa, NULL) == -1 || sigaction(SIGUSR2, &sa, NULL) == -1) {
-            // This is a warning because the program can still function.
-            fprintf(stderr, "Warning: Failed to ignore SIGUSR1/SIGUSR2 in parent.\r\n");
+/*
+ * stop_spawn_helper
+ *
+ * Closes the helper's socket, which makes it exit, and reaps it.
+ *
+ * Accepts: None
+ * Returns: None
+ */
+static void stop_spawn_helper(void) {
+    if (g_spawn_helper_fd != -1) {
+        close(g_spawn_helper_fd);
+        g_spawn_helper_fd = -1;
+    }
+    if (g_spawn_helper_pid > 0) {
+        while (waitpid(g_spawn_helper_pid, NULL, 0) == -1 && errno == EINTR) {
         }
+        g_spawn_helper_pid = -1;
+    }
 }
 
-
 /*
- * add_child_pid
+ * send_with_fds
  *
- * Adds a child PID to the dynamic array, resizing if necessary.
- * Aborts on memory allocation failure (as this is a critical part of tracking).
+ * Sends one message on a SOCK_SEQPACKET socket with descriptors attached
+ * (SCM_RIGHTS). Never raises SIGPIPE.
  *
  * Accepts:
- *   pid - The PID of the child process to add.
+ *   sock - Socket
+ *   buf, len - Message
+ *   fds, nfds - Descriptors to pass (at most 4)
  *
  * Returns:
- *   0 on success. Aborts on failure.
+ *   0 on success, -1 on failure (errno set).
  */
-static int add_child_pid(pid_t pid) {
-    if (g_child_count >= g_child_capacity) {
-        size_t new_capacity = (g_child_capacity == 0) ? INITIAL_CHILD_CAPACITY : g_child_capacity * 2;
-        // Check for overflow before multiplication
-        if (g_child_capacity > SIZE_MAX / 2 && g_child_capacity != 0) { // Potential overflow with * 2
-            // disable_raw_mode(); // Handled by atexit via abort()
-            if (fprintf(stderr, "Error: Child PID array capacity overflow (requested %zu).\r\n", new_capacity) < 0) { /* Handle error? */ }
-            abort(); // Critical error
-        }
-        // Check if new_capacity * sizeof(pid_t) would overflow size_t
-        if (new_capacity > SIZE_MAX / sizeof(pid_t)) {
-            // disable_raw_mode(); // Handled by atexit via abort()
-            if (fprintf(stderr, "Error: Child PID array memory size overflow (requested %zu elements).\r\n", new_capacity) < 0) { /* Handle error? */ }
-            abort(); // Critical error
-        }
+static int send_with_fds(int sock, const void *buf, size_t len, const int *fds, size_t nfds) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * 4)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { (void *)buf, len };
+    struct msghdr msg;
 
-        pid_t *new_pids = realloc(g_child_pids, new_capacity * sizeof(pid_t));
-        if (new_pids == NULL) {
-            // disable_raw_mode(); // Handled by atexit via abort()
-            perror("Error: Failed to reallocate memory for child PIDs");
-            // Try to kill the newly created child if we can't track it.
-            // This is best effort as we are about to abort.
-            kill(pid, SIGKILL); // Send SIGKILL to the child we just forked but can't track
-            waitpid(pid, NULL, 0); // Wait for it to ensure it's gone before aborting parent
-            abort(); // Critical error
-        }
-        g_child_pids = new_pids;
-        g_child_capacity = new_capacity;
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (nfds > 0) {
+        msg.msg_control = control.buf;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * nfds);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * nfds);
     }
-    g_child_pids[g_child_count++] = pid;
-    return 0;
+    ssize_t n;
+    do {
+        n = sendmsg(sock, &msg, MSG_NOSIGNAL);
+    } while (n == -1 && errno == EINTR);
+    return (n == (ssize_t)len) ? 0 : -1;
 }
 
 /*
- * remove_child_pid_at_index
+ * recv_with_fds
  *
- * Removes a child PID from the array at the specified index by shifting
- * subsequent elements down. Assumes index is valid relative to current count.
- * Does NOT shrink the allocated memory (g_child_capacity remains).
+ * Receives one message and the descriptors attached to it. Received
+ * descriptors are close-on-exec; extra ones are closed.
  *
  * Accepts:
- *   index - The index of the PID to remove.
+ *   sock - Socket
+ *   buf, len - Message buffer
+ *   fds, max_fds - Output: received descriptors (max_fds at most 4)
+ *   nfds - Output: number of descriptors stored in fds
  *
- * Returns: None
+ * Returns:
+ *   Message length, 0 if the peer closed the socket, -1 on failure (errno set).
  */
-static void remove_child_pid_at_index(size_t index) {
-    pid_t parent_pid = getpid();
-    if (index >= g_child_count) {
-        // This should ideally not happen if logic is correct elsewhere.
-        if (fprintf(stderr, "PARENT [%d]: Error: Invalid index %zu in remove_child_pid_at_index (count=%zu).\r\n",
-            parent_pid, index, g_child_count) < 0) { /* Handle error? */ }
-            return;
-    }
+static ssize_t recv_with_fds(int sock, void *buf, size_t len, int *fds, size_t max_fds, size_t *nfds) {
+    union {
+        char buf[CMSG_SPACE(sizeof(int) * 4)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { buf, len };
+    struct msghdr msg;
 
-    // Number of elements to move is g_child_count - 1 (new count) - index
-    size_t elements_to_move = g_child_count - 1 - index;
-    if (elements_to_move > 0) {
-        // memmove is safe for overlapping regions
-        memmove(&g_child_pids[index], &g_child_pids[index + 1], elements_to_move * sizeof(pid_t));
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    *nfds = 0;
+    ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (n == -1) {
+        return -1;
     }
-    // else: removing the last element, no move needed.
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (*nfds < max_fds) {
+                fds[(*nfds)++] = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+    return n;
+}
 
-    g_child_count--;
 
-    // Optional: Shrink g_child_pids array if count is much smaller than capacity.
-    // For this lab, not shrinking is simpler and likely fine.
-    // Example shrink condition (e.g., if count is 1/4 of capacity and capacity > initial):
-    /*
-     *   if (g_child_count > 0 && g_child_capacity > INITIAL_CHILD_CAPACITY && g_child_count <= g_child_capacity / 4) {
-     *       size_t new_capacity = g_child_capacity / 2;
-     *       if (new_capacity < INITIAL_CHILD_CAPACITY) new_capacity = INITIAL_CHILD_CAPACITY;
-     *       if (new_capacity < g_child_count) new_capacity = g_child_count; // Should not happen if logic is right
-     *
-     *       pid_t *new_pids = realloc(g_child_pids, new_capacity * sizeof(pid_t));
-     *       if (new_pids != NULL) { // Only update if realloc (shrinking) succeeds
-     *           g_child_pids = new_pids;
-     *           g_child_capacity = new_capacity;
-} else {
-    // Failed to shrink, not critical, continue with larger array.
-    // fprintf(stderr, "PARENT [%d]: Warning: realloc failed to shrink PID array.\r\n", parent_pid);
-}
-} else if (g_child_count == 0 && g_child_capacity > INITIAL_CHILD_CAPACITY) {
-    // Optionally shrink to initial or free completely if count is 0
-    // For simplicity, current code keeps it allocated until program exit.
-}
-*/
+/*
+ * spawn_child
+ *
+ * Spawns a fresh child under the current scheduling policy.
+ *
+ * Accepts: None
+ * Returns:
+ *   0 if the child was forked and tracked, -1 if fork failed.
+ */
+static int spawn_child(void) {
+    return spawn_child_with(&g_sched_spec, NULL);
 }
 
-
 /*
- * kill_all_children
+ * spawn_child_with
  *
- * Sends SIGKILL to all currently tracked child processes.
- * Removes successfully killed or already exited (ESRCH) children from the list.
- * Prints actions to stderr.
+ * Creates (clone_child(), or the spawn helper with -S) and execs a new child
+ * process using the path in g_child_exec_path.
+ * Adds the new child to the registry as STARTING; it becomes RUNNING when
+ * the close-on-exec status pipe reports a successful execv().
+ * Reports success (stdout) or failure (stderr).
+ * Aborts parent on critical failure in add_child_entry.
  *
  * Accepts:
- *   reason - A string indicating why children are being killed (for logging).
+ *   sched - Scheduling policy to apply before execv()
+ *   resume - Checkpoint the child continues from, or NULL for a fresh run
  *
- * Returns: None
+ * Returns:
+ *   0 if the child was forked and tracked, -1 if fork failed.
  */
-static void kill_all_children(const char *reason) {
-    pid_t parent_pid = getpid();
+static int spawn_child_with(const sched_spec_t *sched, const checkpoint_data_t *resume) {
+    int exec_pipe[2];
+    int err_pipe[2];
+    int slot = acquire_stats_slot();
 
-    if (g_child_count == 0) {
-        // Only print "No children to kill" if not part of the standard exit cleanup.
-        if (strcmp(reason, "Parent exiting.") != 0) {
-            if (printf("PARENT [%d]: No children to kill.\r\n", parent_pid) < 0) { /* Handle error? */ }
-        }
-        return;
+    // Both ends close on exec: EOF on the read end means execv() succeeded
+    if (pipe(exec_pipe) == -1) {
+        if (fprintf(stderr, "Error: Failed to create exec-status pipe (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        release_stats_slot(slot);
+        return -1;
+    }
+    if (fcntl(exec_pipe[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(exec_pipe[1], F_SETFD, FD_CLOEXEC) == -1 ||
+        fcntl(exec_pipe[0], F_SETFL, O_NONBLOCK) == -1) {
+        if (fprintf(stderr, "Error: Failed to configure exec-status pipe (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(exec_pipe[0]);
+        close(exec_pipe[1]);
+        release_stats_slot(slot);
+        return -1;
+    }
+    // The read end stays in the parent only; the write end becomes the child's stderr
+    if (pipe(err_pipe) == -1) {
+        if (fprintf(stderr, "Error: Failed to create child stderr pipe (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(exec_pipe[0]);
+        close(exec_pipe[1]);
+        release_stats_slot(slot);
+        return -1;
+    }
+    if (fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(err_pipe[0], F_SETFL, O_NONBLOCK) == -1) {
+        if (fprintf(stderr, "Error: Failed to configure child stderr pipe (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(exec_pipe[0]);
+        close(exec_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        release_stats_slot(slot);
+        return -1;
     }
 
-    // Use stderr for operational messages like killing children
-    if (fprintf(stderr, "PARENT [%d]: Killing all %zu children (%s).\r\n", parent_pid, g_child_count, reason) < 0) { /* Handle error? */ }
-    if (fflush(stderr) == EOF) { /* Handle error? */ }
-
-    // Iterate backwards because remove_child_pid_at_index shifts elements
-    for (size_t i = g_child_count; i > 0; --i) {
-        size_t current_index = i - 1;
-        pid_t pid_to_kill = g_child_pids[current_index];
-
-        if (fprintf(stderr, "PARENT [%d]: Sending SIGKILL to child PID %d...\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-        if (fflush(stderr) == EOF) { /* Handle error? */ }
-
-        int kill_result = kill(pid_to_kill, SIGKILL);
+    child_exec_t spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.exec_fd = exec_pipe[1];
+    spec.err_fd = err_pipe[1];
+    spec.stats_fd = (slot >= 0) ? g_stats_fd : -1;
+    spec.cgroup_fd = g_cgroup_fd;
+    spec.slot = slot;
+    spec.huge_pages = g_huge_pages;
+    spec.sampler_pid = (g_sampler_pid > 0) ? g_sampler_pid : 0;
+    spec.duration_s = g_run_duration_s;
+    spec.rounds = g_round_limit;
+    spec.sched = *sched;
+    if (resume != NULL) {
+        spec.resumed = 1;
+        spec.resume = *resume;
+    }
 
-        if (kill_result == -1) {
-            if (errno == ESRCH) { // Child already exited
-                if (fprintf(stderr, "PARENT [%d]: Child PID %d already exited.\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-                remove_child_pid_at_index(current_index); // Remove from our list
-            } else { // Other error sending signal
-                if (fprintf(stderr, "Warning: Failed to send SIGKILL to PID %d (errno %d: %s).\r\n",
-                    pid_to_kill, errno, strerror(errno)) < 0) { /* Handle error? */ }
-                    // Do not remove from list if kill failed for reasons other than ESRCH,
-                    // as it might still be alive and we might want to retry or log it.
-                    // However, for SIGKILL, if it fails with something other than ESRCH,
-                    // it's an unusual situation (e.g. permission denied, which shouldn't happen for own child).
-            }
-        } else { // kill succeeded
-            // Child will be reaped by SIGCHLD handler eventually.
-            // We remove it from our active tracking list.
-            if (fprintf(stderr, "PARENT [%d]: SIGKILL sent to PID %d. It will be reaped.\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-            remove_child_pid_at_index(current_index);
+    int pidfd = -1;
+    pid_t pid = -1;
+    long long create_ns = monotonic_ns();
+    if (g_spawn_helper_fd != -1) {
+        pid = spawn_via_helper(&spec, &pidfd);
+    }
+    if (g_spawn_helper_fd == -1) { // No helper, or it just failed for good
+        // A kill right after the spawn must not run this process's handlers in the new child;
+        // exec_child() unblocks them once it has restored the default actions
+        sigset_t kill_mask, saved_mask;
+        sigemptyset(&kill_mask);
+        sigaddset(&kill_mask, SIGTERM);
+        sigaddset(&kill_mask, SIGINT);
+        sigaddset(&kill_mask, SIGQUIT);
+        sigprocmask(SIG_BLOCK, &kill_mask, &saved_mask);
+        pid = clone_child(&pidfd);
+        if (pid != 0) {
+            sigprocmask(SIG_SETMASK, &saved_mask, NULL);
         }
-        // No explicit waitpid here; SIGCHLD handler is responsible for reaping.
-        // If we waitpid here, it could interfere with the SIGCHLD handler or block.
+    }
+    if (pid > 0) {
+        g_spawn_calls++;
+        g_spawn_call_total_ns += monotonic_ns() - create_ns;
     }
 
-    if (g_child_count == 0) {
-        if (fprintf(stderr, "PARENT [%d]: All tracked children processed for killing.\r\n", parent_pid) < 0) { /* Handle error? */ }
-    } else {
-        if (fprintf(stderr, "PARENT [%d]: Processed children for killing. %zu children may remain tracked due to kill errors (should be rare).\r\n", parent_pid, g_child_count) < 0) { /* Handle error? */ }
+    if (pid == -1) { // Fork failed
+        if (fprintf(stderr, "Error: Failed to create child process (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+        close(exec_pipe[0]);
+        close(exec_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        release_stats_slot(slot);
+        return -1;
+    } else if (pid == 0) { // Child process
+        close(exec_pipe[0]);
+        close(err_pipe[0]);
+        // Forked without clone3(): join the cgroup before execv(), so the workload is charged there
+        exec_child(&spec, (pidfd == -1) ? g_cgroup_procs_fd : -1);
+    } else { // Parent process
+        close(exec_pipe[1]);
+        close(err_pipe[1]);
+        // add_child_entry aborts on failure, so the child is always tracked here
+        child_entry_t *child = add_child_entry(pid, exec_pipe[0], err_pipe[0], slot);
+        g_spawned_total++;
+        child->pidfd = pidfd;
+        child->sched = *sched;
+        child->resumed_reps = (resume != NULL) ? resume->repetitions : 0;
+        child->duration_s = g_run_duration_s;
+        TRACE_PROBE3(spawn, pid, slot, child->spawn_ns - create_ns);
+        // Report success to user
+        if (!g_quiet_ops) {
+            char sched_name[SCHED_NAME_LEN];
+            format_sched_spec(sched, sched_name, sizeof(sched_name));
+            if (printf("PARENT [%d]: Spawned child process with PID %d (policy %s%s). Live children: %zu\r\n",
+                getpid(), pid, sched_name, (resume != NULL) ? ", resumed" : "", live_child_count()) < 0) { /* Handle error? */ }
+        }
     }
-    if (fflush(stderr) == EOF) { /* Handle error? */ }
+    return 0;
 }
 
 /*
- * signal_all_children
+ * kill_child_at_index
  *
- * Sends the specified signal (SIGUSR1 or SIGUSR2) to all tracked children.
- * Reports actions to stdout/stderr. Does NOT remove children on ESRCH here,
- * as SIGCHLD handler should deal with exited children.
+ * Sends SIGTERM to the tracked child at the given index, so it writes a
+ * final checkpoint before it dies, and moves it to SIGNALED; it stays
+ * tracked until reap_children() reaps it. escalate_kills() sends SIGKILL
+ * if it is still alive KILL_GRACE_NS later. A paused child cannot handle
+ * SIGTERM and gets SIGKILL at once.
+ * Reports the action to stderr (unless per-operation messages are suppressed).
  *
  * Accepts:
- *   sig - The signal number to send (SIGUSR1 or SIGUSR2).
+ *   index - Index of the child in g_children (must be < g_child_count).
  *
- * Returns: None
+ * Returns:
+ *   0 if the signal was sent, 1 if the child was not live (already signaled
+ *   or exited), -1 if kill failed (the child stays in its current state).
  */
-static void signal_all_children(int sig) {
+static int kill_child_at_index(size_t index) {
     pid_t parent_pid = getpid();
-    const char *sig_name = (sig == SIGUSR1) ? "SIGUSR1 (enable output)" : "SIGUSR2 (disable output)";
+    child_entry_t *child = &g_children[index];
+    pid_t pid_to_kill = child->pid;
+    int sig = (child->paused_ns != 0) ? SIGKILL : SIGTERM;
+    const char *sig_name = (sig == SIGKILL) ? "SIGKILL" : "SIGTERM";
 
-    if (g_child_count == 0) {
-        if (printf("PARENT [%d]: No children to send %s to.\r\n", parent_pid, sig_name) < 0) { /* Handle error? */ }
-        return;
+    if (!is_child_live(child)) {
+        if (!g_quiet_ops && fprintf(stderr, "PARENT [%d]: Child PID %d is already %s.\r\n",
+            parent_pid, pid_to_kill, child_state_name(child->state)) < 0) { /* Handle error? */ }
+        return 1;
     }
 
     // Use stderr for operational messages
-    if (fprintf(stderr, "PARENT [%d]: Sending %s to all %zu children.\r\n", parent_pid, sig_name, g_child_count) < 0) { /* Handle error? */ }
-    if (fflush(stderr) == EOF) { /* Handle error? */ }
-
-    size_t signaled_count = 0;
-    size_t esrch_count = 0; // Count children that were already gone
-    for (size_t i = 0; i < g_child_count; ++i) {
-        pid_t child_pid = g_child_pids[i];
-        if (kill(child_pid, sig) == 0) {
-            signaled_count++;
-        } else {
-            if (errno == ESRCH) { // Process does not exist
-                esrch_count++;
-                // Don't remove from g_child_pids here; SIGCHLD handler should have/will handle it.
-                // If we remove here, and SIGCHLD handler also tries, it could be problematic.
-                // The list will get cleaned up eventually by kill_all_children or kill_last_child
-                // if they encounter ESRCH.
-                if (fprintf(stderr, "PARENT [%d]: Child PID %d for %s already exited (ESRCH).\r\n", parent_pid, child_pid, sig_name) < 0) { /* Handle error? */ }
+    if (!g_quiet_ops) {
+        if (fprintf(stderr, "PARENT [%d]: Sending %s to child PID %d.\r\n", parent_pid, sig_name, pid_to_kill) < 0) { /* Handle error? */ }
+        if (fflush(stderr) == EOF) { /* Handle error? */ }
+    }
 
-            } else { // Other error
-                if (fprintf(stderr, "Warning: Failed to send %s to PID %d (errno %d: %s).\r\n",
-                    sig_name, child_pid, errno, strerror(errno)) < 0) { /* Handle error? */ }
-            }
-        }
+    if (signal_child(child, sig, NULL) == -1) {
+        // ESRCH cannot happen for an unreaped child; anything else is unusual for our own child
+        if (fprintf(stderr, "Warning: Failed to send %s to PID %d (errno %d: %s).\r\n",
+            sig_name, pid_to_kill, errno, strerror(errno)) < 0) { /* Handle error? */ }
+        return -1;
     }
 
-    // Use printf for user-facing summary
-    if (printf("PARENT [%d]: Attempted to send %s to %zu children. Success: %zu, Already Exited (ESRCH): %zu.\r\n",
-        parent_pid, sig_name, g_child_count, signaled_count, esrch_count) < 0) { /* Handle error? */ }
+    child->last_signal = sig;
+    set_child_state(child, CHILD_STATE_SIGNALED);
+    if (sig == SIGTERM) {
+        child->kill_deadline_ns = monotonic_ns() + KILL_GRACE_NS;
+        g_kill_escalations++;
+    }
+    if (!g_quiet_ops && fprintf(stderr, "PARENT [%d]: %s sent to PID %d. It will be reaped.\r\n", parent_pid, sig_name, pid_to_kill) < 0) { /* Handle error? */ }
+    return 0;
 }
 
-
 /*
- * spawn_child
+ * escalate_kills
  *
- * Forks and execs a new child process using the path in g_child_exec_path.
- * Adds the new child's PID to the list. Reports success (stdout) or failure (stderr).
- * Aborts parent on critical failure in add_child_pid.
+ * Sends SIGKILL to every killed child still alive KILL_GRACE_NS after its
+ * SIGTERM. Only scans the registry while escalations are pending.
  *
  * Accepts: None
  * Returns: None
  */
-static void spawn_child(void) {
-    pid_t pid = fork();
-
-    if (pid == -1) { // Fork failed
-        if (fprintf(stderr, "Error: Failed to fork child process (errno %d: %s)\r\n", errno, strerror(errno)) < 0) { /* Handle error? */ }
+static void escalate_kills(void) {
+    if (g_kill_escalations == 0) {
         return;
-    } else if (pid == 0) { // Child process
-        // Child-specific setup:
-        // 1. Restore default signal handlers for signals parent might ignore or handle differently.
-        //    The parent's raw mode setup (termios) is NOT inherited across execv.
-        //    The child will have default terminal settings unless it changes them.
-        struct sigaction sa_dfl;
-        memset(&sa_dfl, 0, sizeof(sa_dfl));
-        sa_dfl.sa_handler = SIG_DFL; // Default action
-        sigaction(SIGINT, &sa_dfl, NULL);  // Child should terminate on SIGINT by default
-        sigaction(SIGTERM, &sa_dfl, NULL); // Child should terminate on SIGTERM by default
-        sigaction(SIGQUIT, &sa_dfl, NULL); // Child should terminate and dump core on SIGQUIT
-        // SIGCHLD is irrelevant for the child itself to handle this way.
-        // SIGUSR1, SIGUSR2 will be set up by the child_main.
-
-        // 2. The child does not need to (and should not) try to restore parent's g_orig_termios.
-        //    The terminal settings are per-process (more accurately, per controlling terminal session,
-        //    but execv resets many process attributes).
-
-        char *const child_argv[] = { g_child_exec_path, NULL };
-        execv(g_child_exec_path, child_argv);
-
-        // execv only returns on error
-        int exec_errno = errno;
-        // Use safe_write for this critical error message from child before exit
-        char err_buf[256];
-        int len = snprintf(err_buf, sizeof(err_buf), "CHILD_EXEC_FAIL: Failed to execute '%s' (errno %d: %s)\r\n",
-                           g_child_exec_path, exec_errno, strerror(exec_errno));
-        if (len > 0 && (size_t)len < sizeof(err_buf)) {
-            safe_write(STDERR_FILENO, err_buf, (size_t)len);
+    }
+    long long now_ns = monotonic_ns();
+    for (size_t i = 0; i < g_child_count; ++i) {
+        child_entry_t *child = &g_children[i];
+        if (child->kill_deadline_ns == 0 || now_ns < child->kill_deadline_ns) {
+            continue;
+        }
+        child->kill_deadline_ns = 0;
+        g_kill_escalations--;
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_PID, child->pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == child->pid) {
+            continue; // It died of the SIGTERM and awaits the reaper (a zombie still accepts signals)
+        }
+        if (signal_child(child, SIGKILL, NULL) == -1) {
+            continue;
         }
-        _exit(EXIT_FAILURE); // Use _exit in child after fork to avoid flushing parent's stdio buffers
+        child->last_signal = SIGKILL;
+        g_kills_escalated++;
+        if (!g_quiet_ops && fprintf(stderr, "PARENT [%d]: Child PID %d outlived SIGTERM; sent SIGKILL.\r\n", getpid(), child->pid) < 0) { /* Handle error? */ }
+    }
+}
 
-    } else { // Parent process
-        if (add_child_pid(pid) != 0) {
-            // add_child_pid aborts on failure, so this part might not be reached
-            // if it does, it means add_child_pid had a non-aborting error (not current design)
-            kill(pid, SIGKILL); // Kill the child we can't track
-            waitpid(pid, NULL, 0); // Reap it
-            return; // Or handle error more gracefully if add_child_pid didn't abort
+/*
+ * kill_timeout_ms
+ *
+ * Shortens a poll timeout so the next SIGKILL escalation runs on time.
+ *
+ * Accepts:
+ *   timeout_ms - Timeout computed so far (-1 = infinite)
+ *
+ * Returns: The possibly shortened timeout.
+ */
+static int kill_timeout_ms(int timeout_ms) {
+    if (g_kill_escalations == 0) {
+        return timeout_ms;
+    }
+    long long due_ns = LLONG_MAX;
+    for (size_t i = 0; i < g_child_count; ++i) {
+        if (g_children[i].kill_deadline_ns != 0 && g_children[i].kill_deadline_ns < due_ns) {
+            due_ns = g_children[i].kill_deadline_ns;
         }
-        // Report success to user
-        if (printf("PARENT [%d]: Spawned child process with PID %d. Total children: %zu\r\n",
-            getpid(), pid, g_child_count) < 0) { /* Handle error? */ }
     }
+    long long now_ns = monotonic_ns();
+    long long wait_ms = (due_ns > now_ns) ? (due_ns - now_ns + 999999LL) / 1000000LL : 0;
+    return (timeout_ms < 0 || wait_ms < timeout_ms) ? (int)wait_ms : timeout_ms;
 }
 
 /*
  * kill_last_child
  *
- * Sends SIGKILL to the most recently spawned child process.
- * Removes the child from the list if kill succeeds or fails with ESRCH.
+ * Sends SIGKILL to the most recently spawned child that is still live.
  * Reports the action (stdout/stderr).
  *
  * Accepts: None
- * Returns: None
+ * Returns:
+ *   Result of kill_child_at_index, or 1 if there were no live children.
  */
-static void kill_last_child(void) {
+static int kill_last_child(void) {
     pid_t parent_pid = getpid();
+    size_t index = g_child_count;
 
-    if (g_child_count == 0) {
-        if (printf("PARENT [%d]: No children to kill.\r\n", parent_pid) < 0) { /* Handle error? */ }
-        return;
+    while (index > 0 && !is_child_live(&g_children[index - 1])) {
+        index--;
     }
-
-    size_t last_index = g_child_count - 1;
-    pid_t pid_to_kill = g_child_pids[last_index];
-
-    // Use stderr for operational messages
-    if (fprintf(stderr, "PARENT [%d]: Sending SIGKILL to last child (PID %d).\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-    if (fflush(stderr) == EOF) { /* Handle error? */ }
-
-    int kill_result = kill(pid_to_kill, SIGKILL);
-    int removed_from_tracking = 0;
-
-    if (kill_result == -1) {
-        if (errno == ESRCH) { // Child already exited
-            if (fprintf(stderr, "PARENT [%d]: Child PID %d already exited.\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-            remove_child_pid_at_index(last_index);
-            removed_from_tracking = 1;
-        } else { // Other error sending signal
-            if (fprintf(stderr, "Warning: Failed to send SIGKILL to PID %d (errno %d: %s).\r\n",
-                pid_to_kill, errno, strerror(errno)) < 0) { /* Handle error? */ }
-                // Do not remove if kill failed for other reasons, it might still be around.
-        }
-    } else { // kill succeeded
-        if (fprintf(stderr, "PARENT [%d]: SIGKILL sent to PID %d. It will be reaped.\r\n", parent_pid, pid_to_kill) < 0) { /* Handle error? */ }
-        remove_child_pid_at_index(last_index);
-        removed_from_tracking = 1;
+    if (index == 0) {
+        if (!g_quiet_ops && printf("PARENT [%d]: No children to kill.\r\n", parent_pid) < 0) { /* Handle error? */ }
+        return 1;
     }
 
+    pid_t pid_to_kill = g_children[index - 1].pid;
+    int result = kill_child_at_index(index - 1);
+
     // Report outcome to user
-    if (removed_from_tracking) {
-        if (printf("PARENT [%d]: Processed kill for child %d. Remaining children tracked: %zu\r\n",
-            parent_pid, pid_to_kill, g_child_count) < 0) { /* Handle error? */ }
+    if (g_quiet_ops) {
+        return result;
+    }
+    if (result >= 0) {
+        if (printf("PARENT [%d]: Processed kill for child %d. Remaining live children: %zu\r\n",
+            parent_pid, pid_to_kill, live_child_count()) < 0) { /* Handle error? */ }
     } else {
-        if (printf("PARENT [%d]: Did not remove tracking for child %d due to kill error. Children tracked: %zu\r\n",
-            parent_pid, pid_to_kill, g_child_count) < 0) { /* Handle error? */ }
+        if (printf("PARENT [%d]: Could not kill child %d. Live children: %zu\r\n",
+            parent_pid, pid_to_kill, live_child_count()) < 0) { /* Handle error? */ }
     }
+    return result;
 }
 
 /*
  * list_children
  *
- * Prints the PID of the parent and the PIDs of all currently tracked children to stdout.
- * Uses \r\n for raw mode compatibility. Checks printf return values.
- * Uses a local buffer to build the string to minimize interleaved output if children also print.
+ * Prints the PID of the parent, the number of children per lifecycle state
+ * (from the O(1) counters, no kill() probing) and one line per tracked child
+ * with its state, policy, age and last signal.
+ * Uses \r\n for raw mode compatibility. Builds the whole listing in one
+ * buffer and writes it once to minimize interleaving with child output.
  *
  * Accepts: None
  * Returns: None
  */
 static void list_children(void) {
     pid_t parent_pid = getpid();
-    char list_buf[4096]; // Reasonably sized buffer for the list
-    int current_pos = 0;
-    int remaining_buf = sizeof(list_buf);
+    if (g_subreaper) {
+        scan_descendants(); // List the current tree, not the last periodic scan
+    }
+    size_t buf_size = 2048 + (g_child_count + WORKER_LIST_MAX + REAPED_RECENT_MAX) * LIST_LINE_LEN;
+    char *list_buf = malloc(buf_size);
+    size_t current_pos = 0;
+    long long now_ns = monotonic_ns();
     int ret;
 
+    if (list_buf == NULL) {
+        perror("PARENT: Error allocating child list buffer");
+        return;
+    }
+
     // snprintf returns number of chars written (excluding null) or <0 on error
-    ret = snprintf(list_buf + current_pos, (size_t)remaining_buf, "PARENT [%d]: Listing processes:\r\n", parent_pid);
-    if (ret < 0 || ret >= remaining_buf) goto buffer_error;
-    current_pos += ret; remaining_buf -= ret;
+    ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                   "PARENT [%d]: Listing processes:\r\n  Parent: %d\r\n"
+                   "  States: starting %zu, running %zu, signaled %zu, exited %zu, reaped %zu\r\n"
+                   "  Reaped exits: %llu normal, %llu failed, %llu by signal (%llu outlived SIGTERM)\r\n"
+                   "  Child stderr: %llu lines (%llu bytes), %llu dropped by rate limit, %llu writes\r\n",
+                   parent_pid, parent_pid,
+                   g_state_counts[CHILD_STATE_STARTING], g_state_counts[CHILD_STATE_RUNNING],
+                   g_state_counts[CHILD_STATE_SIGNALED], g_state_counts[CHILD_STATE_EXITED],
+                   g_state_counts[CHILD_STATE_REAPED], g_exit_normal, g_exit_failed, g_exit_signaled, g_kills_escalated,
+                   g_log_metrics.lines, g_log_metrics.bytes, g_log_metrics.dropped, g_log_metrics.writes);
+    if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+    current_pos += (size_t)ret;
+
+    if (g_thread_workers || g_workers_started > 0) {
+        struct rusage usage;
+        long max_rss_kb = (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss : 0;
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Thread workers: %zu live, %llu started (pthread_create %.1f us mean), stack %d KiB each; parent max RSS %.1f MiB\r\n",
+                       g_worker_count, g_workers_started,
+                       (g_workers_started > 0) ? (double)g_worker_start_total_ns / (double)g_workers_started / 1e3 : 0.0,
+                       WORKER_STACK_SIZE / 1024, (double)max_rss_kb / 1024.0);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+        for (size_t i = 0; i < g_worker_count && i < WORKER_LIST_MAX; ++i) {
+            const worker_t *worker = g_workers[i];
+            ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                           "    - Worker %d TID %d%s, age %.1f s, %lld reps\r\n",
+                           worker->id, atomic_load_explicit(&worker->tid, memory_order_relaxed),
+                           atomic_load_explicit(&worker->stop, memory_order_relaxed) ? " STOPPING" : "",
+                           (double)(now_ns - worker->spawn_ns) / 1e9, (long long)worker->stats.repetitions);
+            if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+            current_pos += (size_t)ret;
+        }
+        if (g_worker_count > WORKER_LIST_MAX) {
+            ret = snprintf(list_buf + current_pos, buf_size - current_pos, "    ... and %zu more workers\r\n", g_worker_count - WORKER_LIST_MAX);
+            if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+            current_pos += (size_t)ret;
+        }
+    }
+
+    if (g_round_limit >= 0) {
+        char limit_text[32];
+        if (g_round_limit > 0) {
+            snprintf(limit_text, sizeof(limit_text), "%d per child", g_round_limit);
+        } else {
+            snprintf(limit_text, sizeof(limit_text), "until killed");
+        }
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Rounds: %llu collected from persistent children (%s), %llu could not be started\r\n",
+                       g_rounds_collected, limit_text, g_round_release_failed);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+    }
+
+    if (g_subreaper) {
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Subreaper: %zu descendants tracked; %llu found, %llu adopted, %llu reaped by the parent, "
+                       "%llu by their own parent, %llu orphans reaped unseen\r\n",
+                       g_state_counts[CHILD_STATE_DESCENDANT], g_descendants_found, g_orphans_adopted,
+                       g_descendants_reaped, g_descendants_gone, g_orphans_unseen);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+    }
 
-    ret = snprintf(list_buf + current_pos, (size_t)remaining_buf, "  Parent: %d\r\n", parent_pid);
-    if (ret < 0 || ret >= remaining_buf) goto buffer_error;
-    current_pos += ret; remaining_buf -= ret;
+    if (g_restart_count > 0) {
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Hot restarts: %llu, last paused the parent %.1f ms, %.1f ms in total\r\n",
+                       g_restart_count, (double)g_restart_pause_last_ns / 1e6, (double)g_restart_pause_total_ns / 1e6);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+    }
+
+    char helper_text[48] = "";
+    if (g_spawn_helper_fd != -1) {
+        snprintf(helper_text, sizeof(helper_text), " via spawn helper PID %d", (int)g_spawn_helper_pid);
+    }
+    ret = snprintf(list_buf + current_pos, buf_size - current_pos, "  Spawn backend: %s%s%s%s; %llu spawns, %.1f us mean to create\r\n",
+                   g_clone3_available ? "clone3 with pidfds" : "fork", helper_text,
+                   (g_cgroup_path != NULL) ? ", cgroup " : "", (g_cgroup_path != NULL) ? g_cgroup_path : "",
+                   g_spawn_calls, (g_spawn_calls > 0) ? (double)g_spawn_call_total_ns / (double)g_spawn_calls / 1e3 : 0.0);
+    if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+    current_pos += (size_t)ret;
+
+    if (g_pause_count > 0) {
+        long long fleet_paused_ns = g_fleet_paused_total_ns + ((g_fleet_paused_ns != 0) ? now_ns - g_fleet_paused_ns : 0);
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Fleet pauses: %llu, paused %.1f s in total%s\r\n",
+                       g_pause_count, (double)fleet_paused_ns / 1e9, (g_fleet_paused_ns != 0) ? " (paused now; 'c' continues)" : "");
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+    }
+
+    if (g_psi_enabled) {
+        long long throttled_ns = g_throttled_total_ns + ((g_throttle_start_ns != 0) ? now_ns - g_throttle_start_ns : 0);
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                       "  Spawn throttle (%s): %llu cpu / %llu memory pressure events, throttled %.1f s;"
+                       " %llu spawns deferred, waited %.1f s total, %.0f ms max; %zu queued\r\n",
+                       g_psi_polling ? "sampled" : "triggers", g_psi[0].events, g_psi[1].events, (double)throttled_ns / 1e9,
+                       g_deferred_total, (double)g_deferred_wait_total_ns / 1e9, (double)g_deferred_wait_max_ns / 1e6,
+                       g_deferred_count);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+    }
 
     if (g_child_count == 0) {
-        ret = snprintf(list_buf + current_pos, (size_t)remaining_buf, "  No tracked children.\r\n");
-        if (ret < 0 || ret >= remaining_buf) goto buffer_error;
-        current_pos += ret; remaining_buf -= ret;
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos, "  No tracked children.\r\n");
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
     } else {
-        ret = snprintf(list_buf + current_pos, (size_t)remaining_buf, "  Tracked Children (%zu):\r\n", g_child_count);
-        if (ret < 0 || ret >= remaining_buf) goto buffer_error;
-        current_pos += ret; remaining_buf -= ret;
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos, "  Tracked Children (%zu):\r\n", g_child_count);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
 
         for (size_t i = 0; i < g_child_count; ++i) {
-            ret = snprintf(list_buf + current_pos, (size_t)remaining_buf, "    - PID %d (tracked)\r\n", g_child_pids[i]);
-            if (ret < 0 || ret >= remaining_buf) goto buffer_error;
-            current_pos += ret; remaining_buf -= ret;
+            const child_entry_t *child = &g_children[i];
+            char sched_name[SCHED_NAME_LEN];
+            char signal_name[16];
+
+            format_sched_spec(&child->sched, sched_name, sizeof(sched_name));
+            if (child->last_signal == 0) {
+                snprintf(signal_name, sizeof(signal_name), "none");
+            } else if (child->last_signal >= SIGRTMIN) {
+                snprintf(signal_name, sizeof(signal_name), "RTMIN+%d", child->last_signal - SIGRTMIN);
+            } else {
+                snprintf(signal_name, sizeof(signal_name), "%d", child->last_signal);
+            }
+            char paused[48] = "";
+            long long paused_ns = child->paused_total_ns + ((child->paused_ns != 0) ? now_ns - child->paused_ns : 0);
+            if (paused_ns > 0) {
+                snprintf(paused, sizeof(paused), ", %s %.1f s", (child->paused_ns != 0) ? "PAUSED, paused" : "paused", (double)paused_ns / 1e9);
+            }
+            if (child->descendant) { // Forked by the workload: no policy, rounds or pauses of its own
+                char origin[64];
+                if (child->parent_pid == 0) {
+                    snprintf(origin, sizeof(origin), "orphan of an unseen parent");
+                } else {
+                    snprintf(origin, sizeof(origin), "forked by PID %d%s", (int)child->parent_pid, child->adopted ? ", adopted" : "");
+                }
+                ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                               "    - PID %d %-8s %s, seen for %.1f s, last signal %s\r\n",
+                               child->pid, child_state_name(child->state), origin,
+                               (double)(now_ns - child->spawn_ns) / 1e9, signal_name);
+                if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+                current_pos += (size_t)ret;
+                continue;
+            }
+            char round[32] = "";
+            if (g_round_limit >= 0 && child->slot >= 0 && g_stats_slots[child->slot].round > 0) {
+                snprintf(round, sizeof(round), ", round %d", (int)g_stats_slots[child->slot].round);
+            }
+            ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                           "    - PID %d %-8s policy %s, age %.1f s, last signal %s%s%s\r\n",
+                           child->pid, child_state_name(child->state), sched_name,
+                           (double)(now_ns - child->spawn_ns) / 1e9, signal_name, round, paused);
+            if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+            current_pos += (size_t)ret;
+        }
+    }
+
+    if (g_reaped_recent_total > 0) {
+        size_t shown = (g_reaped_recent_total < REAPED_RECENT_MAX) ? (size_t)g_reaped_recent_total : REAPED_RECENT_MAX;
+        ret = snprintf(list_buf + current_pos, buf_size - current_pos, "  Recently reaped (%zu of %llu, newest first):\r\n",
+                       shown, g_reaped_recent_total);
+        if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+        current_pos += (size_t)ret;
+        for (size_t k = 1; k <= shown; ++k) {
+            const reaped_child_t *reaped = &g_reaped_recent[(g_reaped_recent_total - k) % REAPED_RECENT_MAX];
+            char how[48];
+            if (reaped->exit_status == -1) {
+                snprintf(how, sizeof(how), "reaped by its own parent");
+            } else if (WIFEXITED(reaped->exit_status)) {
+                snprintf(how, sizeof(how), "exited with status %d", WEXITSTATUS(reaped->exit_status));
+            } else {
+                snprintf(how, sizeof(how), "killed by signal %d", WTERMSIG(reaped->exit_status));
+            }
+            ret = snprintf(list_buf + current_pos, buf_size - current_pos,
+                           "    - PID %d %-8s %s%s after %.1f s, zombie %.1f us, reaped %.1f s ago\r\n",
+                           reaped->pid, child_state_name(CHILD_STATE_REAPED), reaped->descendant ? "descendant " : "", how,
+                           (double)(reaped->exit_ns - reaped->spawn_ns) / 1e9, (double)(reaped->reaped_ns - reaped->exit_ns) / 1e3,
+                           (double)(now_ns - reaped->reaped_ns) / 1e9);
+            if (ret < 0 || (size_t)ret >= buf_size - current_pos) goto buffer_error;
+            current_pos += (size_t)ret;
         }
     }
 
     // Write the fully formed string once
-    if (safe_write(STDOUT_FILENO, list_buf, (size_t)current_pos) == -1) {
+    if (safe_write(STDOUT_FILENO, list_buf, current_pos) == -1) {
         // If safe_write fails, print error to stderr
         perror("PARENT: Error writing child list to stdout");
     }
+    free(list_buf);
     return;
 
     buffer_error:
-    // Handle buffer overflow during snprintf (should be rare with 4K buffer for this data)
+    // Handle buffer overflow during snprintf (should not happen, the buffer is sized per child)
     fprintf(stderr, "PARENT [%d]: Error: Buffer overflow while formatting child list. Output may be truncated.\r\n", parent_pid);
     // Try to write what was formatted
-    if (current_pos > 0 && safe_write(STDOUT_FILENO, list_buf, (size_t)current_pos) == -1) {
+    if (current_pos > 0 && safe_write(STDOUT_FILENO, list_buf, current_pos) == -1) {
         perror("PARENT: Error writing truncated child list to stdout");
     }
+    free(list_buf);
 }
@@ -0,0 +1,66 @@
+/*
+ * sched_policy.h
+ *
+ * Names of the scheduling policies the parent can give its children. The
+ * same names appear in -s, checkpoint files, results queries and the
+ * child's statistics line (SCHED=NAME:VALUE), so both programs take them
+ * from this one table.
+ */
+#ifndef SCHED_POLICY_H
+#define SCHED_POLICY_H
+
+#include <sched.h>
+#include <stddef.h>
+#include <string.h>
+
+
+// One policy and its name.
+typedef struct sched_policy_name_s {
+    const char *name;
+    int policy;
+} sched_policy_name_t;
+
+static const sched_policy_name_t g_sched_policy_names[] = {
+    { "other", SCHED_OTHER }, { "batch", SCHED_BATCH }, { "idle", SCHED_IDLE },
+    { "fifo", SCHED_FIFO }, { "rr", SCHED_RR },
+};
+
+#define SCHED_POLICY_NAME_COUNT (sizeof(g_sched_policy_names) / sizeof(g_sched_policy_names[0]))
+
+
+/*
+ * sched_policy_name
+ *
+ * Accepts:
+ *   policy - SCHED_* value
+ *
+ * Returns: The policy's name, or "unknown".
+ */
+static inline const char *sched_policy_name(int policy) {
+    for (size_t i = 0; i < SCHED_POLICY_NAME_COUNT; ++i) {
+        if (g_sched_policy_names[i].policy == policy) {
+            return g_sched_policy_names[i].name;
+        }
+    }
+    return "unknown";
+}
+
+/*
+ * sched_policy_lookup
+ *
+ * Accepts:
+ *   name - Policy name, not necessarily NUL-terminated
+ *   name_len - Length of name
+ *
+ * Returns: The SCHED_* value, or -1 if the name is unknown.
+ */
+static inline int sched_policy_lookup(const char *name, size_t name_len) {
+    for (size_t i = 0; i < SCHED_POLICY_NAME_COUNT; ++i) {
+        if (strlen(g_sched_policy_names[i].name) == name_len && strncmp(g_sched_policy_names[i].name, name, name_len) == 0) {
+            return g_sched_policy_names[i].policy;
+        }
+    }
+    return -1;
+}
+
+#endif // SCHED_POLICY_H
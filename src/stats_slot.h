@@ -0,0 +1,148 @@
+/*
+ * stats_slot.h
+ *
+ * Layout of the shared statistics region. The parent creates one region
+ * with STATS_SLOT_COUNT slots and passes each child the region's file
+ * descriptor and a slot index on its command line (-F FD -n SLOT). The
+ * child publishes its live counters in that slot from the SIGALRM handler;
+ * the parent reads them without any system call (e.g. for the dashboard).
+ *
+ * Every CHECKPOINT_INTERVAL repetitions, on SIGTERM and at completion the
+ * child also writes a consistent checkpoint of its counters. Checkpoints
+ * are double-buffered: the child fills the record that is not current,
+ * then publishes it, so a child killed mid-write leaves the previous
+ * checkpoint intact. Each record is additionally guarded by a sequence
+ * count (odd while being written) for readers racing a live writer.
+ *
+ * A child sampled externally (-e) publishes the address of its pair
+ * instead of sampling itself. The parent's sampler process then reads the
+ * pair with process_vm_readv() and becomes the only writer of the slot's
+ * counters and checkpoints.
+ *
+ * A persistent child (-M) reuses its slot for every round: the final
+ * checkpoint of a round stays in place until the parent has collected it
+ * and started the next round, which begins with a zeroed checkpoint.
+ */
+#ifndef STATS_SLOT_H
+#define STATS_SLOT_H
+
+#include <stdint.h>
+#include <stdatomic.h> // For atomic_thread_fence
+
+
+#define STATS_SLOT_COUNT 4096 // Children beyond this run without a slot
+#define STATS_SLOT_ALIGN 64   // One cache line per slot, so children never share a line
+#define CHECKPOINT_INTERVAL 1000 // Repetitions between periodic checkpoints
+#define CHECKPOINT_READ_TRIES 64 // Attempts to read a record while it is being rewritten
+
+
+// Why a checkpoint was written.
+typedef enum checkpoint_reason_e {
+    CHECKPOINT_NONE = 0,  // No checkpoint yet
+    CHECKPOINT_PERIODIC,  // Every CHECKPOINT_INTERVAL repetitions
+    CHECKPOINT_SIGTERM,   // The child was asked to terminate
+    CHECKPOINT_FINAL      // The child completed its repetitions
+} checkpoint_reason_t;
+
+
+// One checkpoint record. Counters are cumulative, including any resumed counts.
+typedef struct stats_checkpoint_s {
+    volatile uint32_t seq;         // Odd while the record is being written
+    volatile int32_t reason;       // checkpoint_reason_t
+    volatile int64_t repetitions;
+    volatile int64_t counts[4];
+} stats_checkpoint_t;
+
+
+// Plain copy of a checkpoint, as read by the parent.
+typedef struct checkpoint_data_s {
+    int reason;
+    int64_t repetitions;
+    int64_t counts[4];
+} checkpoint_data_t;
+
+
+// Live statistics of one child. Written only by the child (or by the external sampler
+// for a child that publishes pair_addr), read by the parent.
+typedef struct stats_slot_s {
+    _Alignas(STATS_SLOT_ALIGN) volatile int32_t pid; // Owner, 0 until the child has attached
+    volatile int32_t total_reps;   // Repetitions the child will run, 0 for a time-boxed run
+    volatile int64_t repetitions;  // Repetitions done so far
+    volatile int64_t counts[4];    // Observed pair states {0,0}, {0,1}, {1,0}, {1,1}
+    volatile int32_t checkpoint_current; // Index of the newest complete record in checkpoint[]
+    stats_checkpoint_t checkpoint[2];
+    volatile uint64_t pair_addr;   // Address of the child's pair if sampled externally, 0 otherwise
+    volatile int64_t deadline_ns;  // CLOCK_MONOTONIC end of a time-boxed run (-d), 0 otherwise
+    volatile int32_t done;         // Set by the external sampler after the final checkpoint
+    volatile int32_t paused;       // Set by the parent before SIGSTOP, cleared by the child once it
+                                   // has accounted for the pause; the sampler skips paused slots
+    volatile int32_t round;        // Round of a persistent child (-M) the counters belong to, 0 otherwise
+} stats_slot_t;
+
+#define STATS_REGION_SIZE (STATS_SLOT_COUNT * sizeof(stats_slot_t))
+#define STATS_HUGE_PAGE_SIZE (2UL * 1024 * 1024) // Huge page size assumed for the region (-H)
+
+/*
+ * stats_checkpoint_write
+ *
+ * Writes a checkpoint into the record that is not current and publishes
+ * it. Called by the slot's owner only, never concurrently with itself
+ * (the child masks SIGALRM and SIGTERM in each other's handlers).
+ * Async-signal-safe.
+ *
+ * Accepts:
+ *   slot - The child's slot
+ *   data - Counters to store
+ *
+ * Returns: None
+ */
+static inline void stats_checkpoint_write(stats_slot_t *slot, const checkpoint_data_t *data) {
+    int32_t next = !slot->checkpoint_current;
+    stats_checkpoint_t *record = &slot->checkpoint[next];
+
+    record->seq++; // Odd: being written
+    atomic_thread_fence(memory_order_release);
+    record->reason = data->reason;
+    record->repetitions = data->repetitions;
+    for (int i = 0; i < 4; ++i) {
+        record->counts[i] = data->counts[i];
+    }
+    atomic_thread_fence(memory_order_release);
+    record->seq++; // Even: complete
+    atomic_thread_fence(memory_order_release);
+    slot->checkpoint_current = next;
+}
+
+/*
+ * stats_checkpoint_read
+ *
+ * Reads the current checkpoint of a slot, retrying while the writer is
+ * rewriting the record.
+ *
+ * Accepts:
+ *   slot - Slot to read
+ *   data - Output: checkpoint contents
+ *
+ * Returns:
+ *   0 on success (data->reason is CHECKPOINT_NONE if the child never wrote
+ *   one), -1 if no consistent copy could be obtained.
+ */
+static inline int stats_checkpoint_read(const stats_slot_t *slot, checkpoint_data_t *data) {
+    for (int attempt = 0; attempt < CHECKPOINT_READ_TRIES; ++attempt) {
+        const stats_checkpoint_t *record = &slot->checkpoint[slot->checkpoint_current & 1];
+        uint32_t seq = record->seq;
+        atomic_thread_fence(memory_order_acquire);
+        data->reason = record->reason;
+        data->repetitions = record->repetitions;
+        for (int i = 0; i < 4; ++i) {
+            data->counts[i] = record->counts[i];
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if ((seq & 1U) == 0 && record->seq == seq) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#endif // STATS_SLOT_H
@@ -0,0 +1,79 @@
+/*
+ * trace_probe.h
+ *
+ * Static tracepoints for perf, bpftrace and SystemTap, defined in-tree
+ * (no <sys/sdt.h>). Each TRACE_PROBEn() site assembles to one nop and an
+ * ELF note in .note.stapsdt (SDT note format v3) recording the nop's
+ * address, the provider (TRACE_PROVIDER), the probe name and where each
+ * argument lives at the nop (register, stack slot or constant). Tools read
+ * the notes and plant a breakpoint on the nop only while a probe is
+ * attached; otherwise the nop is all a site costs. There is no semaphore,
+ * so arguments are always evaluated: pass values already at hand.
+ *
+ * Arguments are passed as signed 64-bit values. The sites compile to
+ * nothing with -DTRACE_PROBES_DISABLED, or on architectures other than
+ * x86-64 and AArch64.
+ *
+ *   perf probe -x build/release/child sdt_lab03:alarm_entry
+ *   bpftrace -e 'usdt:build/release/parent:lab03:reap { @[arg1] = count(); }'
+ */
+#ifndef TRACE_PROBE_H
+#define TRACE_PROBE_H
+
+#define TRACE_PROVIDER "lab03"
+
+#if !defined(TRACE_PROBES_DISABLED) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+
+// The note; ARGS is the argument description, e.g. "-8@%[a1] -8@%[a2]".
+#define TRACE_PROBE_ASM_(name, args) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte 0\n" \
+    ".asciz \"" TRACE_PROVIDER "\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" args "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+
+#define TRACE_PROBE(name) \
+    __asm__ __volatile__(TRACE_PROBE_ASM_(name, "") : : )
+#define TRACE_PROBE1(name, v1) \
+    __asm__ __volatile__(TRACE_PROBE_ASM_(name, "-8@%[a1]") : : \
+        [a1] "nor" ((long long)(v1)))
+#define TRACE_PROBE2(name, v1, v2) \
+    __asm__ __volatile__(TRACE_PROBE_ASM_(name, "-8@%[a1] -8@%[a2]") : : \
+        [a1] "nor" ((long long)(v1)), [a2] "nor" ((long long)(v2)))
+#define TRACE_PROBE3(name, v1, v2, v3) \
+    __asm__ __volatile__(TRACE_PROBE_ASM_(name, "-8@%[a1] -8@%[a2] -8@%[a3]") : : \
+        [a1] "nor" ((long long)(v1)), [a2] "nor" ((long long)(v2)), [a3] "nor" ((long long)(v3)))
+#define TRACE_PROBE4(name, v1, v2, v3, v4) \
+    __asm__ __volatile__(TRACE_PROBE_ASM_(name, "-8@%[a1] -8@%[a2] -8@%[a3] -8@%[a4]") : : \
+        [a1] "nor" ((long long)(v1)), [a2] "nor" ((long long)(v2)), [a3] "nor" ((long long)(v3)), \
+        [a4] "nor" ((long long)(v4)))
+
+#else // No probes: the arguments are not evaluated, but still count as used
+
+#define TRACE_PROBE(name) do { } while (0)
+#define TRACE_PROBE1(name, v1) do { (void)sizeof(v1); } while (0)
+#define TRACE_PROBE2(name, v1, v2) do { (void)sizeof(v1); (void)sizeof(v2); } while (0)
+#define TRACE_PROBE3(name, v1, v2, v3) do { (void)sizeof(v1); (void)sizeof(v2); (void)sizeof(v3); } while (0)
+#define TRACE_PROBE4(name, v1, v2, v3, v4) \
+    do { (void)sizeof(v1); (void)sizeof(v2); (void)sizeof(v3); (void)sizeof(v4); } while (0)
+
+#endif
+
+#endif // TRACE_PROBE_H